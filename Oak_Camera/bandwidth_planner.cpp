@@ -0,0 +1,100 @@
+//
+// Oak USB Bandwidth Planner
+//
+
+#include "bandwidth_planner.hpp"
+
+// Frame rate kept while a lower resolution is still available
+static constexpr int kPreferredFps = 30;
+
+static const BandwidthMode &GetMode(const std::vector<BandwidthStream> &streams, int idx)
+{
+    const BandwidthStream &stream = streams[idx];
+    return stream.modes[stream.mode_idx];
+}
+
+int bandwidth_planner::GetWidth(const std::vector<BandwidthStream> &streams, int idx)
+{
+    int src = streams[idx].size_from >= 0 ? streams[idx].size_from : idx;
+    return GetMode(streams, src).width;
+}
+
+int bandwidth_planner::GetHeight(const std::vector<BandwidthStream> &streams, int idx)
+{
+    int src = streams[idx].size_from >= 0 ? streams[idx].size_from : idx;
+    return GetMode(streams, src).height;
+}
+
+int bandwidth_planner::GetFps(const std::vector<BandwidthStream> &streams, int idx)
+{
+    int src = streams[idx].fps_from >= 0 ? streams[idx].fps_from : idx;
+    return GetMode(streams, src).fps_list[streams[src].fps_idx];
+}
+
+double bandwidth_planner::GetStreamRate(const std::vector<BandwidthStream> &streams, int idx)
+{
+    return (double)GetWidth(streams, idx) * GetHeight(streams, idx) * GetFps(streams, idx) *
+           streams[idx].bytes_per_pixel / (1024.0 * 1024.0);
+}
+
+double bandwidth_planner::GetRequiredRate(const std::vector<BandwidthStream> &streams)
+{
+    double rate = 0.0;
+    for (int i = 0; i < (int)streams.size(); i++)
+        rate += GetStreamRate(streams, i);
+
+    return rate;
+}
+
+bool bandwidth_planner::Fits(const std::vector<BandwidthStream> &streams, double capacity)
+{
+    return capacity <= 0.0 || GetRequiredRate(streams) <= capacity;
+}
+
+bool bandwidth_planner::StepDown(std::vector<BandwidthStream> &streams, double capacity)
+{
+    while (!Fits(streams, capacity)) {
+        // Reduce the most expensive stream that still has somewhere to go, shared size / fps step the owning stream
+        int best = -1;
+        int best_target = -1;
+        bool best_res = false;
+        double best_rate = 0.0;
+        for (int i = 0; i < (int)streams.size(); i++) {
+            double rate = GetStreamRate(streams, i);
+            if (rate <= best_rate)
+                continue;
+            int fps_src = streams[i].fps_from >= 0 ? streams[i].fps_from : i;
+            int size_src = streams[i].size_from >= 0 ? streams[i].size_from : i;
+            bool can_fps = streams[fps_src].fps_idx + 1 < (int)GetMode(streams, fps_src).fps_list.size();
+            bool can_res = streams[size_src].mode_idx + 1 < (int)streams[size_src].modes.size();
+            if (!can_fps && !can_res)
+                continue;
+            best = i;
+            best_rate = rate;
+            best_res = can_res && (!can_fps || GetFps(streams, i) <= kPreferredFps);
+            best_target = best_res ? size_src : fps_src;
+        }
+        if (best < 0)
+            return false;
+
+        BandwidthStream &target = streams[best_target];
+        if (best_res) {
+            // Keep the closest frame rate the smaller mode supports
+            int fps = GetMode(streams, best_target).fps_list[target.fps_idx];
+            target.mode_idx++;
+            const auto &fps_list = GetMode(streams, best_target).fps_list;
+            target.fps_idx = (int)fps_list.size() - 1;
+            for (int i = 0; i < (int)fps_list.size(); i++) {
+                if (fps_list[i] <= fps) {
+                    target.fps_idx = i;
+                    break;
+                }
+            }
+        }
+        else {
+            target.fps_idx++;
+        }
+    }
+
+    return true;
+}
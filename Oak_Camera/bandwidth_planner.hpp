@@ -0,0 +1,45 @@
+//
+// Oak USB Bandwidth Planner
+//
+// Estimates the XLink throughput a set of output streams needs and steps
+// fps / resolution down until it fits the negotiated USB link. Works on
+// plain stream descriptions and a link capacity in MB/s only, so it can be
+// exercised without a device or the DepthAI headers.
+//
+
+#ifndef FLOWCV_PLUGIN_BANDWIDTH_PLANNER_HPP_
+#define FLOWCV_PLUGIN_BANDWIDTH_PLANNER_HPP_
+#include <string>
+#include <vector>
+
+struct BandwidthMode
+{
+    int width;
+    int height;
+    std::vector<int> fps_list; // Highest first
+};
+
+struct BandwidthStream
+{
+    std::string name;
+    float bytes_per_pixel;     // 0 for streams that are configured but not sent to the host
+    std::vector<BandwidthMode> modes; // Largest first
+    int mode_idx;
+    int fps_idx;
+    int size_from;             // Stream whose frame size this one shares, -1 for its own
+    int fps_from;              // Stream whose frame rate this one shares, -1 for its own
+};
+
+class bandwidth_planner {
+  public:
+    static int GetWidth(const std::vector<BandwidthStream> &streams, int idx);
+    static int GetHeight(const std::vector<BandwidthStream> &streams, int idx);
+    static int GetFps(const std::vector<BandwidthStream> &streams, int idx);
+    static double GetStreamRate(const std::vector<BandwidthStream> &streams, int idx);
+    static double GetRequiredRate(const std::vector<BandwidthStream> &streams);
+    // Capacity in MB/s, 0 for a link that is not limited
+    static bool Fits(const std::vector<BandwidthStream> &streams, double capacity);
+    static bool StepDown(std::vector<BandwidthStream> &streams, double capacity);
+};
+
+#endif //FLOWCV_PLUGIN_BANDWIDTH_PLANNER_HPP_
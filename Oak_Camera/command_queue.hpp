@@ -0,0 +1,64 @@
+//
+// Oak Camera Command Queue
+//
+// Fixed size single producer / single consumer ring. The GUI thread pushes,
+// the processing thread pops, neither side takes a lock or waits on the other.
+//
+
+#ifndef FLOWCV_PLUGIN_COMMAND_QUEUE_HPP_
+#define FLOWCV_PLUGIN_COMMAND_QUEUE_HPP_
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+template <typename T, size_t Capacity>
+class command_queue {
+  public:
+    command_queue() : head_(0), tail_(0) {}
+    command_queue(const command_queue &) = delete;
+    command_queue &operator=(const command_queue &) = delete;
+
+    // Producer side, false when the ring is full
+    bool Push(T &&item)
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t next = (tail + 1) % kSlots;
+        if (next == head_.load(std::memory_order_acquire))
+            return false;
+
+        items_[tail] = std::move(item);
+        tail_.store(next, std::memory_order_release);
+
+        return true;
+    }
+
+    // Consumer side, false when there is nothing queued
+    bool Pop(T &item)
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire))
+            return false;
+
+        item = std::move(items_[head]);
+        items_[head] = T();
+        head_.store((head + 1) % kSlots, std::memory_order_release);
+
+        return true;
+    }
+
+    [[nodiscard]] bool Empty() const
+    {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+  private:
+    // One slot stays free to tell a full ring from an empty one
+    static constexpr size_t kSlots = Capacity + 1;
+
+    std::array<T, kSlots> items_;
+    alignas(64) std::atomic<size_t> head_;
+    alignas(64) std::atomic<size_t> tail_;
+};
+
+#endif //FLOWCV_PLUGIN_COMMAND_QUEUE_HPP_
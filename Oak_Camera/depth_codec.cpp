@@ -0,0 +1,272 @@
+//
+// Oak Lossless Depth Codec
+//
+
+#include "depth_codec.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DEPTH_CODEC_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static inline int FirstSetBit(unsigned int mask)
+{
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return (int)idx;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// Length of the run of zero pixels starting at src
+static inline int CountZeros(const uint16_t *src, int count)
+{
+    int i = 0;
+#ifdef DEPTH_CODEC_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8) {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(src + i)), zero));
+        if (mask != 0xFFFF)
+            return i + FirstSetBit(~(unsigned int)mask & 0xFFFF) / 2;
+    }
+#endif
+    while (i < count && src[i] == 0)
+        i++;
+    return i;
+}
+
+// Length of the run of non-zero pixels starting at src
+static inline int CountNonZeros(const uint16_t *src, int count)
+{
+    int i = 0;
+#ifdef DEPTH_CODEC_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8) {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(src + i)), zero));
+        if (mask != 0)
+            return i + FirstSetBit((unsigned int)mask) / 2;
+    }
+#endif
+    while (i < count && src[i] != 0)
+        i++;
+    return i;
+}
+
+// Turns the deltas at pix into pixel values in place, 16 bit wraparound gives the same result as int sums
+static inline uint16_t PrefixSum(uint16_t *pix, int count, uint16_t prev)
+{
+    int i = 0;
+#ifdef DEPTH_CODEC_SSE2
+    __m128i carry = _mm_set1_epi16((short)prev);
+    for (; i + 8 <= count; i += 8) {
+        // Log step inclusive scan across the eight lanes, then the last value of the previous block
+        __m128i x = _mm_loadu_si128((const __m128i *)(pix + i));
+        x = _mm_add_epi16(x, _mm_slli_si128(x, 2));
+        x = _mm_add_epi16(x, _mm_slli_si128(x, 4));
+        x = _mm_add_epi16(x, _mm_slli_si128(x, 8));
+        x = _mm_add_epi16(x, carry);
+        _mm_storeu_si128((__m128i *)(pix + i), x);
+        carry = _mm_shufflehi_epi16(x, _MM_SHUFFLE(3, 3, 3, 3));
+        carry = _mm_unpackhi_epi64(carry, carry);
+    }
+    prev = (uint16_t)_mm_extract_epi16(carry, 0);
+#endif
+    for (; i < count; i++) {
+        prev = (uint16_t)(prev + pix[i]);
+        pix[i] = prev;
+    }
+    return prev;
+}
+
+size_t depth_codec::MaxEncodedSize(int width, int height)
+{
+    // A full range delta takes six nibbles, run lengths add at most one more byte per pixel
+    return sizeof(DepthCodecHeader) + (size_t)width * height * 4 + 16;
+}
+
+size_t depth_codec::Encode(const uint16_t *src, int width, int height, size_t src_step, uint8_t *dst)
+{
+    if (src == nullptr || dst == nullptr || width <= 0 || height <= 0 || width > 0xFFFF || height > 0xFFFF)
+        return 0;
+
+    // Runs span rows, padded frames are packed first
+    const int count = width * height;
+    std::vector<uint16_t> packed;
+    const uint16_t *pix = src;
+    if (src_step != (size_t)width * sizeof(uint16_t)) {
+        packed.resize(count);
+        for (int y = 0; y < height; y++)
+            std::memcpy(&packed[(size_t)y * width], (const uint8_t *)src + y * src_step, width * sizeof(uint16_t));
+        pix = packed.data();
+    }
+
+    uint8_t *out = dst + sizeof(DepthCodecHeader);
+    uint32_t word = 0;
+    int nibbles = 0;
+    auto put = [&](uint32_t value) {
+        do {
+            uint32_t nibble = value & 0x7;
+            value >>= 3;
+            if (value)
+                nibble |= 0x8;
+            word = (word << 4) | nibble;
+            if (++nibbles == 8) {
+                std::memcpy(out, &word, sizeof(word));
+                out += sizeof(word);
+                word = 0;
+                nibbles = 0;
+            }
+        } while (value);
+    };
+
+    int prev = 0;
+    int i = 0;
+    while (i < count) {
+        int zeros = CountZeros(pix + i, count - i);
+        put((uint32_t)zeros);
+        i += zeros;
+        int nonzeros = CountNonZeros(pix + i, count - i);
+        put((uint32_t)nonzeros);
+        for (int end = i + nonzeros; i < end; i++) {
+            int cur = pix[i];
+            int delta = cur - prev;
+            put(((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+            prev = cur;
+        }
+    }
+    if (nibbles > 0) {
+        word <<= 4 * (8 - nibbles);
+        std::memcpy(out, &word, sizeof(word));
+        out += sizeof(word);
+    }
+
+    DepthCodecHeader hdr{DEPTH_CODEC_MAGIC, (uint16_t)width, (uint16_t)height,
+                         (uint32_t)(out - dst - sizeof(DepthCodecHeader))};
+    std::memcpy(dst, &hdr, sizeof(hdr));
+
+    return (size_t)(out - dst);
+}
+
+bool depth_codec::Encode(const uint16_t *src, int width, int height, size_t src_step, std::vector<uint8_t> &dst)
+{
+    dst.resize(MaxEncodedSize(width, height));
+    size_t size = Encode(src, width, height, src_step, dst.data());
+    dst.resize(size);
+
+    return size > 0;
+}
+
+bool depth_codec::ReadHeader(const uint8_t *src, size_t size, int &width, int &height)
+{
+    if (src == nullptr || size < sizeof(DepthCodecHeader))
+        return false;
+
+    DepthCodecHeader hdr{};
+    std::memcpy(&hdr, src, sizeof(hdr));
+    if (hdr.magic != DEPTH_CODEC_MAGIC || hdr.payload_size > size - sizeof(DepthCodecHeader))
+        return false;
+
+    width = hdr.width;
+    height = hdr.height;
+
+    return true;
+}
+
+bool depth_codec::Decode(const uint8_t *src, size_t size, uint16_t *dst, size_t dst_step)
+{
+    int width, height;
+    if (dst == nullptr || !ReadHeader(src, size, width, height))
+        return false;
+
+    DepthCodecHeader hdr{};
+    std::memcpy(&hdr, src, sizeof(hdr));
+    const uint8_t *in = src + sizeof(DepthCodecHeader);
+    const uint8_t *in_end = in + hdr.payload_size;
+
+    const int count = width * height;
+    std::vector<uint16_t> packed;
+    uint16_t *pix = dst;
+    if (dst_step != (size_t)width * sizeof(uint16_t)) {
+        packed.resize(count);
+        pix = packed.data();
+    }
+
+    uint32_t word = 0;
+    int nibbles = 0;
+    bool valid = true;
+    auto get = [&]() -> uint32_t {
+        uint32_t value = 0;
+        uint32_t nibble;
+        int shift = 0;
+        do {
+            if (nibbles == 0) {
+                if (in_end - in < (ptrdiff_t)sizeof(word)) {
+                    valid = false;
+                    return 0;
+                }
+                std::memcpy(&word, in, sizeof(word));
+                in += sizeof(word);
+                nibbles = 8;
+            }
+            nibble = word >> 28;
+            word <<= 4;
+            nibbles--;
+            value |= (nibble & 0x7) << shift;
+            shift += 3;
+        } while ((nibble & 0x8) && shift < 32);
+        return value;
+    };
+
+    // Variable length codes only decode one at a time, so each run is read as deltas and summed afterwards
+    uint16_t prev = 0;
+    int i = 0;
+    while (i < count) {
+        uint32_t zeros = get();
+        if (!valid || zeros > (uint32_t)(count - i))
+            return false;
+        std::fill_n(pix + i, zeros, (uint16_t)0);
+        i += (int)zeros;
+        uint32_t nonzeros = get();
+        if (!valid || nonzeros > (uint32_t)(count - i))
+            return false;
+        for (int end = i + (int)nonzeros, j = i; j < end;) {
+            if (nibbles == 0 && in_end - in >= (ptrdiff_t)sizeof(word)) {
+                std::memcpy(&word, in, sizeof(word));
+                in += sizeof(word);
+                nibbles = 8;
+            }
+            // A whole word of single nibble codes, the common case on smooth surfaces, is expanded without branches
+            if (nibbles == 8 && end - j >= 8 && (word & 0x88888888U) == 0) {
+                for (int k = 0; k < 8; k++) {
+                    uint32_t positive = (word >> (28 - 4 * k)) & 0x7;
+                    pix[j + k] = (uint16_t)((positive >> 1) ^ (0U - (positive & 1)));
+                }
+                nibbles = 0;
+                j += 8;
+                continue;
+            }
+            uint32_t positive = get();
+            pix[j++] = (uint16_t)((positive >> 1) ^ (0U - (positive & 1)));
+            if (!valid)
+                break;
+        }
+        if (!valid)
+            return false;
+        prev = PrefixSum(pix + i, (int)nonzeros, prev);
+        i += (int)nonzeros;
+    }
+
+    if (pix != dst) {
+        for (int y = 0; y < height; y++)
+            std::memcpy((uint8_t *)dst + y * dst_step, &packed[(size_t)y * width], width * sizeof(uint16_t));
+    }
+
+    return true;
+}
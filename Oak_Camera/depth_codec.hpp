@@ -0,0 +1,35 @@
+//
+// Oak Lossless Depth Codec
+//
+// RVL (run length + variable length) coding of 16 bit depth, see A. Wilson,
+// "Fast Lossless Depth Image Compression", ISS 2017. Zero and non-zero runs are
+// located eight pixels at a time with SSE2 where available, and decoding turns
+// the deltas of each run back into pixels with an SSE2 prefix sum.
+//
+
+#ifndef FLOWCV_PLUGIN_DEPTH_CODEC_HPP_
+#define FLOWCV_PLUGIN_DEPTH_CODEC_HPP_
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#define DEPTH_CODEC_MAGIC 0x314C5652U // "RVL1"
+
+struct DepthCodecHeader
+{
+    uint32_t magic;
+    uint16_t width;
+    uint16_t height;
+    uint32_t payload_size;
+};
+
+class depth_codec {
+  public:
+    static size_t MaxEncodedSize(int width, int height);
+    static size_t Encode(const uint16_t *src, int width, int height, size_t src_step, uint8_t *dst);
+    static bool Encode(const uint16_t *src, int width, int height, size_t src_step, std::vector<uint8_t> &dst);
+    static bool ReadHeader(const uint8_t *src, size_t size, int &width, int &height);
+    static bool Decode(const uint8_t *src, size_t size, uint16_t *dst, size_t dst_step);
+};
+
+#endif //FLOWCV_PLUGIN_DEPTH_CODEC_HPP_
@@ -0,0 +1,126 @@
+//
+// Oak Depth to Laser Scan
+//
+
+#include "depth_scan.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DEPTH_SCAN_SSE2
+#include <emmintrin.h>
+#endif
+
+depth_scan::depth_scan()
+{
+    band_top_ = 40;
+    band_bottom_ = 60;
+    Reset();
+}
+
+void depth_scan::Reset()
+{
+    k_.clear();
+    size_ = cv::Size();
+    angles_.clear();
+    range_scale_.clear();
+    col_min_.clear();
+}
+
+void depth_scan::SetIntrinsics(const std::vector<std::vector<float>> &intrinsics, int width, int height)
+{
+    cv::Size size(width, height);
+    if (intrinsics == k_ && size == size_)
+        return;
+
+    k_ = intrinsics;
+    size_ = size;
+    angles_.clear();
+    range_scale_.clear();
+    if (k_.size() != 3 || size_.empty() || k_[0][0] <= 0.0f)
+        return;
+
+    // Positive bearings are to the left of the optical axis, range is the depth scaled onto the ray (mm to m)
+    const float fx = k_[0][0];
+    const float cx = k_[0][2];
+    angles_.resize(width);
+    range_scale_.resize(width);
+    for (int i = 0; i < width; i++) {
+        float x = (cx - (float)(width - 1 - i)) / fx;
+        angles_[i] = std::atan(x);
+        range_scale_[i] = std::sqrt(1.0f + x * x) * 0.001f;
+    }
+}
+
+void depth_scan::SetBand(int top_pct, int bottom_pct)
+{
+    band_top_ = std::clamp(top_pct, 0, 99);
+    band_bottom_ = std::clamp(bottom_pct, band_top_ + 1, 100);
+}
+
+int depth_scan::GetBandTop() const
+{
+    return band_top_;
+}
+
+int depth_scan::GetBandBottom() const
+{
+    return band_bottom_;
+}
+
+bool depth_scan::CanScan() const
+{
+    return !angles_.empty();
+}
+
+const std::vector<float> &depth_scan::GetAngles() const
+{
+    return angles_;
+}
+
+void depth_scan::ColumnMin_(const cv::Mat &depth, int y0, int y1)
+{
+    // Subtracting one wraps invalid zero depth to the largest value so it never wins the minimum,
+    // the result is shifted back so columns without any valid depth come out as zero again
+    const int width = depth.cols;
+    col_min_.assign(width, 0xFFFF);
+    uint16_t *acc = col_min_.data();
+    for (int y = y0; y < y1; y++) {
+        const auto *row = depth.ptr<uint16_t>(y);
+        int x = 0;
+#ifdef DEPTH_SCAN_SSE2
+        // SSE2 only has a signed 16 bit minimum, flipping the sign bit orders unsigned values correctly
+        const __m128i one = _mm_set1_epi16(1);
+        const __m128i flip = _mm_set1_epi16((short)0x8000);
+        for (; x + 8 <= width; x += 8) {
+            __m128i v = _mm_xor_si128(_mm_sub_epi16(_mm_loadu_si128((const __m128i *)(row + x)), one), flip);
+            __m128i m = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(acc + x)), flip);
+            _mm_storeu_si128((__m128i *)(acc + x), _mm_xor_si128(_mm_min_epi16(m, v), flip));
+        }
+#endif
+        for (; x < width; x++)
+            acc[x] = std::min(acc[x], (uint16_t)(row[x] - 1));
+    }
+    for (int x = 0; x < width; x++)
+        acc[x] = (uint16_t)(acc[x] + 1);
+}
+
+bool depth_scan::Scan(const cv::Mat &depth, std::vector<float> &ranges)
+{
+    if (depth.empty() || depth.type() != CV_16UC1 || !CanScan() || depth.cols != size_.width)
+        return false;
+
+    int y0 = depth.rows * band_top_ / 100;
+    int y1 = std::max(depth.rows * band_bottom_ / 100, y0 + 1);
+    ColumnMin_(depth, y0, std::min(y1, depth.rows));
+
+    // Columns with no valid depth in the band report zero (no return)
+    const int width = depth.cols;
+    ranges.resize(width);
+    for (int i = 0; i < width; i++) {
+        uint16_t z = col_min_[width - 1 - i];
+        ranges[i] = z > 0 ? (float)z * range_scale_[i] : 0.0f;
+    }
+
+    return true;
+}
@@ -0,0 +1,42 @@
+//
+// Oak Depth to Laser Scan
+//
+// Reduces a depth frame to one range per column: the nearest valid depth
+// inside a horizontal band of rows, converted to planar range with a per
+// column bearing table built from the depth intrinsics.
+//
+
+#ifndef FLOWCV_PLUGIN_DEPTH_SCAN_HPP_
+#define FLOWCV_PLUGIN_DEPTH_SCAN_HPP_
+#include <vector>
+#include "opencv2/opencv.hpp"
+
+class depth_scan {
+  public:
+    depth_scan();
+    void Reset();
+    void SetIntrinsics(const std::vector<std::vector<float>> &intrinsics, int width, int height);
+    void SetBand(int top_pct, int bottom_pct);
+    [[nodiscard]] int GetBandTop() const;
+    [[nodiscard]] int GetBandBottom() const;
+    [[nodiscard]] bool CanScan() const;
+    bool Scan(const cv::Mat &depth, std::vector<float> &ranges);
+    [[nodiscard]] const std::vector<float> &GetAngles() const;
+
+  private:
+    void ColumnMin_(const cv::Mat &depth, int y0, int y1);
+
+    // Bearing tables are rebuilt only when the intrinsics or frame size change,
+    // entries run from the rightmost column to the leftmost so angles increase
+    std::vector<std::vector<float>> k_;
+    cv::Size size_;
+    std::vector<float> angles_;
+    std::vector<float> range_scale_;
+    int band_top_;
+    int band_bottom_;
+
+    // Per frame scratch buffer
+    std::vector<uint16_t> col_min_;
+};
+
+#endif //FLOWCV_PLUGIN_DEPTH_SCAN_HPP_
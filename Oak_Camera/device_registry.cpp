@@ -0,0 +1,233 @@
+//
+// Oak Shared Device Registry
+//
+
+#include "device_registry.hpp"
+#include <algorithm>
+
+shared_device::shared_device(std::string mxid) : mxid_(std::move(mxid))
+{
+    camera_ = std::make_unique<oak_camera>();
+    points_requested_ = false;
+    frames_.seq = 0;
+}
+
+std::mutex &shared_device::Mutex()
+{
+    return mutex_;
+}
+
+oak_camera &shared_device::Camera()
+{
+    return *camera_;
+}
+
+const std::string &shared_device::GetMxId() const
+{
+    return mxid_;
+}
+
+bool shared_device::Open()
+{
+    if (camera_->IsInit() || mxid_.empty())
+        return camera_->IsInit();
+
+    // Device indices are per enumeration, resolve ours by serial
+    camera_->RefreshDeviceList();
+    for (int i = 1; i <= camera_->GetDeviceCount(); i++) {
+        if (camera_->GetDeviceSerial(i) == mxid_) {
+            camera_->InitCamera(i, true);
+            break;
+        }
+    }
+
+    return camera_->IsInit();
+}
+
+void shared_device::AddClient(int client)
+{
+    clients_.insert(client);
+}
+
+void shared_device::RemoveClient(int client)
+{
+    clients_.erase(client);
+    ClearStreamRequest(client, dai::CameraBoardSocket::RGB);
+    ClearStreamRequest(client, dai::CameraBoardSocket::AUTO);
+}
+
+size_t shared_device::GetClientCount() const
+{
+    return clients_.size();
+}
+
+void shared_device::SetStreamRequest(int client, const StreamConfig &config)
+{
+    if (config.fps_list.empty())
+        return;
+
+    if (config.stream_type == dai::CameraBoardSocket::RGB)
+        color_requests_[client] = config;
+    else if (config.stream_type == dai::CameraBoardSocket::AUTO)
+        depth_requests_[client] = config;
+    else
+        return;
+
+    ApplyRequests_(config.stream_type);
+}
+
+void shared_device::ClearStreamRequest(int client, dai::CameraBoardSocket stream)
+{
+    auto &requests = (stream == dai::CameraBoardSocket::RGB) ? color_requests_ : depth_requests_;
+    if (requests.erase(client) > 0)
+        ApplyRequests_(stream);
+}
+
+std::string shared_device::GetOverriddenMode(int client, dai::CameraBoardSocket stream) const
+{
+    const auto &requests = (stream == dai::CameraBoardSocket::RGB) ? color_requests_ : depth_requests_;
+    const auto &applied = (stream == dai::CameraBoardSocket::RGB) ? color_applied_ : depth_applied_;
+    auto it = requests.find(client);
+    if (it == requests.end() || applied.empty() || ModeKey_(it->second) == applied)
+        return "";
+
+    return applied;
+}
+
+std::string shared_device::ModeKey_(const StreamConfig &config)
+{
+    int fps_idx = std::clamp(config.fps_idx, 0, (int)config.fps_list.size() - 1);
+    return config.str_resolution + " @ " + std::to_string(config.fps_list.at(fps_idx)) + " fps";
+}
+
+void shared_device::ApplyRequests_(dai::CameraBoardSocket stream)
+{
+    auto &requests = (stream == dai::CameraBoardSocket::RGB) ? color_requests_ : depth_requests_;
+    auto &applied = (stream == dai::CameraBoardSocket::RGB) ? color_applied_ : depth_applied_;
+    if (requests.empty()) {
+        if (!applied.empty()) {
+            camera_->DisableStream(stream);
+            applied.clear();
+        }
+        return;
+    }
+
+    // Largest requested mode at the highest requested rate it supports, smaller requests are served from it
+    const StreamConfig *largest = nullptr;
+    int fps = 0;
+    for (const auto &request : requests) {
+        const auto &cfg = request.second;
+        if (largest == nullptr || cfg.width * cfg.height > largest->width * largest->height)
+            largest = &cfg;
+        fps = std::max(fps, cfg.fps_list.at(std::clamp(cfg.fps_idx, 0, (int)cfg.fps_list.size() - 1)));
+    }
+    StreamConfig merged = *largest;
+    merged.fps_idx = (int)merged.fps_list.size() - 1;
+    for (int i = 0; i < (int)merged.fps_list.size(); i++) {
+        if (merged.fps_list[i] <= fps) {
+            merged.fps_idx = i;
+            break;
+        }
+    }
+
+    // The pipeline is only rebuilt when the combined request actually changes
+    std::string key = ModeKey_(merged);
+    if (key == applied)
+        return;
+
+    applied = key;
+    camera_->EnableStream(merged);
+}
+
+void shared_device::RequestPoints()
+{
+    points_requested_ = true;
+}
+
+const SharedFrames &shared_device::Pump(uint64_t last_seq)
+{
+    // Another instance already ran a tick this one has not seen yet
+    if (frames_.seq != last_seq)
+        return frames_;
+
+    camera_->ProcessStreams();
+    if (points_requested_) {
+        camera_->ExtractFusionPoints();
+        points_requested_ = false;
+    }
+
+    uint64_t seq = frames_.seq + 1;
+    frames_ = SharedFrames();
+    frames_.seq = seq;
+    if (!camera_->IsReconfiguring()) {
+        frames_.rgb = camera_->GetFrame(dai::CameraBoardSocket::RGB);
+        frames_.depth = camera_->GetFrame(dai::CameraBoardSocket::AUTO);
+        frames_.metadata = camera_->GetMetaData();
+        frames_.rgb_undistorted = camera_->GetUndistortedFrame();
+        frames_.depth_registered = camera_->GetRegisteredFrame();
+        frames_.rgb_preview = camera_->GetPreviewFrame();
+        frames_.depth_rvl = camera_->GetCompressedDepthFrame();
+        frames_.scan = camera_->GetScanData();
+        frames_.features = camera_->GetFeatureData();
+        frames_.still = camera_->GetStillFrame();
+        frames_.spatial = camera_->GetSpatialData();
+        frames_.points = camera_->GetFusionPoints();
+        frames_.mask = camera_->GetMaskFrame();
+        frames_.rgb_masked = camera_->GetMaskedColorFrame();
+    }
+
+    return frames_;
+}
+
+device_registry::device_registry()
+{
+    next_client_id_ = 0;
+}
+
+device_registry &device_registry::Instance()
+{
+    static device_registry registry;
+    return registry;
+}
+
+std::shared_ptr<shared_device> device_registry::Acquire(const std::string &mxid)
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    for (auto it = devices_.begin(); it != devices_.end();) {
+        if (it->second.expired())
+            it = devices_.erase(it);
+        else
+            ++it;
+    }
+
+    // The last holder may let go at any time, only a successful lock counts as a hit
+    auto it = devices_.find(mxid);
+    if (it != devices_.end()) {
+        auto device = it->second.lock();
+        if (device != nullptr)
+            return device;
+    }
+
+    auto device = std::make_shared<shared_device>(mxid);
+    devices_[mxid] = device;
+
+    return device;
+}
+
+std::vector<std::string> device_registry::GetOpenMxIds()
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    std::vector<std::string> mxids;
+    for (const auto &entry : devices_) {
+        if (!entry.first.empty() && !entry.second.expired())
+            mxids.emplace_back(entry.first);
+    }
+
+    return mxids;
+}
+
+int device_registry::NewClientId()
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    return next_client_id_++;
+}
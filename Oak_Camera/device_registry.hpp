@@ -0,0 +1,94 @@
+//
+// Oak Shared Device Registry
+//
+// One oak_camera per physical device, keyed by mxid and shared by every node
+// instance that selects it. The stream requests of the attached instances are
+// merged into one pipeline, and each tick's outputs are handed to all of them
+// as Mat headers over the same buffers.
+//
+
+#ifndef FLOWCV_PLUGIN_DEVICE_REGISTRY_HPP_
+#define FLOWCV_PLUGIN_DEVICE_REGISTRY_HPP_
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include "oak_camera.hpp"
+
+// Outputs of one processing tick, Mats share their buffers with the camera and every other instance
+struct SharedFrames
+{
+    uint64_t seq;
+    cv::Mat rgb;
+    cv::Mat depth;
+    nlohmann::json metadata;
+    cv::Mat rgb_undistorted;
+    cv::Mat depth_registered;
+    cv::Mat rgb_preview;
+    cv::Mat depth_rvl;
+    nlohmann::json scan;
+    nlohmann::json features;
+    cv::Mat still;
+    nlohmann::json spatial;
+    cv::Mat points;
+    cv::Mat mask;
+    cv::Mat rgb_masked;
+};
+
+class shared_device {
+  public:
+    explicit shared_device(std::string mxid);
+    shared_device(const shared_device &) = delete;
+    shared_device &operator=(const shared_device &) = delete;
+
+    // Everything below requires Mutex() to be held
+    std::mutex &Mutex();
+    oak_camera &Camera();
+    [[nodiscard]] const std::string &GetMxId() const;
+    bool Open();
+    void AddClient(int client);
+    void RemoveClient(int client);
+    [[nodiscard]] size_t GetClientCount() const;
+    void SetStreamRequest(int client, const StreamConfig &config);
+    void ClearStreamRequest(int client, dai::CameraBoardSocket stream);
+    // Mode the stream runs in when it is not the one the client asked for, empty otherwise
+    [[nodiscard]] std::string GetOverriddenMode(int client, dai::CameraBoardSocket stream) const;
+    void RequestPoints();
+    const SharedFrames &Pump(uint64_t last_seq);
+
+  private:
+    void ApplyRequests_(dai::CameraBoardSocket stream);
+    static std::string ModeKey_(const StreamConfig &config);
+
+    std::mutex mutex_;
+    std::string mxid_;
+    std::unique_ptr<oak_camera> camera_;
+    std::set<int> clients_;
+    std::map<int, StreamConfig> color_requests_;
+    std::map<int, StreamConfig> depth_requests_;
+    std::string color_applied_;
+    std::string depth_applied_;
+    bool points_requested_;
+    SharedFrames frames_;
+};
+
+class device_registry {
+  public:
+    static device_registry &Instance();
+    std::shared_ptr<shared_device> Acquire(const std::string &mxid);
+    // Serials of the devices some node currently holds
+    std::vector<std::string> GetOpenMxIds();
+    int NewClientId();
+
+  private:
+    device_registry();
+
+    // Entries expire with the last instance holding the device, which closes it
+    std::mutex mutex_;
+    std::map<std::string, std::weak_ptr<shared_device>> devices_;
+    int next_client_id_;
+};
+
+#endif //FLOWCV_PLUGIN_DEVICE_REGISTRY_HPP_
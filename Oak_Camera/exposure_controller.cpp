@@ -0,0 +1,203 @@
+//
+// Oak Host Auto Exposure
+//
+
+#include "exposure_controller.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EXPOSURE_CONTROLLER_SSE2
+#include <emmintrin.h>
+#endif
+
+// Y is gamma encoded, exposure has to change by roughly the ratio to this power to move the mean by the ratio
+static constexpr double kGamma = 2.2;
+// Share of the step taken each update, and the error within which exposure is left alone
+static constexpr double kStepGain = 0.8;
+static constexpr double kDeadBand = 0.06;
+static constexpr double kMaxStep = 16.0;
+// Share of the region at or above kClipLevel that counts as blown out highlights
+static constexpr int kClipLevel = 250;
+static constexpr double kClipLimit = 0.05;
+// Only every other row is sampled, plenty for a mean
+static constexpr int kRowStep = 2;
+
+exposure_controller::exposure_controller()
+{
+    region_ = cv::Rect2f(0.0f, 0.0f, 1.0f, 1.0f);
+    target_ = 110;
+    flicker_ = Flicker_Off;
+    min_exposure_us_ = 1;
+    max_exposure_us_ = 33000;
+    min_iso_ = 100;
+    max_iso_ = 1600;
+    Reset();
+}
+
+void exposure_controller::Reset()
+{
+    mean_ = 0.0;
+    clipped_ = 0.0;
+    exposure_us_ = 0;
+    iso_ = 0;
+    converged_ = false;
+}
+
+void exposure_controller::SetRegion(const cv::Rect2f &region)
+{
+    region_ = region & cv::Rect2f(0.0f, 0.0f, 1.0f, 1.0f);
+    if (region_.width <= 0.0f || region_.height <= 0.0f)
+        region_ = cv::Rect2f(0.0f, 0.0f, 1.0f, 1.0f);
+}
+
+const cv::Rect2f &exposure_controller::GetRegion() const
+{
+    return region_;
+}
+
+void exposure_controller::SetTarget(int luma)
+{
+    target_ = std::clamp(luma, 16, 240);
+}
+
+int exposure_controller::GetTarget() const
+{
+    return target_;
+}
+
+void exposure_controller::SetFlicker(int mode)
+{
+    flicker_ = std::clamp(mode, (int)Flicker_Off, (int)Flicker_60Hz);
+}
+
+int exposure_controller::GetFlicker() const
+{
+    return flicker_;
+}
+
+void exposure_controller::SetLimits(int min_exposure_us, int max_exposure_us, int min_iso, int max_iso)
+{
+    min_exposure_us_ = std::max(1, min_exposure_us);
+    max_exposure_us_ = std::max(min_exposure_us_, max_exposure_us);
+    min_iso_ = std::max(1, min_iso);
+    max_iso_ = std::max(min_iso_, max_iso);
+}
+
+void exposure_controller::Measure_(const uint8_t *y, int width, int height, int stride, uint64_t &count, uint64_t &sum,
+                                   uint64_t &clipped) const
+{
+    count = sum = clipped = 0;
+    for (int row = 0; row < height; row += kRowStep) {
+        const uint8_t *src = y + (size_t)row * stride;
+        int x = 0;
+#ifdef EXPOSURE_CONTROLLER_SSE2
+        // Sums of absolute differences against zero add 8 bytes into each 64 bit half, clipped bytes compare to
+        // all ones and are counted by subtracting, at most 255 per byte lane before they are folded the same way
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i clip_level = _mm_set1_epi8((char)kClipLevel);
+        __m128i sum_acc = zero;
+        __m128i clip_acc = zero;
+        __m128i clip_bytes = zero;
+        int lane_count = 0;
+        for (; x + 16 <= width; x += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(src + x));
+            sum_acc = _mm_add_epi64(sum_acc, _mm_sad_epu8(v, zero));
+            clip_bytes = _mm_sub_epi8(clip_bytes, _mm_cmpeq_epi8(_mm_max_epu8(v, clip_level), v));
+            if (++lane_count == 255) {
+                clip_acc = _mm_add_epi64(clip_acc, _mm_sad_epu8(clip_bytes, zero));
+                clip_bytes = zero;
+                lane_count = 0;
+            }
+        }
+        clip_acc = _mm_add_epi64(clip_acc, _mm_sad_epu8(clip_bytes, zero));
+        alignas(16) uint64_t lanes[2];
+        _mm_store_si128((__m128i *)lanes, sum_acc);
+        sum += lanes[0] + lanes[1];
+        _mm_store_si128((__m128i *)lanes, clip_acc);
+        clipped += lanes[0] + lanes[1];
+#endif
+        for (; x < width; x++) {
+            sum += src[x];
+            clipped += (src[x] >= kClipLevel);
+        }
+        count += (uint64_t)width;
+    }
+}
+
+void exposure_controller::Split_(double total)
+{
+    // Longest exposure first for the least noise, ISO makes up the rest
+    double exposure = std::clamp(total / min_iso_, (double)min_exposure_us_, (double)max_exposure_us_);
+    if (flicker_ != Flicker_Off) {
+        // Light intensity repeats every half mains period, whole multiples of it integrate the same amount
+        double period = (flicker_ == Flicker_50Hz) ? 10000.0 : 1e6 / 120.0;
+        if (exposure >= period)
+            exposure = std::floor(exposure / period) * period;
+    }
+    exposure_us_ = (int)std::lround(exposure);
+    iso_ = std::clamp((int)std::lround(total / exposure), min_iso_, max_iso_);
+}
+
+bool exposure_controller::Update(const uint8_t *y, int width, int height, int stride, int exposure_us, int iso)
+{
+    if (y == nullptr || width <= 0 || height <= 0)
+        return false;
+
+    int x0 = std::clamp((int)(region_.x * width), 0, width - 1);
+    int y0 = std::clamp((int)(region_.y * height), 0, height - 1);
+    int x1 = std::clamp((int)((region_.x + region_.width) * width), x0 + 1, width);
+    int y1 = std::clamp((int)((region_.y + region_.height) * height), y0 + 1, height);
+    uint64_t count, sum, clipped;
+    Measure_(y + (size_t)y0 * stride + x0, x1 - x0, y1 - y0, stride, count, sum, clipped);
+    if (count == 0)
+        return false;
+
+    mean_ = (double)sum / (double)count;
+    clipped_ = (double)clipped / (double)count;
+
+    // Start from what the frame was actually captured with so a dropped or late control cannot wind up
+    if (exposure_us <= 0 || iso <= 0) {
+        exposure_us = exposure_us_ > 0 ? exposure_us_ : max_exposure_us_ / 2;
+        iso = iso_ > 0 ? iso_ : min_iso_;
+    }
+    double error = std::log((double)target_ / std::max(mean_, 1.0));
+    // Blown highlights pull the mean down less than they should, never brighten while too many are clipped
+    if (clipped_ > kClipLimit)
+        error = std::min(error, -kDeadBand * 2.0);
+    converged_ = std::abs(error) < kDeadBand;
+    if (converged_)
+        return false;
+
+    double step = std::clamp(std::exp(error * kGamma * kStepGain), 1.0 / kMaxStep, kMaxStep);
+    int last_exposure = exposure_us_;
+    int last_iso = iso_;
+    Split_((double)exposure_us * (double)iso * step);
+
+    return exposure_us_ != last_exposure || iso_ != last_iso;
+}
+
+int exposure_controller::GetExposure() const
+{
+    return exposure_us_;
+}
+
+int exposure_controller::GetIso() const
+{
+    return iso_;
+}
+
+double exposure_controller::GetMean() const
+{
+    return mean_;
+}
+
+double exposure_controller::GetClipped() const
+{
+    return clipped_;
+}
+
+bool exposure_controller::IsConverged() const
+{
+    return converged_;
+}
@@ -0,0 +1,61 @@
+//
+// Oak Host Auto Exposure
+//
+// Drives exposure time and ISO from the mean luma and the share of clipped
+// pixels in a region of the Y plane. Each step jumps most of the way to the target brightness using
+// the exposure the frame was actually captured with, and exposure times
+// longer than a mains half period are snapped to whole half periods so
+// artificial light does not flicker between frames.
+//
+
+#ifndef FLOWCV_PLUGIN_EXPOSURE_CONTROLLER_HPP_
+#define FLOWCV_PLUGIN_EXPOSURE_CONTROLLER_HPP_
+#include <cstdint>
+#include "opencv2/opencv.hpp"
+
+class exposure_controller {
+  public:
+    enum Flicker {
+        Flicker_Off = 0,
+        Flicker_50Hz,
+        Flicker_60Hz
+    };
+
+    exposure_controller();
+    void Reset();
+    void SetRegion(const cv::Rect2f &region);
+    [[nodiscard]] const cv::Rect2f &GetRegion() const;
+    void SetTarget(int luma);
+    [[nodiscard]] int GetTarget() const;
+    void SetFlicker(int mode);
+    [[nodiscard]] int GetFlicker() const;
+    void SetLimits(int min_exposure_us, int max_exposure_us, int min_iso, int max_iso);
+
+    // Y plane of the frame and the exposure it was captured with, returns true when a new exposure was chosen
+    bool Update(const uint8_t *y, int width, int height, int stride, int exposure_us, int iso);
+    [[nodiscard]] int GetExposure() const;
+    [[nodiscard]] int GetIso() const;
+    [[nodiscard]] double GetMean() const;
+    [[nodiscard]] double GetClipped() const;
+    [[nodiscard]] bool IsConverged() const;
+
+  private:
+    void Measure_(const uint8_t *y, int width, int height, int stride, uint64_t &count, uint64_t &sum, uint64_t &clipped) const;
+    void Split_(double total);
+
+    cv::Rect2f region_;
+    int target_;
+    int flicker_;
+    int min_exposure_us_;
+    int max_exposure_us_;
+    int min_iso_;
+    int max_iso_;
+
+    double mean_;
+    double clipped_;
+    int exposure_us_;
+    int iso_;
+    bool converged_;
+};
+
+#endif //FLOWCV_PLUGIN_EXPOSURE_CONTROLLER_HPP_
@@ -0,0 +1,133 @@
+//
+// Oak Adaptive Frame Rate Governor
+//
+
+#include "fps_governor.hpp"
+#include <algorithm>
+#include <cmath>
+
+static constexpr int kWindowMs = 1000;
+// Superseded share above which the consumer is considered behind, and below which it may be keeping up
+static constexpr double kDropHigh = 0.2;
+static constexpr double kDropLow = 0.02;
+// Share of time spent waiting for frames that counts as headroom
+static constexpr double kIdleHigh = 0.3;
+// Consecutive idle windows before the rate is raised, and the step taken
+static constexpr int kRaiseWindows = 2;
+static constexpr float kRaiseFactor = 1.25f;
+static constexpr float kLowerMargin = 0.9f;
+
+fps_governor::fps_governor()
+{
+    min_fps_ = 5;
+    max_fps_ = 120;
+    Reset(30.0f);
+}
+
+void fps_governor::Reset(float source_fps)
+{
+    source_fps_ = source_fps;
+    target_fps_ = ClampFps_(source_fps);
+    raise_windows_ = 0;
+    window_start_ = std::chrono::steady_clock::now();
+    calls_ = 0;
+    received_ = 0;
+    superseded_ = 0;
+    wait_ms_ = 0.0;
+    call_rate_ = 0.0;
+    drop_ratio_ = 0.0;
+    idle_ratio_ = 0.0;
+}
+
+void fps_governor::SetBounds(int min_fps, int max_fps)
+{
+    min_fps_ = std::max(1, min_fps);
+    max_fps_ = std::max(min_fps_, max_fps);
+    target_fps_ = ClampFps_(target_fps_);
+}
+
+int fps_governor::GetMinFps() const
+{
+    return min_fps_;
+}
+
+int fps_governor::GetMaxFps() const
+{
+    return max_fps_;
+}
+
+float fps_governor::ClampFps_(float fps) const
+{
+    return std::clamp(fps, (float)std::min(min_fps_, (int)source_fps_), std::min((float)max_fps_, source_fps_));
+}
+
+void fps_governor::AddSample(int received, int superseded, double wait_ms)
+{
+    calls_++;
+    received_ += received;
+    superseded_ += superseded;
+    wait_ms_ += wait_ms;
+}
+
+bool fps_governor::Update()
+{
+    auto now = std::chrono::steady_clock::now();
+    double elapsed_ms = std::chrono::duration<double, std::milli>(now - window_start_).count();
+    if (elapsed_ms < kWindowMs)
+        return false;
+
+    call_rate_ = calls_ * 1000.0 / elapsed_ms;
+    drop_ratio_ = received_ > 0 ? (double)superseded_ / received_ : 0.0;
+    idle_ratio_ = std::min(1.0, wait_ms_ / elapsed_ms);
+    if (drop_ratio_ > kDropHigh) {
+        // Consumer is behind, drop straight to what it managed this window
+        target_fps_ = ClampFps_(std::min(target_fps_, (float)call_rate_) * kLowerMargin);
+        raise_windows_ = 0;
+    }
+    else if (drop_ratio_ < kDropLow && idle_ratio_ > kIdleHigh) {
+        if (++raise_windows_ >= kRaiseWindows) {
+            target_fps_ = ClampFps_(target_fps_ * kRaiseFactor);
+            raise_windows_ = 0;
+        }
+    }
+    else {
+        raise_windows_ = 0;
+    }
+
+    window_start_ = now;
+    calls_ = 0;
+    received_ = 0;
+    superseded_ = 0;
+    wait_ms_ = 0.0;
+
+    return true;
+}
+
+float fps_governor::GetTargetFps() const
+{
+    return target_fps_;
+}
+
+double fps_governor::GetCallRate() const
+{
+    return call_rate_;
+}
+
+double fps_governor::GetDropRatio() const
+{
+    return drop_ratio_;
+}
+
+double fps_governor::GetIdleRatio() const
+{
+    return idle_ratio_;
+}
+
+int fps_governor::GetSkip(float stream_fps, float target_fps)
+{
+    if (target_fps <= 0.0f)
+        return 1;
+
+    // Forward every Nth frame, delivering at most the target rate
+    return std::clamp((int)std::ceil(stream_fps / target_fps - 0.001f), 1, 255);
+}
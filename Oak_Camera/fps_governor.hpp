@@ -0,0 +1,51 @@
+//
+// Oak Adaptive Frame Rate Governor
+//
+// Watches how fast the graph consumes frames and how many are superseded
+// before it gets to them, and picks a delivered frame rate within user set
+// bounds: dropped quickly to the measured consumer rate under backpressure,
+// raised gradually once the consumer is idle again.
+//
+
+#ifndef FLOWCV_PLUGIN_FPS_GOVERNOR_HPP_
+#define FLOWCV_PLUGIN_FPS_GOVERNOR_HPP_
+#include <chrono>
+
+class fps_governor {
+  public:
+    fps_governor();
+    void Reset(float source_fps);
+    void SetBounds(int min_fps, int max_fps);
+    [[nodiscard]] int GetMinFps() const;
+    [[nodiscard]] int GetMaxFps() const;
+    void AddSample(int received, int superseded, double wait_ms);
+    bool Update();
+    [[nodiscard]] float GetTargetFps() const;
+    [[nodiscard]] double GetCallRate() const;
+    [[nodiscard]] double GetDropRatio() const;
+    [[nodiscard]] double GetIdleRatio() const;
+    static int GetSkip(float stream_fps, float target_fps);
+
+  private:
+    float ClampFps_(float fps) const;
+
+    int min_fps_;
+    int max_fps_;
+    float source_fps_;
+    float target_fps_;
+    int raise_windows_;
+
+    // Current measurement window
+    std::chrono::steady_clock::time_point window_start_;
+    int calls_;
+    int received_;
+    int superseded_;
+    double wait_ms_;
+
+    // Last completed window
+    double call_rate_;
+    double drop_ratio_;
+    double idle_ratio_;
+};
+
+#endif //FLOWCV_PLUGIN_FPS_GOVERNOR_HPP_
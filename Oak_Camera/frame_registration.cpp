@@ -0,0 +1,218 @@
+//
+// Oak Host Undistortion and RGB-D Registration
+//
+
+#include "frame_registration.hpp"
+#include <algorithm>
+#include <cmath>
+
+frame_registration::frame_registration()
+{
+    Reset();
+}
+
+void frame_registration::Reset()
+{
+    color_k_.clear();
+    color_dist_.clear();
+    color_size_ = cv::Size();
+    map_xy_.release();
+    map_interp_.release();
+    depth_k_.clear();
+    depth_rect_.clear();
+    depth_ext_.clear();
+    depth_size_ = cv::Size();
+    depth_rays_.release();
+    target_idx_.release();
+    for (int i = 0; i < 9; i++)
+        rot_[i] = (i % 4 == 0) ? 1.0f : 0.0f;
+    trans_[0] = trans_[1] = trans_[2] = 0.0f;
+    splat_ = 1;
+}
+
+void frame_registration::SetColorCalibration(const std::vector<std::vector<float>> &intrinsics, const std::vector<float> &distortion, int width, int height)
+{
+    cv::Size size(width, height);
+    if (intrinsics == color_k_ && distortion == color_dist_ && size == color_size_)
+        return;
+
+    color_k_ = intrinsics;
+    color_dist_ = distortion;
+    color_size_ = size;
+    map_xy_.release();
+    map_interp_.release();
+    if (color_k_.size() != 3 || color_size_.empty())
+        return;
+
+    cv::Mat k(3, 3, CV_64F);
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++)
+            k.at<double>(r, c) = color_k_[r][c];
+    }
+    cv::Mat d;
+    if (!color_dist_.empty()) {
+        d.create(1, (int)color_dist_.size(), CV_64F);
+        for (int i = 0; i < (int)color_dist_.size(); i++)
+            d.at<double>(i) = color_dist_[i];
+    }
+
+    // Undistorted view keeps the original camera matrix so it shares intrinsics with the registered depth,
+    // CV_16SC2 maps make remap use its fixed-point interpolation path
+    cv::initUndistortRectifyMap(k, d, cv::Mat(), k, color_size_, CV_16SC2, map_xy_, map_interp_);
+    UpdateTransform_();
+}
+
+void frame_registration::SetDepthCalibration(const std::vector<std::vector<float>> &intrinsics, const std::vector<std::vector<float>> &rectification,
+                                             const std::vector<std::vector<float>> &extrinsics, int width, int height)
+{
+    cv::Size size(width, height);
+    if (intrinsics == depth_k_ && rectification == depth_rect_ && extrinsics == depth_ext_ && size == depth_size_)
+        return;
+
+    depth_k_ = intrinsics;
+    depth_rect_ = rectification;
+    depth_ext_ = extrinsics;
+    depth_size_ = size;
+    depth_rays_.release();
+    if (depth_k_.size() != 3 || depth_size_.empty())
+        return;
+
+    // Normalized ray per depth pixel, depth is already rectified so no distortion applies
+    float fx = depth_k_[0][0];
+    float fy = depth_k_[1][1];
+    float cx = depth_k_[0][2];
+    float cy = depth_k_[1][2];
+    depth_rays_.create(depth_size_, CV_32FC2);
+    for (int v = 0; v < depth_size_.height; v++) {
+        auto *ray = depth_rays_.ptr<float>(v);
+        for (int u = 0; u < depth_size_.width; u++) {
+            ray[2 * u] = ((float)u - cx) / fx;
+            ray[2 * u + 1] = ((float)v - cy) / fy;
+        }
+    }
+    UpdateTransform_();
+}
+
+void frame_registration::UpdateTransform_()
+{
+    if (depth_ext_.size() < 3 || depth_ext_[0].size() < 4)
+        return;
+
+    // Depth points live in the rectified right frame: P_color = R_ext * R_rect^T * P_rect + t_ext
+    float rect[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+    if (depth_rect_.size() == 3) {
+        for (int r = 0; r < 3; r++) {
+            for (int c = 0; c < 3; c++)
+                rect[r * 3 + c] = depth_rect_[r][c];
+        }
+    }
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+            float sum = 0.0f;
+            for (int k = 0; k < 3; k++)
+                sum += depth_ext_[r][k] * rect[c * 3 + k];
+            rot_[r * 3 + c] = sum;
+        }
+        // Extrinsic translation is stored in centimeters, depth is in millimeters
+        trans_[r] = depth_ext_[r][3] * 10.0f;
+    }
+
+    // Fill the gaps left when the color image has a higher angular resolution than depth
+    splat_ = 1;
+    if (color_k_.size() == 3 && depth_k_.size() == 3 && depth_k_[0][0] > 0.0f) {
+        float ratio = color_k_[0][0] / depth_k_[0][0];
+        splat_ = std::min(4, std::max(1, (int)std::ceil(ratio - 0.25f)));
+    }
+}
+
+bool frame_registration::CanUndistort() const
+{
+    return !map_xy_.empty();
+}
+
+bool frame_registration::CanRegister() const
+{
+    return !depth_rays_.empty() && color_k_.size() == 3 && !color_size_.empty() && depth_ext_.size() >= 3;
+}
+
+void frame_registration::Undistort(const cv::Mat &src, cv::Mat &dst) const
+{
+    if (!CanUndistort() || src.size() != color_size_) {
+        dst.release();
+        return;
+    }
+
+    // Always write into a fresh buffer, the previous output may still be referenced downstream
+    cv::Mat out;
+    cv::remap(src, out, map_xy_, map_interp_, cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+    dst = out;
+}
+
+void frame_registration::Register(const cv::Mat &depth, cv::Mat &dst)
+{
+    if (!CanRegister() || depth.type() != CV_16UC1 || depth.size() != depth_size_) {
+        dst.release();
+        return;
+    }
+
+    const float fx = color_k_[0][0];
+    const float fy = color_k_[1][1];
+    const float cx = color_k_[0][2];
+    const float cy = color_k_[1][2];
+    const int cw = color_size_.width;
+    const int ch = color_size_.height;
+
+    // Project every depth pixel into the color image in parallel, target index and depth are packed together
+    target_idx_.create(depth_size_, CV_32SC2);
+    cv::parallel_for_(cv::Range(0, depth.rows), [&](const cv::Range &range) {
+        for (int v = range.start; v < range.end; v++) {
+            const auto *z_row = depth.ptr<uint16_t>(v);
+            const auto *ray = depth_rays_.ptr<float>(v);
+            auto *target = target_idx_.ptr<int32_t>(v);
+            for (int u = 0; u < depth.cols; u++) {
+                target[2 * u] = -1;
+                if (z_row[u] == 0)
+                    continue;
+                float z = z_row[u];
+                float x = ray[2 * u] * z;
+                float y = ray[2 * u + 1] * z;
+                float cz = rot_[6] * x + rot_[7] * y + rot_[8] * z + trans_[2];
+                if (cz <= 0.0f)
+                    continue;
+                float cxp = rot_[0] * x + rot_[1] * y + rot_[2] * z + trans_[0];
+                float cyp = rot_[3] * x + rot_[4] * y + rot_[5] * z + trans_[1];
+                float pu = fx * cxp / cz + cx;
+                float pv = fy * cyp / cz + cy;
+                if (pu < 0.0f || pv < 0.0f || pu >= (float)cw || pv >= (float)ch)
+                    continue;
+                target[2 * u] = (int32_t)pv * cw + (int32_t)pu;
+                target[2 * u + 1] = (int32_t)std::min(cz + 0.5f, 65535.0f);
+            }
+        }
+    });
+
+    // Scatter with a z-test so the nearest surface wins where projections collide
+    cv::Mat out(color_size_, CV_16UC1, cv::Scalar(0));
+    auto *out_data = out.ptr<uint16_t>();
+    for (int v = 0; v < depth_size_.height; v++) {
+        const auto *target = target_idx_.ptr<int32_t>(v);
+        for (int u = 0; u < depth_size_.width; u++) {
+            int32_t idx = target[2 * u];
+            if (idx < 0)
+                continue;
+            auto z = (uint16_t)target[2 * u + 1];
+            int tv = idx / cw;
+            int tu = idx - tv * cw;
+            int v_end = std::min(tv + splat_, ch);
+            int u_end = std::min(tu + splat_, cw);
+            for (int sv = tv; sv < v_end; sv++) {
+                uint16_t *px = out_data + (size_t)sv * cw;
+                for (int su = tu; su < u_end; su++) {
+                    if (px[su] == 0 || z < px[su])
+                        px[su] = z;
+                }
+            }
+        }
+    }
+    dst = out;
+}
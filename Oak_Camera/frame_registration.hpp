@@ -0,0 +1,46 @@
+//
+// Oak Host Undistortion and RGB-D Registration
+//
+
+#ifndef FLOWCV_PLUGIN_FRAME_REGISTRATION_HPP_
+#define FLOWCV_PLUGIN_FRAME_REGISTRATION_HPP_
+#include <vector>
+#include "opencv2/opencv.hpp"
+
+class frame_registration {
+  public:
+    frame_registration();
+    void Reset();
+    void SetColorCalibration(const std::vector<std::vector<float>> &intrinsics, const std::vector<float> &distortion, int width, int height);
+    void SetDepthCalibration(const std::vector<std::vector<float>> &intrinsics, const std::vector<std::vector<float>> &rectification,
+                             const std::vector<std::vector<float>> &extrinsics, int width, int height);
+    [[nodiscard]] bool CanUndistort() const;
+    [[nodiscard]] bool CanRegister() const;
+    void Undistort(const cv::Mat &src, cv::Mat &dst) const;
+    void Register(const cv::Mat &depth, cv::Mat &dst);
+
+  private:
+    void UpdateTransform_();
+
+    // Color calibration, maps are rebuilt only when any of these change
+    std::vector<std::vector<float>> color_k_;
+    std::vector<float> color_dist_;
+    cv::Size color_size_;
+    cv::Mat map_xy_;
+    cv::Mat map_interp_;
+
+    // Depth (rectified right) calibration
+    std::vector<std::vector<float>> depth_k_;
+    std::vector<std::vector<float>> depth_rect_;
+    std::vector<std::vector<float>> depth_ext_;
+    cv::Size depth_size_;
+    cv::Mat depth_rays_;
+    float rot_[9];
+    float trans_[3];
+    int splat_;
+
+    // Per frame scratch buffers
+    cv::Mat target_idx_;
+};
+
+#endif //FLOWCV_PLUGIN_FRAME_REGISTRATION_HPP_
@@ -0,0 +1,40 @@
+//
+// Oak Camera Frame Source
+//
+// Stands in for the device side of the frame output queues, so the host side
+// processing of oak_camera can be driven without a device (tests/oak_soak.cpp).
+// Streams are named like the XLink queues they replace, controls and stereo
+// configs that would go out to the device are handed to the source instead.
+//
+
+#ifndef FLOWCV_PLUGIN_FRAME_SOURCE_HPP_
+#define FLOWCV_PLUGIN_FRAME_SOURCE_HPP_
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include "depthai/depthai.hpp"
+
+struct FrameStreamInfo {
+    std::string name;
+    int width;
+    int height;
+    int fps;
+    dai::ImgFrame::Type type;
+};
+
+class frame_source {
+  public:
+    virtual ~frame_source() = default;
+
+    // Called on every rebuild with the frame streams the new configuration outputs
+    virtual void Start(const std::vector<FrameStreamInfo> &streams) = 0;
+    // True once a frame is waiting on any of the streams, false on timeout
+    virtual bool Wait(const std::vector<std::string> &names, std::chrono::milliseconds timeout) = 0;
+    virtual std::vector<std::shared_ptr<dai::ImgFrame>> TryGetAll(const std::string &name) = 0;
+    virtual void SetQueueDepth(const std::string &name, int depth) = 0;
+    virtual void SendControl(const dai::CameraControl &ctrl) = 0;
+    virtual void SendStereoConfig(const dai::StereoDepthConfig &cfg) = 0;
+};
+
+#endif //FLOWCV_PLUGIN_FRAME_SOURCE_HPP_
@@ -0,0 +1,111 @@
+//
+// Oak Host Memory Budget
+//
+
+#include "memory_budget.hpp"
+#include <algorithm>
+
+static constexpr int kWindowMs = 1000;
+// Windows to wait after raising the level so the next measurement sees its effect (a rebuild refills the queues)
+static constexpr int kSettleWindows = 3;
+static constexpr int kQueueDepths[] = {4, 2, 1};
+static const char *kLevelNames[] = {"none", "queue_2", "queue_1", "no_derived", "fusion", "resolution"};
+
+memory_budget::memory_budget()
+{
+    budget_mb_ = 0;
+    usage_ = MemoryUsage();
+    Reset();
+}
+
+void memory_budget::Reset()
+{
+    level_ = MemoryLevel_None;
+    settle_ = 0;
+    window_start_ = std::chrono::steady_clock::now();
+}
+
+void memory_budget::SetBudget(int budget_mb)
+{
+    budget_mb = std::max(0, budget_mb);
+    if (budget_mb == budget_mb_)
+        return;
+
+    // A new budget starts over from full quality
+    budget_mb_ = budget_mb;
+    Reset();
+}
+
+int memory_budget::GetBudget() const
+{
+    return budget_mb_;
+}
+
+int memory_budget::GetLevel() const
+{
+    return level_;
+}
+
+int memory_budget::GetQueueDepth() const
+{
+    return kQueueDepths[std::min(level_, (int)MemoryLevel_Queue1)];
+}
+
+bool memory_budget::DropDerived() const
+{
+    return level_ >= MemoryLevel_NoDerived;
+}
+
+int memory_budget::GetResolutionSteps() const
+{
+    return std::max(0, level_ - (int)MemoryLevel_Resolution + 1);
+}
+
+const char *memory_budget::GetLevelName(int level)
+{
+    return kLevelNames[std::clamp(level, 0, (int)MemoryLevel_Resolution)];
+}
+
+size_t memory_budget::MatBytes(const cv::Mat &mat)
+{
+    // A view keeps the whole allocation alive, Mats wrapping outside data have none and count the span they cover
+    if (mat.empty())
+        return 0;
+    if (mat.u != nullptr)
+        return mat.u->size;
+
+    return (size_t)(mat.dataend - mat.datastart);
+}
+
+bool memory_budget::IsDue()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (now - window_start_ < std::chrono::milliseconds(kWindowMs))
+        return false;
+
+    window_start_ = now;
+    return true;
+}
+
+bool memory_budget::Update(const MemoryUsage &usage, bool can_step)
+{
+    usage_ = usage;
+    if (settle_ > 0) {
+        settle_--;
+        return false;
+    }
+    if (budget_mb_ <= 0 || usage.Total() <= (size_t)budget_mb_ * 1024 * 1024)
+        return false;
+    if (level_ >= MemoryLevel_Resolution - 1 && !can_step)
+        return false;
+
+    level_++;
+    settle_ = kSettleWindows;
+
+    return true;
+}
+
+const MemoryUsage &memory_budget::GetUsage() const
+{
+    return usage_;
+}
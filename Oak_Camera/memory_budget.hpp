@@ -0,0 +1,64 @@
+//
+// Oak Host Memory Budget
+//
+// Accounts the host memory a camera holds on to (its output frames, the
+// frames waiting in its XLink output queues, the metadata and the fusion
+// volume) and, when a budget is set, escalates through increasingly costly
+// measures until it fits: shallower queues, then no host derived outputs,
+// then a smaller fusion volume, then smaller stream modes one step at a time. Measures are only lifted by
+// Reset(), a budget change or a new stream request, so the camera never
+// oscillates between rebuilding at two sizes.
+//
+
+#ifndef FLOWCV_PLUGIN_MEMORY_BUDGET_HPP_
+#define FLOWCV_PLUGIN_MEMORY_BUDGET_HPP_
+#include <chrono>
+#include <cstddef>
+#include "opencv2/opencv.hpp"
+
+struct MemoryUsage {
+    size_t frames;   // Output frames read from the device
+    size_t derived;  // Outputs computed on the host from them
+    size_t queues;   // Frames the output queues may hold at their current depth
+    size_t metadata;
+    size_t fusion;
+    [[nodiscard]] size_t Total() const { return frames + derived + queues + metadata + fusion; }
+};
+
+enum MemoryLevel {
+    MemoryLevel_None = 0,
+    MemoryLevel_Queue2,
+    MemoryLevel_Queue1,
+    MemoryLevel_NoDerived,
+    MemoryLevel_Fusion,
+    MemoryLevel_Resolution // Each level past this one is one more mode step down
+};
+
+class memory_budget {
+  public:
+    memory_budget();
+    void Reset();
+    void SetBudget(int budget_mb);
+    [[nodiscard]] int GetBudget() const;
+    [[nodiscard]] int GetLevel() const;
+    [[nodiscard]] int GetQueueDepth() const;
+    [[nodiscard]] bool DropDerived() const;
+    [[nodiscard]] int GetResolutionSteps() const;
+    static const char *GetLevelName(int level);
+    static size_t MatBytes(const cv::Mat &mat);
+
+    // True once per accounting window, the caller then measures and hands the result to Update()
+    bool IsDue();
+    // Returns true when the level was raised, can_step tells whether a smaller stream mode is still available
+    bool Update(const MemoryUsage &usage, bool can_step);
+    [[nodiscard]] const MemoryUsage &GetUsage() const;
+
+  private:
+    int budget_mb_;
+    int level_;
+    int settle_;
+    MemoryUsage usage_;
+    std::chrono::steady_clock::time_point window_start_;
+};
+
+#endif //FLOWCV_PLUGIN_MEMORY_BUDGET_HPP_
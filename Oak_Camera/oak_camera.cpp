@@ -3,6 +3,310 @@
 //
 
 #include "oak_camera.hpp"
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <map>
+
+// Minimum time between two camera control transactions, pending changes are merged until it elapses
+static constexpr int kControlIntervalMs = 33;
+// A transaction took effect on the first frame reporting its exposure, ISO, lens position and color temperature
+// within this relative tolerance, values the sensor clamps never show up so the wait gives up after a while
+static constexpr double kControlMatchTolerance = 0.05;
+static constexpr int kControlApplyFrames = 30;
+
+// On-device preview widths, the height follows the aspect ratio of the active color mode
+static const int kPreviewWidths[] = {640, 480, 320, 256};
+static const char *kPreviewStreamName = "RGB_Preview";
+
+// Device health is sampled at a low rate on its own stream, outside of the frame queues
+static const char *kSysInfoStreamName = "sysinfo";
+static constexpr float kSysInfoRateHz = 1.0f;
+
+// One short wait on any of the frame queues per tick, so the device lock is never held for long
+static constexpr int kFrameWaitMs = 100;
+// Without a packet for this long, or this many of the slowest expected frame periods, the link counts as lost
+static constexpr int kLinkTimeoutMs = 3000;
+static constexpr double kLinkTimeoutFrames = 5.0;
+// Reconnect backoff range
+static constexpr int kReconnectMinBackoffMs = 250;
+static constexpr int kReconnectMaxBackoffMs = 5000;
+
+// A link that stopped delivering or closed without an XLink error, handled like one
+class link_lost_error : public std::runtime_error {
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+// Stills arrive only on request, so they are polled outside of the frame queues
+static const char *kStillStreamName = "still";
+static constexpr int kStillJpegQuality = 95;
+
+// ROI statistics travel as SpatialLocationCalculatorData messages, polled like the features
+static const char *kSpatialStreamName = "spatial";
+static const char *kSpatialConfigStream = "spatial_config";
+static const char *kSpatialAlgorithms[] = {"average", "min", "max", "mode", "median"};
+
+// Tracked features travel as TrackedFeatures messages, so they are polled outside of the frame queues
+static const char *kFeatureStreamName = "features";
+static const char *kFeatureConfigStream = "feature_config";
+
+// On-device frame skip used by the adaptive frame rate, forwards every Nth frame where N arrives as one byte on "skip"
+static const char *kColorSkipStream = "color_skip";
+static const char *kDepthSkipStream = "depth_skip";
+static const char *kFrameSkipScript = R"(
+skip = 1
+count = 0
+while True:
+    cfg = node.io['skip'].tryGet()
+    if cfg is not None:
+        skip = max(1, cfg.getData()[0])
+    frame = node.io['in'].get()
+    count += 1
+    if count >= skip:
+        count = 0
+        node.io['out'].send(frame)
+)";
+
+// On-device change gate, a tiny gray copy of the scene is compared with the one from the last forwarded frame and
+// color / depth frames pass only when the mean difference exceeds the threshold or the keep-alive runs out.
+// Config arrives as [threshold, keep-alive ms low byte, high byte], every opening sends [reason, score] on "gate"
+static const char *kGateStreamName = "gate";
+static const char *kGateConfigStream = "gate_config";
+static const cv::Size kGateSize(32, 24);
+static const char *kGateReasons[] = {"", "change", "keepalive"};
+static const char *kGateScript = R"(
+threshold = 4
+keepalive = 1.0
+ref = None
+last_sent = -1000.0
+open_color = False
+open_depth = False
+while True:
+    cfg = node.io['cfg'].tryGet()
+    if cfg is not None:
+        data = cfg.getData()
+        threshold = data[0]
+        keepalive = (data[1] | (data[2] << 8)) / 1000.0
+    small = node.io['small'].get()
+    cur = small.getData()
+    now = small.getTimestamp().total_seconds()
+    score = 255
+    if ref is not None:
+        total = 0
+        for i in range(0, len(cur), 4):
+            d = cur[i] - ref[i]
+            total += d if d >= 0 else -d
+        score = min(255, total * 4 // len(cur))
+    reason = 0
+    if score > threshold:
+        reason = 1
+    elif now - last_sent >= keepalive:
+        reason = 2
+    if reason != 0:
+        ref = cur
+        last_sent = now
+        open_color = GATE_COLOR
+        open_depth = GATE_DEPTH
+        info = Buffer(2)
+        info.setData([reason, score])
+        node.io['info'].send(info)
+    if open_color:
+        frame = node.io['color'].tryGet()
+        if frame is not None:
+            node.io['color_out'].send(frame)
+            open_color = False
+    if open_depth:
+        frame = node.io['depth'].tryGet()
+        if frame is not None:
+            node.io['depth_out'].send(frame)
+            open_depth = False
+)";
+
+// Host auto exposure flicker avoidance, indexed by exposure_controller::Flicker
+static const char *kFlickerModes[] = {"off", "50hz", "60hz"};
+
+// Median_Filter property options
+static const dai::MedianFilter kMedianModes[] = {dai::MedianFilter::MEDIAN_OFF, dai::MedianFilter::KERNEL_3x3,
+                                                 dai::MedianFilter::KERNEL_5x5, dai::MedianFilter::KERNEL_7x7};
+
+// Selectable maximum USB speeds, the device negotiates at most this
+static const dai::UsbSpeed kUsbSpeeds[] = {dai::UsbSpeed::HIGH, dai::UsbSpeed::SUPER, dai::UsbSpeed::SUPER_PLUS};
+
+static const char *GetUsbSpeedName(dai::UsbSpeed speed)
+{
+    switch (speed) {
+        case dai::UsbSpeed::LOW: return "LOW";
+        case dai::UsbSpeed::FULL: return "FULL";
+        case dai::UsbSpeed::HIGH: return "HIGH";
+        case dai::UsbSpeed::SUPER: return "SUPER";
+        case dai::UsbSpeed::SUPER_PLUS: return "SUPER_PLUS";
+        default: return "UNKNOWN";
+    }
+}
+
+// Approximate usable XLink throughput in MB/s, well below the raw signalling rate
+static double GetUsbCapacity(dai::UsbSpeed speed)
+{
+    switch (speed) {
+        case dai::UsbSpeed::LOW: return 0.1;
+        case dai::UsbSpeed::FULL: return 1.0;
+        case dai::UsbSpeed::HIGH: return 35.0;
+        case dai::UsbSpeed::SUPER: return 330.0;
+        case dai::UsbSpeed::SUPER_PLUS: return 650.0;
+        default: return 0.0; // Unknown link (e.g. PoE), not limited
+    }
+}
+
+// Sensor settings the frame was actually captured with, these lag the controls sent by a few frames
+static void AddCaptureParams(const dai::ImgFrame &frame, nlohmann::json &meta)
+{
+    meta["exposure_us"] = frame.getExposureTime().count();
+    meta["iso"] = frame.getSensitivity();
+    meta["lens_position"] = frame.getLensPosition();
+    meta["color_temperature"] = frame.getColorTemperature();
+}
+
+// Sensor sizes the ColorCamera / MonoCamera nodes can be configured for
+struct SensorModeMap
+{
+    int width;
+    int height;
+    int res_prop;
+};
+
+static const SensorModeMap kColorModes[] = {
+    {1280, 720, (int)dai::ColorCameraProperties::SensorResolution::THE_720_P},
+    {1280, 800, (int)dai::ColorCameraProperties::SensorResolution::THE_800_P},
+    {1440, 1080, (int)dai::ColorCameraProperties::SensorResolution::THE_1440X1080},
+    {1920, 1080, (int)dai::ColorCameraProperties::SensorResolution::THE_1080_P},
+    {1920, 1200, (int)dai::ColorCameraProperties::SensorResolution::THE_1200_P},
+    {2592, 1944, (int)dai::ColorCameraProperties::SensorResolution::THE_5_MP},
+    {3840, 2160, (int)dai::ColorCameraProperties::SensorResolution::THE_4_K},
+    {4000, 3000, (int)dai::ColorCameraProperties::SensorResolution::THE_4000X3000},
+    {4056, 3040, (int)dai::ColorCameraProperties::SensorResolution::THE_12_MP},
+    {4208, 3120, (int)dai::ColorCameraProperties::SensorResolution::THE_13_MP},
+    {5312, 6000, (int)dai::ColorCameraProperties::SensorResolution::THE_5312X6000},
+    {8000, 6000, (int)dai::ColorCameraProperties::SensorResolution::THE_48_MP}};
+
+static const SensorModeMap kMonoModes[] = {
+    {640, 400, (int)dai::MonoCameraProperties::SensorResolution::THE_400_P},
+    {640, 480, (int)dai::MonoCameraProperties::SensorResolution::THE_480_P},
+    {1280, 720, (int)dai::MonoCameraProperties::SensorResolution::THE_720_P},
+    {1280, 800, (int)dai::MonoCameraProperties::SensorResolution::THE_800_P},
+    {1920, 1200, (int)dai::MonoCameraProperties::SensorResolution::THE_1200_P}};
+
+template <size_t N>
+static int FindResProp(const SensorModeMap (&modes)[N], int width, int height)
+{
+    for (const auto &mode : modes) {
+        if (mode.width == width && mode.height == height)
+            return mode.res_prop;
+    }
+
+    return -1;
+}
+
+static float GetModeMaxFps(const std::vector<dai::CameraSensorConfig> &modes, int width, int height)
+{
+    float max_fps = 0.0f;
+    for (const auto &mode : modes) {
+        if (mode.width == width && mode.height == height)
+            max_fps = std::max(max_fps, mode.maxFps);
+    }
+
+    return max_fps;
+}
+
+// Mode maximum first, then the usual lower rates
+static std::vector<int> MakeFpsList(float max_fps)
+{
+    std::vector<int> fps_list{(int)max_fps};
+    for (int fps : {120, 60, 30, 15}) {
+        if (fps < fps_list.back())
+            fps_list.emplace_back(fps);
+    }
+
+    return fps_list;
+}
+
+// Sensors report one entry per mode and type, keep a single config per size with the highest frame rate
+static void AddStreamConfig(std::vector<StreamConfig> &configs, StreamConfig &&config)
+{
+    for (auto &cfg : configs) {
+        if (cfg.width == config.width && cfg.height == config.height) {
+            if (config.fps_list.front() > cfg.fps_list.front())
+                cfg.fps_list = config.fps_list;
+            return;
+        }
+    }
+    configs.emplace_back(std::move(config));
+}
+
+static void SortStreamConfigs(std::vector<StreamConfig> &configs)
+{
+    std::stable_sort(configs.begin(), configs.end(), [](const StreamConfig &a, const StreamConfig &b) {
+        return a.width * a.height > b.width * b.height;
+    });
+}
+
+// Modes of a device that does not report its sensor modes, also served by a frame source
+static void AddDefaultDepthConfigs(std::vector<StreamConfig> &configs)
+{
+    configs.emplace_back(StreamConfig{"1280 x 800", "Depth", dai::CameraBoardSocket::AUTO,
+                                      (int)dai::MonoCameraProperties::SensorResolution::THE_800_P,
+                                      1280, 800, false, 1, 1, {120, 60, 30, 15}, 0});
+    configs.emplace_back(StreamConfig{"1280 x 720", "Depth", dai::CameraBoardSocket::AUTO,
+                                      (int)dai::MonoCameraProperties::SensorResolution::THE_720_P,
+                                      1280, 720, false, 1, 1, {120, 60, 30, 15}, 0});
+    configs.emplace_back(StreamConfig{"640 x 480", "Depth", dai::CameraBoardSocket::AUTO,
+                                      (int)dai::MonoCameraProperties::SensorResolution::THE_480_P,
+                                      640, 480, false, 1, 1, {120, 60, 30, 15}, 0});
+    configs.emplace_back(StreamConfig{"640 x 400", "Depth", dai::CameraBoardSocket::AUTO,
+                                      (int)dai::MonoCameraProperties::SensorResolution::THE_400_P,
+                                      640, 400, false, 1, 1, {120, 60, 30, 15}, 0});
+}
+
+static void AddDefaultColorConfigs(std::vector<StreamConfig> &configs)
+{
+    configs.emplace_back(StreamConfig{"3840 x 2160", "RGB", dai::CameraBoardSocket::RGB,
+                                      (int)dai::ColorCameraProperties::SensorResolution::THE_4_K,
+                                      3840, 2160, false, 1, 1, {60, 30, 15}, 0});
+    configs.emplace_back(StreamConfig{"1920 x 1080", "RGB", dai::CameraBoardSocket::RGB,
+                                      (int)dai::ColorCameraProperties::SensorResolution::THE_1080_P,
+                                      1920, 1080, false, 1, 1, {60, 30, 15}, 0});
+    configs.emplace_back(StreamConfig{"1280 x 720", "RGB", dai::CameraBoardSocket::RGB,
+                                      (int)dai::ColorCameraProperties::SensorResolution::THE_1080_P,
+                                      1280, 720, true, 2, 3, {60, 30, 15}, 0});
+    configs.emplace_back(StreamConfig{"960 x 540", "RGB", dai::CameraBoardSocket::RGB,
+                                      (int)dai::ColorCameraProperties::SensorResolution::THE_1080_P,
+                                      960, 540, true, 1, 2, {60, 30, 15}, 0});
+    configs.emplace_back(StreamConfig{"640 x 360", "RGB", dai::CameraBoardSocket::RGB,
+                                      (int)dai::ColorCameraProperties::SensorResolution::THE_1080_P,
+                                      640, 360, true, 1, 3, {60, 30, 15}, 0});
+}
+
+static std::filesystem::path GetCalibCacheDir()
+{
+#ifdef _WIN32
+    const char *base = std::getenv("LOCALAPPDATA");
+#else
+    const char *base = std::getenv("XDG_CACHE_HOME");
+#endif
+    std::filesystem::path dir;
+    if (base != nullptr && *base != '\0') {
+        dir = base;
+    }
+    else {
+        const char *home = std::getenv("HOME");
+        if (home != nullptr && *home != '\0')
+            dir = std::filesystem::path(home) / ".cache";
+        else
+            dir = std::filesystem::temp_directory_path();
+    }
+
+    return dir / "flowcv" / "oak_calib";
+}
 
 oak_camera::oak_camera()
 {
@@ -16,25 +320,137 @@ oak_camera::oak_camera()
     is_init_ = false;
     reconfigure_ = false;
     change_props_ = false;
+    has_calib_ = false;
+    calib_changed_ = false;
+    calib_id_ = 0;
+    stereo_baseline_ = 0.0f;
+    control_pending_ = false;
+    control_id_ = 0;
+    control_sent_frame_num_ = -1;
+    control_frame_num_ = -1;
+    control_wait_frames_ = -1;
+    control_exposure_us_ = -1;
+    control_iso_ = -1;
+    control_lens_pos_ = -1;
+    control_color_temp_ = -1;
+    depth_align_mode_ = DepthAlign_Device;
+    undistort_color_ = false;
+    compress_depth_ = false;
+    scan_enabled_ = false;
+    mask_enabled_ = false;
+    mask_color_ = true;
+    host_ae_enabled_ = false;
+    depth_overrides_ = 0;
+    fusion_enabled_ = false;
+    fusion_incremental_ = false;
+    fusion_voxel_mm_ = 10;
+    fusion_budget_mb_ = 256;
+    fusion_shrunk_bytes_ = std::numeric_limits<size_t>::max();
+    fusion_pose_ = cv::Matx44f::eye();
+    fusion_.SetVoxelSize((float)fusion_voxel_mm_ * 0.001f);
+    fusion_.SetMemoryBudget((size_t)fusion_budget_mb_ * 1024 * 1024);
+    depth_output_enabled_ = true;
+    reconnect_stop_ = false;
+    reconnect_ready_ = false;
+    reconnect_attempts_ = 0;
+    snapshot_version_ = 0;
+    link_lost_ = false;
+    link_changed_ = false;
+    last_packet_time_ = std::chrono::steady_clock::now();
+    reconnect_count_ = 0;
+    last_downtime_ms_ = 0.0;
+    total_downtime_ms_ = 0.0;
+    spatial_enabled_ = false;
+    spatial_rois_ = {cv::Rect2f(0.45f, 0.45f, 0.1f, 0.1f)};
+    spatial_algorithm_ = (int)dai::SpatialLocationCalculatorAlgorithm::MEDIAN;
+    spatial_lower_ = 100;
+    spatial_upper_ = 10000;
+    spatial_config_changed_ = false;
+    is_spatial_streaming_ = false;
+    gate_enabled_ = false;
+    gate_threshold_ = 4;
+    gate_keepalive_ms_ = 1000;
+    gate_config_changed_ = false;
+    is_gate_streaming_ = false;
+    gate_forwarded_ = 0;
+    gate_keepalives_ = 0;
+    feature_source_ = FeatureSource_Off;
+    feature_max_ = 320;
+    feature_corner_ = (int)dai::FeatureTrackerConfig::CornerDetector::Type::HARRIS;
+    feature_motion_ = FeatureMotion_Optical_Flow;
+    feature_config_changed_ = false;
+    is_feature_streaming_ = false;
+    shm_publish_ = false;
+    std::fill(std::begin(shm_frame_num_), std::end(shm_frame_num_), 0);
+    std::fill(std::begin(shm_timestamp_), std::end(shm_timestamp_), 0);
+    full_res_enabled_ = true;
+    preview_enabled_ = false;
+    still_enabled_ = false;
+    still_jpeg_ = true;
+    still_requested_ = false;
+    is_still_streaming_ = false;
+    preview_size_idx_ = 0;
+    max_usb_speed_ = dai::UsbSpeed::SUPER;
+    device_usb_speed_ = dai::UsbSpeed::SUPER;
+    link_speed_ = dai::UsbSpeed::UNKNOWN;
+    for (const auto &speed : kUsbSpeeds)
+        usb_speed_names_.emplace_back(GetUsbSpeedName(speed));
+    auto_fit_bandwidth_ = false;
+    adaptive_fps_ = false;
+    soak_enabled_ = false;
+    soak_reported_ = 0;
+    color_skip_ = 1;
+    depth_skip_ = 1;
+    bandwidth_changed_ = false;
+    UpdatePreviewSizes_();
     init_ = false;
     init_idx_ = 0;
 
     RefreshDeviceList();
 }
 
+oak_camera::~oak_camera()
+{
+    StopReconnect_();
+    fusion_.Stop();
+}
+
 void oak_camera::RefreshDeviceList()
 {
+    // A device this camera has open is booted and no longer enumerated, it stays listed and selected
+    auto infos = dai::Device::getAllAvailableDevices();
+    if (is_init_ && !oak_dev_serial_.empty() && active_dev_idx_ < infos_.size()) {
+        auto it = std::find_if(infos.begin(), infos.end(), [this](const auto &info) { return info.mxid == oak_dev_serial_; });
+        if (it == infos.end())
+            infos.insert(infos.begin(), infos_[active_dev_idx_]);
+    }
+
+    infos_ = std::move(infos);
     camera_name_list_.clear();
     camera_name_list_.emplace_back("None");
-
-    infos_.clear();
-    infos_ = dai::Device::getAllAvailableDevices();
-    if(infos_.empty())
-        return;
-
     for(auto& info : infos_) {
         camera_name_list_.emplace_back(info.mxid);
     }
+    if (is_init_ && !oak_dev_serial_.empty()) {
+        for (int i = 0; i < infos_.size(); i++) {
+            if (infos_[i].mxid == oak_dev_serial_) {
+                active_dev_idx_ = i;
+                init_idx_ = i + 1;
+            }
+        }
+    }
+}
+
+void oak_camera::AddOpenDevices(const std::vector<std::string> &mxids)
+{
+    for (const auto &mxid : mxids) {
+        if (std::find(camera_name_list_.begin(), camera_name_list_.end(), mxid) != camera_name_list_.end())
+            continue;
+        dai::DeviceInfo info;
+        info.mxid = mxid;
+        infos_.emplace_back(info);
+        camera_name_list_.emplace_back(mxid);
+    }
 }
 
 int oak_camera::GetDeviceCount()
@@ -49,6 +465,10 @@ const std::vector<std::string> &oak_camera::GetDeviceList()
 
 void oak_camera::InitCamera_()
 {
+    // Selecting a device ends supervision of the previous one
+    StopReconnect_();
+    link_lost_ = false;
+
     std::lock_guard<std::mutex> lck(io_mutex_);
     if (is_init_) {
         device.reset();
@@ -67,11 +487,16 @@ void oak_camera::InitCamera_()
         color_configs_.clear();
         color_props_.clear();
         depth_props_.clear();
+        rgb_intrinsics_.clear();
+        depth_intrinsics_.clear();
+        registration_.Reset();
         pipeline = std::make_shared<dai::Pipeline>();
         active_dev_idx_ = init_idx_ - 1;
         oak_dev_serial_ = infos_[active_dev_idx_].mxid;
+        shm_publisher_.SetName("flowcv_oak_" + oak_dev_serial_);
         if (pipeline != nullptr) {
-            device = std::make_shared<dai::Device>(dai::OpenVINO::Version::VERSION_2021_4, infos_[active_dev_idx_], dai::UsbSpeed::SUPER);
+            device = std::make_shared<dai::Device>(dai::OpenVINO::Version::VERSION_2021_4, infos_[active_dev_idx_], max_usb_speed_);
+            device_usb_speed_ = max_usb_speed_;
         } else {
             std::cerr << "Error initializing Oak Camera Pipeline" << std::endl;
             active_dev_idx_ = 0;
@@ -84,6 +509,17 @@ void oak_camera::InitCamera_()
             oak_dev_serial_ = "";
             return;
         }
+        link_speed_ = device->getUsbSpeed();
+
+        // Sensor modes the connected cameras report, empty with firmware that predates camera features
+        std::map<dai::CameraBoardSocket, std::vector<dai::CameraSensorConfig>> camera_modes;
+        try {
+            for (const auto &feature : device->getConnectedCameraFeatures())
+                camera_modes[feature.socket] = feature.configs;
+        }
+        catch (const std::exception &e) {
+            std::cerr << "Unable to read Oak camera features: " << e.what() << std::endl;
+        }
 
         // Connect to device and start pipeline
         bool has_left = false;
@@ -98,67 +534,52 @@ void oak_camera::InitCamera_()
         }
         if (has_left && has_right) {
             has_depth_ = true;
-            // Add common depth configurations
-            depth_configs_.emplace_back(StreamConfig{"1280 x 800", "Depth", dai::CameraBoardSocket::AUTO,
-                                                     (int)dai::MonoCameraProperties::SensorResolution::THE_800_P,
-                                                     1280, 800, false, 1, 1, {120, 60, 30, 15}, 0});
-            depth_configs_.emplace_back(StreamConfig{"1280 x 720", "Depth", dai::CameraBoardSocket::AUTO,
-                                                     (int)dai::MonoCameraProperties::SensorResolution::THE_720_P,
-                                                     1280, 720, false, 1, 1, {120, 60, 30, 15}, 0});
-            depth_configs_.emplace_back(StreamConfig{"640 x 480", "Depth", dai::CameraBoardSocket::AUTO,
-                                                     (int)dai::MonoCameraProperties::SensorResolution::THE_480_P,
-                                                     640, 480, false, 1, 1, {120, 60, 30, 15}, 0});
-            depth_configs_.emplace_back(StreamConfig{"640 x 400", "Depth", dai::CameraBoardSocket::AUTO,
-                                                     (int)dai::MonoCameraProperties::SensorResolution::THE_400_P,
-                                                     640, 400, false, 1, 1, {120, 60, 30, 15}, 0});
-            // Add Depth Property Controls
-            depth_props_["Preset"] = {0, {0, 2, 0, 1.0f},
-                                        {"High Accuracy", "High Density"},
-                                        true, false};
+            // Stereo needs the mode on both sensors, fall back to the common modes when the device does not report any
+            for (const auto &mode : camera_modes[dai::CameraBoardSocket::LEFT]) {
+                int res_prop = FindResProp(kMonoModes, mode.width, mode.height);
+                float max_fps = GetModeMaxFps(camera_modes[dai::CameraBoardSocket::RIGHT], mode.width, mode.height);
+                if (res_prop >= 0 && max_fps > 0.0f) {
+                    AddStreamConfig(depth_configs_, StreamConfig{std::to_string(mode.width) + " x " + std::to_string(mode.height), "Depth",
+                                                                 dai::CameraBoardSocket::AUTO, res_prop, mode.width, mode.height, false, 1, 1,
+                                                                 MakeFpsList(std::min(mode.maxFps, max_fps)), 0});
+                }
+            }
+            if (depth_configs_.empty())
+                AddDefaultDepthConfigs(depth_configs_);
+            SortStreamConfigs(depth_configs_);
+            InitDepthProps_();
         }
         if (has_rgb_) {
-            // Add common RGB configurations
-            color_configs_.emplace_back(StreamConfig{"3840 x 2160", "RGB", dai::CameraBoardSocket::RGB,
-                                                     (int)dai::ColorCameraProperties::SensorResolution::THE_4_K,
-                                                     3840, 2160, false, 1, 1, {60, 30, 15}, 0});
-            color_configs_.emplace_back(StreamConfig{"1920 x 1080", "RGB", dai::CameraBoardSocket::RGB,
-                                                     (int)dai::ColorCameraProperties::SensorResolution::THE_1080_P,
-                                                     1920, 1080, false, 1, 1, {60, 30, 15}, 0});
-            color_configs_.emplace_back(StreamConfig{"1280 x 720", "RGB", dai::CameraBoardSocket::RGB,
-                                                     (int)dai::ColorCameraProperties::SensorResolution::THE_1080_P,
-                                                     1280, 720, true, 2, 3, {60, 30, 15}, 0});
-            color_configs_.emplace_back(StreamConfig{"960 x 540", "RGB", dai::CameraBoardSocket::RGB,
-                                                     (int)dai::ColorCameraProperties::SensorResolution::THE_1080_P,
-                                                     960, 540, true, 1, 2, {60, 30, 15}, 0});
-            color_configs_.emplace_back(StreamConfig{"640 x 360", "RGB", dai::CameraBoardSocket::RGB,
-                                                     (int)dai::ColorCameraProperties::SensorResolution::THE_1080_P,
-                                                     640, 360, true, 1, 3, {60, 30, 15}, 0});
-            // Add Camera Property Controls
-            color_props_["Brightness"] = {0, {-10, 10, 0, 0.25f}, {}, false, false};
-            color_props_["Contrast"] = {0, {-10, 10, 0, 0.25f}, {}, false, false};
-            color_props_["Saturation"] = {0, {-10, 10, 0, 0.25f}, {}, false, false};
-            color_props_["Sharpness"] = {0, {0, 4, 0, 0.1f}, {}, false, false};
-            color_props_["Auto_Exposure"] = {(int)true, {0, 1, (int)true, 0.1f}, {}, false, false};
-            color_props_["Exposure"] = {20000, {1, 33000, 20000, 500.0f}, {}, false, false};
-            color_props_["ISO"] = {800, {100, 1600, 800, 50.0f}, {}, false, false};
-            color_props_["White_Balance_Mode"] = {1, {0, 8, 1, 1.0f},
-                                                  {"Off", "Auto", "Incandescent", "Fluorescent",
-                                                   "Warm Fluorescent", "Daylight", "Cloudy Daylight",
-                                                   "Twilight", "Shade"},
-                                                   true, false};
-            color_props_["White_Balance"] = {4000, {200, 12000, 4000, 1000.0f}, {}, false, false};
-            color_props_["Focus_Mode"] = {1, {0, 6, 1, 1.0f},
-                                                  {"Off", "Auto", "Macro", "Continuous Video",
-                                                   "Continuous Picture", "EDOF"},
-                                                  true, false};
-            color_props_["Focus_Pos"] = {150, {0, 255, 150, 3.0f}, {}, false, false};
+            // Native sensor modes, plus ISP scaled 16:9 modes derived from 1080p
+            for (const auto &mode : camera_modes[dai::CameraBoardSocket::RGB]) {
+                int res_prop = FindResProp(kColorModes, mode.width, mode.height);
+                if (res_prop >= 0) {
+                    AddStreamConfig(color_configs_, StreamConfig{std::to_string(mode.width) + " x " + std::to_string(mode.height), "RGB",
+                                                                 dai::CameraBoardSocket::RGB, res_prop, mode.width, mode.height, false, 1, 1,
+                                                                 MakeFpsList(mode.maxFps), 0});
+                }
+            }
+            float fhd_fps = GetModeMaxFps(camera_modes[dai::CameraBoardSocket::RGB], 1920, 1080);
+            if (fhd_fps > 0.0f) {
+                // Native modes of the same size win over the scaled ones
+                const int fhd_res = (int)dai::ColorCameraProperties::SensorResolution::THE_1080_P;
+                AddStreamConfig(color_configs_, StreamConfig{"1280 x 720", "RGB", dai::CameraBoardSocket::RGB, fhd_res,
+                                                             1280, 720, true, 2, 3, MakeFpsList(fhd_fps), 0});
+                AddStreamConfig(color_configs_, StreamConfig{"960 x 540", "RGB", dai::CameraBoardSocket::RGB, fhd_res,
+                                                             960, 540, true, 1, 2, MakeFpsList(fhd_fps), 0});
+                AddStreamConfig(color_configs_, StreamConfig{"640 x 360", "RGB", dai::CameraBoardSocket::RGB, fhd_res,
+                                                             640, 360, true, 1, 3, MakeFpsList(fhd_fps), 0});
+            }
+            if (color_configs_.empty())
+                AddDefaultColorConfigs(color_configs_);
+            SortStreamConfigs(color_configs_);
+            InitColorProps_();
         }
 
-        if (device->isEepromAvailable()) {
-            auto eeprom = device->readCalibration2().getEepromData();
-            oak_dev_name_ = eeprom.boardName;
-        }
-        else
+        LoadCalibration_(false);
+        if (has_calib_)
+            oak_dev_name_ = calib_.getEepromData().boardName;
+        if (oak_dev_name_.empty())
             oak_dev_name_ = "Oak";
 
         is_init_ = true;
@@ -166,6 +587,52 @@ void oak_camera::InitCamera_()
     init_ = false;
 }
 
+void oak_camera::InitDepthProps_()
+{
+    depth_props_.resize(DepthProp_Count);
+    depth_props_[DepthProp_Preset] = {"Preset", 0, {0, 2, 0, 1.0f},
+                                      {"High Accuracy", "High Density"},
+                                      true, false};
+    depth_props_[DepthProp_Confidence] = {"Confidence", 200, {0, 255, 200, 1.0f}, {}, false, false};
+    depth_props_[DepthProp_Median] = {"Median_Filter", 3, {0, 3, 3, 1.0f},
+                                      {"Off", "3x3", "5x5", "7x7"},
+                                      true, false};
+    depth_props_[DepthProp_LR_Check] = {"LR_Check", (int)true, {0, 1, (int)true, 0.1f}, {}, false, false};
+    depth_props_[DepthProp_LR_Threshold] = {"LR_Threshold", 10, {0, 128, 10, 1.0f}, {}, false, false};
+    depth_props_[DepthProp_Subpixel] = {"Subpixel", (int)false, {0, 1, (int)false, 0.1f}, {}, false, false};
+    depth_props_[DepthProp_Subpixel_Bits] = {"Subpixel_Bits", 0, {0, 2, 0, 1.0f},
+                                             {"3", "4", "5"},
+                                             true, false};
+    depth_props_[DepthProp_Speckle] = {"Speckle_Filter", (int)false, {0, 1, (int)false, 0.1f}, {}, false, false};
+    depth_props_[DepthProp_Speckle_Range] = {"Speckle_Range", 50, {0, 240, 50, 1.0f}, {}, false, false};
+    depth_props_[DepthProp_Temporal] = {"Temporal_Filter", (int)false, {0, 1, (int)false, 0.1f}, {}, false, false};
+    depth_props_[DepthProp_Temporal_Alpha] = {"Temporal_Alpha", 40, {0, 100, 40, 1.0f}, {}, false, false};
+    depth_props_[DepthProp_Temporal_Delta] = {"Temporal_Delta", 0, {0, 255, 0, 1.0f}, {}, false, false};
+}
+
+void oak_camera::InitColorProps_()
+{
+    color_props_.resize(ColorProp_Count);
+    color_props_[ColorProp_Brightness] = {"Brightness", 0, {-10, 10, 0, 0.25f}, {}, false, false};
+    color_props_[ColorProp_Contrast] = {"Contrast", 0, {-10, 10, 0, 0.25f}, {}, false, false};
+    color_props_[ColorProp_Saturation] = {"Saturation", 0, {-10, 10, 0, 0.25f}, {}, false, false};
+    color_props_[ColorProp_Sharpness] = {"Sharpness", 0, {0, 4, 0, 0.1f}, {}, false, false};
+    color_props_[ColorProp_Auto_Exposure] = {"Auto_Exposure", (int)true, {0, 1, (int)true, 0.1f}, {}, false, false};
+    color_props_[ColorProp_Exposure] = {"Exposure", 20000, {1, 33000, 20000, 500.0f}, {}, false, false};
+    color_props_[ColorProp_ISO] = {"ISO", 800, {100, 1600, 800, 50.0f}, {}, false, false};
+    color_props_[ColorProp_White_Balance_Mode] = {"White_Balance_Mode", 1, {0, 8, 1, 1.0f},
+                                                  {"Off", "Auto", "Incandescent", "Fluorescent",
+                                                   "Warm Fluorescent", "Daylight", "Cloudy Daylight",
+                                                   "Twilight", "Shade"},
+                                                  true, false};
+    color_props_[ColorProp_White_Balance] = {"White_Balance", 4000, {200, 12000, 4000, 1000.0f}, {}, false, false};
+    color_props_[ColorProp_Focus_Mode] = {"Focus_Mode", 1, {0, 6, 1, 1.0f},
+                                          {"Off", "Auto", "Macro", "Continuous Video",
+                                           "Continuous Picture", "EDOF"},
+                                          true, false};
+    color_props_[ColorProp_Focus_Pos] = {"Focus_Pos", 150, {0, 255, 150, 3.0f}, {}, false, false};
+}
+
 void oak_camera::InitCamera(int index, bool immediate)
 {
     if (immediate) {
@@ -178,86 +645,431 @@ void oak_camera::InitCamera(int index, bool immediate)
     }
 }
 
+void oak_camera::SetFrameSource(std::shared_ptr<frame_source> source)
+{
+    // Offers the modes and controls of a device that reports none, without a serial a lost link is not reconnected
+    StopReconnect_();
+    std::lock_guard<std::mutex> lck(io_mutex_);
+    frame_source_ = std::move(source);
+    device.reset();
+    pipeline.reset();
+    queueNames.clear();
+    is_color_streaming_ = false;
+    is_depth_streaming_ = false;
+    is_init_ = frame_source_ != nullptr;
+    oak_dev_name_ = is_init_ ? "Frame Source" : "";
+    oak_dev_serial_ = "";
+    has_rgb_ = is_init_;
+    has_depth_ = is_init_;
+    color_configs_.clear();
+    depth_configs_.clear();
+    color_props_.clear();
+    depth_props_.clear();
+    rgb_intrinsics_.clear();
+    depth_intrinsics_.clear();
+    if (is_init_) {
+        AddDefaultColorConfigs(color_configs_);
+        AddDefaultDepthConfigs(depth_configs_);
+        SortStreamConfigs(color_configs_);
+        SortStreamConfigs(depth_configs_);
+        InitColorProps_();
+        InitDepthProps_();
+    }
+}
+
+void oak_camera::StartFrameSource_()
+{
+    // The frame queues a device pipeline would serve for this configuration, on-device extras are left out
+    std::vector<FrameStreamInfo> streams;
+    float source_fps = 0.0f;
+    if (is_color_enabled_) {
+        int fps = active_color_cfg_.fps_list.at(active_color_cfg_.fps_idx);
+        color_size_ = cv::Size(active_color_cfg_.width, active_color_cfg_.height);
+        if (full_res_enabled_) {
+            queueNames.emplace_back(active_color_cfg_.str_stream_name);
+            streams.push_back({active_color_cfg_.str_stream_name, color_size_.width, color_size_.height, fps, dai::ImgFrame::Type::NV12});
+        }
+        if (preview_enabled_) {
+            UpdatePreviewSizes_();
+            cv::Size preview_size = GetPreviewSize_(preview_size_idx_);
+            queueNames.emplace_back(kPreviewStreamName);
+            streams.push_back({kPreviewStreamName, preview_size.width, preview_size.height, fps, dai::ImgFrame::Type::BGR888i});
+        }
+        source_fps = (float)fps;
+        is_color_streaming_ = true;
+    }
+    if (is_depth_enabled_) {
+        int fps = active_depth_cfg_.fps_list.at(active_depth_cfg_.fps_idx);
+        cv::Size depth_size(active_depth_cfg_.width, active_depth_cfg_.height);
+        if (IsDepthAlignedToColor_() && is_color_enabled_)
+            depth_size = color_size_;
+        if (depth_output_enabled_) {
+            queueNames.emplace_back(active_depth_cfg_.str_stream_name);
+            streams.push_back({active_depth_cfg_.str_stream_name, depth_size.width, depth_size.height, fps, dai::ImgFrame::Type::RAW16});
+        }
+        source_fps = std::max(source_fps, (float)fps);
+        is_depth_streaming_ = true;
+    }
+    frame_source_->Start(streams);
+    for (const auto &name : queueNames)
+        frame_source_->SetQueueDepth(name, memory_.GetQueueDepth());
+    governor_.Reset(source_fps);
+    color_skip_ = 0;
+    depth_skip_ = 0;
+    if (is_color_enabled_ && color_props_.size() == ColorProp_Count) {
+        int fps = active_color_cfg_.fps_list.at(active_color_cfg_.fps_idx);
+        const auto &exposure = color_props_[ColorProp_Exposure].range;
+        const auto &iso = color_props_[ColorProp_ISO].range;
+        host_ae_.SetLimits(exposure.min, std::min(exposure.max, 1000000 / std::max(fps, 1)), iso.min, iso.max);
+        host_ae_.Reset();
+    }
+    SetAllRgbControls();
+}
+
+bool oak_camera::WaitFrames_(const std::vector<std::string> &names, int timeout_ms)
+{
+    if (frame_source_ != nullptr)
+        return frame_source_->Wait(names, std::chrono::milliseconds(timeout_ms));
+
+    return !device->getQueueEvent(names, std::chrono::milliseconds(timeout_ms)).empty();
+}
+
+double oak_camera::LinkTimeoutMs_() const
+{
+    // Device telemetry arrives once a second whatever the frame rates, the slowest frame period covers a
+    // frame source and rates lowered by the governor, gated streams send at least a keep-alive
+    float fps = 0.0f;
+    if (is_color_streaming_)
+        fps = (float)active_color_cfg_.fps_list.at(active_color_cfg_.fps_idx);
+    if (is_depth_streaming_) {
+        float depth_fps = (float)active_depth_cfg_.fps_list.at(active_depth_cfg_.fps_idx);
+        fps = (fps > 0.0f) ? std::min(fps, depth_fps) : depth_fps;
+    }
+    if (adaptive_fps_)
+        fps = std::min(fps, governor_.GetTargetFps());
+    double period_ms = 1000.0 / std::max(fps, 0.1f);
+    if (is_gate_streaming_)
+        period_ms = std::max(period_ms, (double)gate_keepalive_ms_);
+
+    return std::max((double)kLinkTimeoutMs, kLinkTimeoutFrames * period_ms);
+}
+
+std::vector<std::shared_ptr<dai::ImgFrame>> oak_camera::TryGetFrames_(const std::string &name)
+{
+    if (frame_source_ != nullptr)
+        return frame_source_->TryGetAll(name);
+
+    return device->getOutputQueue(name)->tryGetAll<dai::ImgFrame>();
+}
+
+void oak_camera::SetQueueDepth_(const std::string &name, int depth)
+{
+    if (frame_source_ != nullptr)
+        frame_source_->SetQueueDepth(name, depth);
+    else
+        device->getOutputQueue(name)->setMaxSize(depth);
+}
+
 void oak_camera::ReconfigureDevice_()
 {
     std::lock_guard<std::mutex> lck(io_mutex_);
+    auto reconfigure_start = std::chrono::steady_clock::now();
     if (is_init_) {
-        if (is_color_streaming_ || is_depth_streaming_) {
+        if (frame_source_ == nullptr && (is_color_streaming_ || is_depth_streaming_ || device_usb_speed_ != max_usb_speed_)) {
             device.reset();
             pipeline.reset();
             pipeline = std::make_shared<dai::Pipeline>();
-            device = std::make_shared<dai::Device>(dai::OpenVINO::Version::VERSION_2021_4, infos_[active_dev_idx_], dai::UsbSpeed::SUPER);
+            device = std::make_shared<dai::Device>(dai::OpenVINO::Version::VERSION_2021_4, infos_[active_dev_idx_], max_usb_speed_);
+            device_usb_speed_ = max_usb_speed_;
+            link_speed_ = device->getUsbSpeed();
         }
         is_color_streaming_ = false;
         is_depth_streaming_ = false;
         queueNames.clear();
+        queue_frame_bytes_.clear();
+        last_packet_time_ = std::chrono::steady_clock::now();
+        color_frame_.release();
+        preview_frame_.release();
+        color_undistorted_frame_.release();
+        depth_registered_frame_.release();
+        depth_compressed_frame_.release();
+        depth_codec_scratch_.release();
+        mask_frame_.release();
+        masked_color_frame_.release();
+        still_frame_.release();
+        is_still_streaming_ = false;
+        still_requested_ = false;
+        scan_data_.clear();
+        feature_data_.clear();
+        is_feature_streaming_ = false;
+        spatial_data_.clear();
+        is_spatial_streaming_ = false;
+        is_gate_streaming_ = false;
+        gateScript.reset();
+        gateScale.reset();
+        telemetry_.clear();
+        bandwidth_plan_.clear();
+        if (frame_source_ != nullptr && (is_color_enabled_ || is_depth_enabled_)) {
+            StartFrameSource_();
+            reconfigure_ = false;
+            soak_.AddReconfigure(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - reconfigure_start).count());
+            return;
+        }
         if (is_color_enabled_ || is_depth_enabled_) {
+            PlanBandwidth_();
+            // The gate sits in front of the full resolution color and depth outputs, whichever of them run
+            bool gate_color = gate_enabled_ && is_color_enabled_ && full_res_enabled_;
+            bool gate_depth = gate_enabled_ && is_depth_enabled_ && depth_output_enabled_;
+            if (gate_color || gate_depth)
+                CreateGate_(gate_color, gate_depth);
             if (is_color_enabled_) {
-                rgb_intrinsics_.clear();
                 camRgb = pipeline->create<dai::node::ColorCamera>();
-                rgbOut = pipeline->create<dai::node::XLinkOut>();
                 controlIn = pipeline->create<dai::node::XLinkIn>();
-                rgbOut->setStreamName(active_color_cfg_.str_stream_name);
-                queueNames.emplace_back(active_color_cfg_.str_stream_name);
                 controlIn->setStreamName("control");
                 camRgb->setBoardSocket(dai::CameraBoardSocket::RGB);
-                if (active_color_cfg_.ispScale) {
-                    camRgb->setResolution((dai::ColorCameraProperties::SensorResolution)active_color_cfg_.res_prop);
+                // Stills are cut from the ISP output, with still capture the ISP keeps the sensor resolution
+                // and the live stream is scaled down by an ImageManip instead
+                bool manip_scale = still_enabled_ && active_color_cfg_.ispScale;
+                camRgb->setResolution((dai::ColorCameraProperties::SensorResolution)active_color_cfg_.res_prop);
+                if (active_color_cfg_.ispScale && !manip_scale)
                     camRgb->setIspScale(active_color_cfg_.numerator, active_color_cfg_.denominator);
+                camRgb->setFps((float)active_color_cfg_.fps_list.at(active_color_cfg_.fps_idx));
+                if (manip_scale)
+                    color_size_ = cv::Size(active_color_cfg_.width, active_color_cfg_.height);
+                else
+                    color_size_ = cv::Size(camRgb->getIspWidth(), camRgb->getIspHeight());
+                // Full resolution ISP frames are only sent over XLink when that output is wanted
+                if (full_res_enabled_) {
+                    rgbOut = pipeline->create<dai::node::XLinkOut>();
+                    rgbOut->setStreamName(active_color_cfg_.str_stream_name);
+                    queueNames.emplace_back(active_color_cfg_.str_stream_name);
+                    dai::Node::Input *color_in = &rgbOut->input;
+                    if (manip_scale) {
+                        colorScale = pipeline->create<dai::node::ImageManip>();
+                        colorScale->initialConfig.setResize(color_size_.width, color_size_.height);
+                        colorScale->initialConfig.setFrameType(dai::ImgFrame::Type::NV12);
+                        colorScale->setMaxOutputFrameSize(color_size_.width * color_size_.height * 3 / 2);
+                        colorScale->out.link(rgbOut->input);
+                        color_in = &colorScale->inputImage;
+                    }
+                    if (gate_color) {
+                        gateScript->outputs["color_out"].link(*color_in);
+                        color_in = &gateScript->inputs["color"];
+                    }
+                    if (adaptive_fps_)
+                        LinkFrameSkip_(camRgb->isp, *color_in, kColorSkipStream);
+                    else
+                        camRgb->isp.link(*color_in);
+                }
+                // Color drives the gate whenever it runs, its ISP output is the better view of the scene
+                if (gateScale != nullptr)
+                    camRgb->isp.link(gateScale->inputImage);
+                if (still_enabled_) {
+                    stillOut = pipeline->create<dai::node::XLinkOut>();
+                    stillOut->setStreamName(kStillStreamName);
+                    if (still_jpeg_) {
+                        stillEncoder = pipeline->create<dai::node::VideoEncoder>();
+                        stillEncoder->setDefaultProfilePreset(1.0f, dai::VideoEncoderProperties::Profile::MJPEG);
+                        stillEncoder->setQuality(kStillJpegQuality);
+                        camRgb->still.link(stillEncoder->input);
+                        stillEncoder->bitstream.link(stillOut->input);
+                    }
+                    else {
+                        camRgb->still.link(stillOut->input);
+                    }
+                    is_still_streaming_ = true;
                 }
-                else {
-                    camRgb->setResolution((dai::ColorCameraProperties::SensorResolution)active_color_cfg_.res_prop);
+                // Small preview is scaled on device and travels on its own stream
+                if (preview_enabled_) {
+                    UpdatePreviewSizes_();
+                    cv::Size preview_size = GetPreviewSize_(preview_size_idx_);
+                    previewOut = pipeline->create<dai::node::XLinkOut>();
+                    previewOut->setStreamName(kPreviewStreamName);
+                    queueNames.emplace_back(kPreviewStreamName);
+                    camRgb->setPreviewSize(preview_size.width, preview_size.height);
+                    camRgb->setInterleaved(true);
+                    camRgb->setColorOrder(dai::ColorCameraProperties::ColorOrder::BGR);
+                    camRgb->preview.link(previewOut->input);
                 }
-                camRgb->setFps((float)active_color_cfg_.fps_list.at(active_color_cfg_.fps_idx));
-                camRgb->isp.link(rgbOut->input);
                 controlIn->out.link(camRgb->inputControl);
                 is_color_streaming_ = true;
             }
             if (is_depth_enabled_) {
-                depth_intrinsics_.clear();
                 left = pipeline->create<dai::node::MonoCamera>();
                 right = pipeline->create<dai::node::MonoCamera>();
                 stereo = pipeline->create<dai::node::StereoDepth>();
-                depthOut = pipeline->create<dai::node::XLinkOut>();
-                depthOut->setStreamName(active_depth_cfg_.str_stream_name);
-                queueNames.emplace_back(active_depth_cfg_.str_stream_name);
+                depthConfigIn = pipeline->create<dai::node::XLinkIn>();
+                depthConfigIn->setStreamName("depth_config");
                 left->setResolution((dai::MonoCameraProperties::SensorResolution)active_depth_cfg_.res_prop);
                 left->setBoardSocket(dai::CameraBoardSocket::LEFT);
                 left->setFps((float)active_depth_cfg_.fps_list.at(active_depth_cfg_.fps_idx));
                 right->setResolution((dai::MonoCameraProperties::SensorResolution)active_depth_cfg_.res_prop);
                 right->setBoardSocket(dai::CameraBoardSocket::RIGHT);
                 right->setFps((float)active_depth_cfg_.fps_list.at(active_depth_cfg_.fps_idx));
-                if (depth_props_["Preset"].value == 0)
+                if (depth_props_[DepthProp_Preset].value == 0)
                     stereo->setDefaultProfilePreset(dai::node::StereoDepth::PresetMode::HIGH_ACCURACY);
-                else if (depth_props_["Preset"].value == 1)
+                else if (depth_props_[DepthProp_Preset].value == 1)
                     stereo->setDefaultProfilePreset(dai::node::StereoDepth::PresetMode::HIGH_DENSITY);
-                stereo->setLeftRightCheck(true);
-                if (is_color_enabled_)
+                // Keep resources for every mode allocated so LR check and subpixel can be toggled at runtime
+                stereo->setRuntimeModeSwitch(true);
+                stereo_base_config_ = stereo->initialConfig.get();
+                SeedDepthProps_(stereo_base_config_);
+                dai::RawStereoDepthConfig initial_cfg = stereo_base_config_;
+                ApplyStereoProperties_(initial_cfg);
+                stereo->initialConfig.set(initial_cfg);
+                for (auto &prop : depth_props_)
+                    prop.has_changed = false;
+                depthConfigIn->out.link(stereo->inputConfig);
+                if (is_color_enabled_ && depth_align_mode_ == DepthAlign_Device) {
                     stereo->setDepthAlign(dai::CameraBoardSocket::RGB);
+                    stereo->setOutputSize(color_size_.width, color_size_.height);
+                }
                 left->out.link(stereo->left);
                 right->out.link(stereo->right);
-                stereo->depth.link(depthOut->input);
+                if (gateScale != nullptr && !is_color_enabled_)
+                    right->out.link(gateScale->inputImage);
+                // Depth frames are only sent over XLink when that output is wanted, stereo also feeds on-device consumers
+                if (depth_output_enabled_) {
+                    depthOut = pipeline->create<dai::node::XLinkOut>();
+                    depthOut->setStreamName(active_depth_cfg_.str_stream_name);
+                    queueNames.emplace_back(active_depth_cfg_.str_stream_name);
+                    dai::Node::Input *depth_in = &depthOut->input;
+                    if (gate_depth) {
+                        gateScript->outputs["depth_out"].link(*depth_in);
+                        depth_in = &gateScript->inputs["depth"];
+                    }
+                    if (adaptive_fps_)
+                        LinkFrameSkip_(stereo->depth, *depth_in, kDepthSkipStream);
+                    else
+                        stereo->depth.link(*depth_in);
+                }
+                if (spatial_enabled_ && !spatial_rois_.empty()) {
+                    spatialCalc = pipeline->create<dai::node::SpatialLocationCalculator>();
+                    spatialConfigIn = pipeline->create<dai::node::XLinkIn>();
+                    spatialOut = pipeline->create<dai::node::XLinkOut>();
+                    spatialConfigIn->setStreamName(kSpatialConfigStream);
+                    spatialOut->setStreamName(kSpatialStreamName);
+                    ApplySpatialConfig_(spatialCalc->initialConfig);
+                    spatial_config_changed_ = false;
+                    stereo->depth.link(spatialCalc->inputDepth);
+                    spatialConfigIn->out.link(spatialCalc->inputConfig);
+                    spatialCalc->out.link(spatialOut->input);
+                    is_spatial_streaming_ = true;
+                }
                 is_depth_streaming_ = true;
             }
+            // Sparse features on device, color tracks the luma of the video output, mono reuses the stereo pair
+            dai::Node::Output *feature_src = nullptr;
+            if (feature_source_ == FeatureSource_Color && is_color_enabled_) {
+                feature_src = &camRgb->video;
+                // Points are in video output pixels, which only match the ISP size until stills need the full sensor
+                feature_size_ = cv::Size(camRgb->getVideoWidth(), camRgb->getVideoHeight());
+            }
+            else if (feature_source_ == FeatureSource_Left && is_depth_enabled_) {
+                feature_src = &left->out;
+                feature_size_ = cv::Size(left->getResolutionWidth(), left->getResolutionHeight());
+            }
+            else if (feature_source_ == FeatureSource_Right && is_depth_enabled_) {
+                feature_src = &right->out;
+                feature_size_ = cv::Size(right->getResolutionWidth(), right->getResolutionHeight());
+            }
+            if (feature_src != nullptr) {
+                featureTracker = pipeline->create<dai::node::FeatureTracker>();
+                featureConfigIn = pipeline->create<dai::node::XLinkIn>();
+                featureOut = pipeline->create<dai::node::XLinkOut>();
+                featureConfigIn->setStreamName(kFeatureConfigStream);
+                featureOut->setStreamName(kFeatureStreamName);
+                // Optical flow and hardware motion estimation run on shaves, give them more than the minimum
+                featureTracker->setHardwareResources(2, 2);
+                ApplyFeatureConfig_(featureTracker->initialConfig);
+                feature_config_changed_ = false;
+                feature_src->link(featureTracker->inputImage);
+                featureConfigIn->out.link(featureTracker->inputConfig);
+                featureTracker->outputFeatures.link(featureOut->input);
+                is_feature_streaming_ = true;
+            }
+
+            sysLog = pipeline->create<dai::node::SystemLogger>();
+            sysLogOut = pipeline->create<dai::node::XLinkOut>();
+            sysLogOut->setStreamName(kSysInfoStreamName);
+            sysLog->setRate(kSysInfoRateHz);
+            sysLog->out.link(sysLogOut->input);
 
             if (!device->isPipelineRunning()) {
                 device->startPipeline(*pipeline);
             }
             // Sets queues size and behavior
             for(const auto& name : queueNames) {
-                device->getOutputQueue(name, 4, true);
+                device->getOutputQueue(name, memory_.GetQueueDepth(), true);
+            }
+            device->getOutputQueue(kSysInfoStreamName, 4, false);
+            featureConfigQueue.reset();
+            if (is_feature_streaming_) {
+                device->getOutputQueue(kFeatureStreamName, 4, false);
+                featureConfigQueue = device->getInputQueue(kFeatureConfigStream);
             }
             if (is_color_enabled_) {
                 controlQueue = device->getInputQueue("control");
             }
+            if (is_still_streaming_) {
+                device->getOutputQueue(kStillStreamName, 2, false);
+            }
+            if (is_depth_enabled_) {
+                depthConfigQueue = device->getInputQueue("depth_config");
+            }
+            gateConfigQueue.reset();
+            if (is_gate_streaming_) {
+                device->getOutputQueue(kGateStreamName, 8, false);
+                gateConfigQueue = device->getInputQueue(kGateConfigStream, 1, false);
+                gate_config_changed_ = true;
+            }
+            spatialConfigQueue.reset();
+            if (is_spatial_streaming_) {
+                device->getOutputQueue(kSpatialStreamName, 4, false);
+                spatialConfigQueue = device->getInputQueue(kSpatialConfigStream);
+            }
+            colorSkipQueue.reset();
+            depthSkipQueue.reset();
+            if (adaptive_fps_) {
+                if (is_color_enabled_ && full_res_enabled_)
+                    colorSkipQueue = device->getInputQueue(kColorSkipStream, 1, false);
+                if (is_depth_enabled_ && depth_output_enabled_)
+                    depthSkipQueue = device->getInputQueue(kDepthSkipStream, 1, false);
+            }
+            float source_fps = 0.0f;
+            if (is_color_enabled_)
+                source_fps = (float)active_color_cfg_.fps_list.at(active_color_cfg_.fps_idx);
+            if (is_depth_enabled_)
+                source_fps = std::max(source_fps, (float)active_depth_cfg_.fps_list.at(active_depth_cfg_.fps_idx));
+            governor_.Reset(source_fps);
+            color_skip_ = 0;
+            depth_skip_ = 0;
+            SendFrameSkip_();
+            UpdateCalibData_();
+            if (is_color_enabled_ && color_props_.size() == ColorProp_Count) {
+                // Exposure can not run past the frame period
+                int fps = active_color_cfg_.fps_list.at(active_color_cfg_.fps_idx);
+                const auto &exposure = color_props_[ColorProp_Exposure].range;
+                const auto &iso = color_props_[ColorProp_ISO].range;
+                host_ae_.SetLimits(exposure.min, std::min(exposure.max, 1000000 / std::max(fps, 1)), iso.min, iso.max);
+                host_ae_.Reset();
+            }
             SetAllRgbControls();
             reconfigure_ = false;
+            soak_.AddReconfigure(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - reconfigure_start).count());
         }
     }
 }
 
 bool oak_camera::EnableStream(StreamConfig& config, bool immediate)
 {
+    // A new request starts over from full quality, modes stepped down for the memory budget included
+    if (config.stream_type == dai::CameraBoardSocket::RGB)
+        requested_color_cfg_ = config;
+    else if (config.stream_type == dai::CameraBoardSocket::AUTO)
+        requested_depth_cfg_ = config;
+    RestoreMemoryLevel_();
+
     if (immediate) {
         if (config.stream_type == dai::CameraBoardSocket::RGB) {
             std::lock_guard<std::mutex> lck(io_mutex_);
@@ -305,6 +1117,170 @@ void oak_camera::DisableStream(dai::CameraBoardSocket stream)
 }
 
 void oak_camera::ProcessStreams()
+{
+    // Extracted points are only emitted on the tick they are requested
+    fusion_points_.release();
+
+    if (link_lost_) {
+        CheckReconnect_();
+        if (link_lost_) {
+            // Nothing to wait on while the device is away, hand back straight away
+            meta_data_.clear();
+            if (link_changed_) {
+                nlohmann::json link;
+                link["state"] = "lost";
+                link["error"] = link_error_;
+                link["reconnects"] = reconnect_count_;
+                meta_data_["data_type"] = "metadata";
+                meta_data_["data"].emplace_back(nlohmann::json({{"link", link}}));
+                link_changed_ = false;
+            }
+            return;
+        }
+    }
+
+    // Only a lost link reconnects, other errors such as a pipeline the device rejects keep the device
+    // and are not retried until the configuration changes again
+    try {
+        ProcessStreams_();
+    }
+    catch (const dai::XLinkError &e) {
+        OnLinkLost_(e.what());
+    }
+    catch (const link_lost_error &e) {
+        OnLinkLost_(e.what());
+    }
+    catch (const std::exception &e) {
+        std::cerr << "Oak camera error: " << e.what() << std::endl;
+        reconfigure_ = false;
+    }
+}
+
+void oak_camera::OnLinkLost_(const std::string &error)
+{
+    if (!is_init_ || oak_dev_serial_.empty()) {
+        std::cerr << "Oak camera error: " << error << std::endl;
+        return;
+    }
+
+    std::cerr << "Oak camera link lost, reconnecting: " << error << std::endl;
+    link_lost_ = true;
+    link_changed_ = true;
+    link_error_ = error;
+    link_lost_time_ = std::chrono::steady_clock::now();
+
+    // Drop everything tied to the old connection, active configs are kept for the restart
+    queueNames.clear();
+    queue_frame_bytes_.clear();
+    last_packet_time_ = std::chrono::steady_clock::now();
+    controlQueue.reset();
+    depthConfigQueue.reset();
+    featureConfigQueue.reset();
+    spatialConfigQueue.reset();
+    colorSkipQueue.reset();
+    depthSkipQueue.reset();
+    device.reset();
+    pipeline = std::make_shared<dai::Pipeline>();
+    is_color_streaming_ = false;
+    is_depth_streaming_ = false;
+    is_feature_streaming_ = false;
+    is_spatial_streaming_ = false;
+    is_gate_streaming_ = false;
+    is_still_streaming_ = false;
+    color_frame_.release();
+    depth_frame_.release();
+    preview_frame_.release();
+    color_undistorted_frame_.release();
+    depth_registered_frame_.release();
+    depth_compressed_frame_.release();
+    depth_codec_scratch_.release();
+    mask_frame_.release();
+    masked_color_frame_.release();
+    still_frame_.release();
+    scan_data_.clear();
+    feature_data_.clear();
+    spatial_data_.clear();
+    meta_data_.clear();
+
+    StopReconnect_();
+    reconnect_stop_ = false;
+    reconnect_ready_ = false;
+    reconnect_attempts_ = 0;
+    reconnect_thread_ = std::thread(&oak_camera::ReconnectWorker_, this, oak_dev_serial_, max_usb_speed_);
+}
+
+void oak_camera::ReconnectWorker_(const std::string &mxid, dai::UsbSpeed usb_speed)
+{
+    // Opening a device takes seconds, keep it off the processing thread
+    int backoff_ms = kReconnectMinBackoffMs;
+    while (!reconnect_stop_) {
+        try {
+            auto [found, info] = dai::Device::getDeviceByMxId(mxid);
+            if (found) {
+                auto dev = std::make_shared<dai::Device>(dai::OpenVINO::Version::VERSION_2021_4, info, usb_speed);
+                std::lock_guard<std::mutex> lck(reconnect_mutex_);
+                reconnect_device_ = dev;
+                reconnect_info_ = info;
+                reconnect_ready_ = true;
+                return;
+            }
+        }
+        catch (const std::exception &e) {
+            std::cerr << "Oak camera reconnect attempt failed: " << e.what() << std::endl;
+        }
+        reconnect_attempts_++;
+        for (int waited = 0; waited < backoff_ms && !reconnect_stop_; waited += 50)
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        backoff_ms = std::min(backoff_ms * 2, kReconnectMaxBackoffMs);
+    }
+}
+
+void oak_camera::CheckReconnect_()
+{
+    if (!reconnect_ready_)
+        return;
+
+    StopReconnect_();
+    {
+        std::lock_guard<std::mutex> lck(reconnect_mutex_);
+        device = reconnect_device_;
+        if (active_dev_idx_ < infos_.size())
+            infos_[active_dev_idx_] = reconnect_info_;
+        reconnect_device_.reset();
+    }
+    device_usb_speed_ = max_usb_speed_;
+    link_speed_ = device->getUsbSpeed();
+    last_downtime_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - link_lost_time_).count();
+    total_downtime_ms_ += last_downtime_ms_;
+    reconnect_count_++;
+    link_lost_ = false;
+    link_changed_ = true;
+
+    // Rebuild the last active configuration on the fresh connection
+    reconfigure_ = is_color_enabled_ || is_depth_enabled_;
+}
+
+void oak_camera::StopReconnect_()
+{
+    reconnect_stop_ = true;
+    if (reconnect_thread_.joinable())
+        reconnect_thread_.join();
+    reconnect_ready_ = false;
+    std::lock_guard<std::mutex> lck(reconnect_mutex_);
+    reconnect_device_.reset();
+}
+
+bool oak_camera::IsReconnecting() const
+{
+    return link_lost_;
+}
+
+int oak_camera::GetReconnectAttempts() const
+{
+    return reconnect_attempts_;
+}
+
+void oak_camera::ProcessStreams_()
 {
     if (init_)
         InitCamera_();
@@ -316,23 +1292,158 @@ void oak_camera::ProcessStreams()
         ChangeProperties_();
 
     if (is_init_) {
+        if (device != nullptr && device->isClosed())
+            throw link_lost_error("Oak device connection closed");
         if (is_color_streaming_ || is_depth_streaming_) {
-            if(rgb_intrinsics_.empty() || depth_intrinsics_.empty())
-                UpdateCalibData_();
             meta_data_.clear();
             nlohmann::json jMeta;
             nlohmann::json intrinsic;
             meta_data_["data_type"] = "metadata";
 
             std::unordered_map<std::string, std::shared_ptr<dai::ImgFrame>> latestPacket;
+            std::shared_ptr<dai::SystemInformation> sys_info;
+            if (device != nullptr)
+                sys_info = device->getOutputQueue(kSysInfoStreamName)->tryGet<dai::SystemInformation>();
+            if (sys_info != nullptr) {
+                last_packet_time_ = std::chrono::steady_clock::now();
+                UpdateTelemetry_(*sys_info);
+                jMeta["telemetry"] = telemetry_;
+            }
+
+            if (is_spatial_streaming_) {
+                if (spatial_config_changed_) {
+                    dai::SpatialLocationCalculatorConfig cfg;
+                    ApplySpatialConfig_(cfg);
+                    spatialConfigQueue->send(cfg);
+                    spatial_config_changed_ = false;
+                }
+                auto spatial = device->getOutputQueue(kSpatialStreamName)->tryGetAll<dai::SpatialLocationCalculatorData>();
+                if (!spatial.empty()) {
+                    // Depth is the configured statistic over the ROI in mm, x / y / z the ROI centroid in the depth camera frame (mm)
+                    nlohmann::json rois = nlohmann::json::array();
+                    for (const auto &loc : spatial.back()->getSpatialLocations()) {
+                        nlohmann::json roi;
+                        roi["x"] = loc.config.roi.x;
+                        roi["y"] = loc.config.roi.y;
+                        roi["w"] = loc.config.roi.width;
+                        roi["h"] = loc.config.roi.height;
+                        roi["depth"] = loc.depthAverage;
+                        roi["depth_min"] = loc.depthMin;
+                        roi["depth_max"] = loc.depthMax;
+                        roi["pixels"] = loc.depthAveragePixelCount;
+                        roi["X"] = loc.spatialCoordinates.x;
+                        roi["Y"] = loc.spatialCoordinates.y;
+                        roi["Z"] = loc.spatialCoordinates.z;
+                        rois.emplace_back(roi);
+                    }
+                    spatial_data_.clear();
+                    spatial_data_["algorithm"] = kSpatialAlgorithms[spatial_algorithm_];
+                    spatial_data_["frame_num"] = spatial.back()->getSequenceNum();
+                    spatial_data_["rois"] = rois;
+                }
+            }
+
+            // A still is only emitted on the tick it arrives
+            still_frame_.release();
+            if (is_still_streaming_) {
+                auto still = device->getOutputQueue(kStillStreamName)->tryGet<dai::ImgFrame>();
+                if (still != nullptr) {
+                    nlohmann::json still_frame;
+                    if (still_jpeg_) {
+                        const auto &data = still->getData();
+                        still_frame_ = cv::Mat(1, (int)data.size(), CV_8UC1);
+                        std::memcpy(still_frame_.data, data.data(), data.size());
+                        still_frame["format"] = "jpeg";
+                        still_frame["size"] = data.size();
+                    }
+                    else {
+                        still_frame_ = still->getCvFrame();
+                        still_frame["format"] = "bgr";
+                    }
+                    still_frame["w"] = camRgb->getStillWidth();
+                    still_frame["h"] = camRgb->getStillHeight();
+                    still_frame["frame_num"] = still->getSequenceNum();
+                    still_frame["timestamp"] = still->getTimestamp().time_since_epoch().count();
+                    AddCaptureParams(*still, still_frame);
+                    still_frame["latency_ms"] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - still_request_time_).count();
+                    jMeta["still"] = still_frame;
+                }
+            }
+
+            if (is_feature_streaming_) {
+                if (feature_config_changed_) {
+                    dai::FeatureTrackerConfig cfg;
+                    ApplyFeatureConfig_(cfg);
+                    featureConfigQueue->send(cfg);
+                    feature_config_changed_ = false;
+                }
+                auto features = device->getOutputQueue(kFeatureStreamName)->tryGetAll<dai::TrackedFeatures>();
+                if (!features.empty()) {
+                    // Parallel arrays keep the output compact
+                    const auto &latest = features.back();
+                    std::vector<uint32_t> ids, ages;
+                    std::vector<float> xs, ys;
+                    for (const auto &feature : latest->trackedFeatures) {
+                        ids.emplace_back(feature.id);
+                        ages.emplace_back(feature.age);
+                        xs.emplace_back(feature.position.x);
+                        ys.emplace_back(feature.position.y);
+                    }
+                    const char *sources[] = {"off", "color", "left", "right"};
+                    feature_data_.clear();
+                    feature_data_["source"] = sources[feature_source_];
+                    feature_data_["frame_num"] = latest->getSequenceNum();
+                    feature_data_["timestamp"] = latest->getTimestamp().time_since_epoch().count();
+                    feature_data_["width"] = feature_size_.width;
+                    feature_data_["height"] = feature_size_.height;
+                    feature_data_["id"] = ids;
+                    feature_data_["x"] = xs;
+                    feature_data_["y"] = ys;
+                    feature_data_["age"] = ages;
+                }
+            }
+
+            // Time spent blocked on frames is the consumer's headroom, older packets in a batch were never used
+            double wait_ms = 0.0;
+            int received = 0;
+            int superseded = 0;
+            // Wait briefly on any of the frame queues, or with only on-device consumers running on their results,
+            // so the loop paces itself without spinning and hands back quickly when nothing arrives
+            if (!queueNames.empty()) {
+                auto wait_start = std::chrono::steady_clock::now();
+                WaitFrames_(queueNames, kFrameWaitMs);
+                wait_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wait_start).count();
+            }
+            else if (is_spatial_streaming_) {
+                device->getQueueEvent(kSpatialStreamName, std::chrono::milliseconds(kFrameWaitMs));
+            }
             for (const auto &name: queueNames) {
-                device->getQueueEvent(name);
-                auto packets = device->getOutputQueue(name)->tryGetAll<dai::ImgFrame>();
+                auto packets = TryGetFrames_(name);
                 auto count = packets.size();
                 if (count > 0) {
                     latestPacket[name] = packets[count - 1];
+                    queue_frame_bytes_[name] = packets[count - 1]->getData().size();
+                    received += (int)count;
+                    superseded += (int)count - 1;
                 }
             }
+            if (received > 0)
+                last_packet_time_ = std::chrono::steady_clock::now();
+            double silent_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - last_packet_time_).count();
+            if (!queueNames.empty() && silent_ms > LinkTimeoutMs_())
+                throw link_lost_error("no packets for " + std::to_string((int)(silent_ms / 1000.0)) + " s");
+            governor_.AddSample(received, superseded, wait_ms);
+            if (governor_.Update() && adaptive_fps_) {
+                SendFrameSkip_();
+                nlohmann::json governor;
+                governor["target_fps"] = governor_.GetTargetFps();
+                governor["color_skip"] = color_skip_;
+                governor["depth_skip"] = depth_skip_;
+                governor["call_rate"] = governor_.GetCallRate();
+                governor["drop_ratio"] = governor_.GetDropRatio();
+                governor["idle_ratio"] = governor_.GetIdleRatio();
+                jMeta["governor"] = governor;
+            }
             for (const auto &name: queueNames) {
                 if (latestPacket.find(name) != latestPacket.end()) {
                     if (name == active_depth_cfg_.str_stream_name && is_depth_enabled_) {
@@ -340,42 +1451,97 @@ void oak_camera::ProcessStreams()
                         nlohmann::json depth_frame;
                         nlohmann::json refDepth;
                         nlohmann::json depth_int;
-                        int width = right->getResolutionWidth();
-                        int height = right->getResolutionHeight();
-                        if (is_color_streaming_) {
-                            width = camRgb->getIspWidth();
-                            height = camRgb->getIspHeight();
+                        int width = active_depth_cfg_.width;
+                        int height = active_depth_cfg_.height;
+                        if (IsDepthAlignedToColor_()) {
+                            width = color_size_.width;
+                            height = color_size_.height;
                         }
                         refDepth["w"] = width;
                         refDepth["h"] = height;
                         meta_data_["depth_frame"] = refDepth;
-                        depth_frame["fps"] = right->getFps();
+                        depth_frame["fps"] = active_depth_cfg_.fps_list.at(active_depth_cfg_.fps_idx);
                         depth_frame["frame_num"] = latestPacket[name]->getSequenceNum();
                         depth_frame["timestamp"] = latestPacket[name]->getTimestamp().time_since_epoch().count();
+                        if (is_color_streaming_)
+                            depth_frame["align"] = (depth_align_mode_ == DepthAlign_Device) ? "device" : "host";
+                        if (compress_depth_ && !memory_.DropDerived() && depth_frame_.type() == CV_16UC1) {
+                            // Encoded into a reused worst case buffer, then copied out at its exact size into a fresh
+                            // buffer every frame since downstream nodes may still hold the previous one
+                            auto start = std::chrono::steady_clock::now();
+                            depth_codec_scratch_.create(1, (int)depth_codec::MaxEncodedSize(depth_frame_.cols, depth_frame_.rows), CV_8UC1);
+                            size_t size = depth_codec::Encode((const uint16_t *)depth_frame_.data, depth_frame_.cols, depth_frame_.rows,
+                                                              depth_frame_.step, depth_codec_scratch_.data);
+                            if (size > 0) {
+                                depth_compressed_frame_ = depth_codec_scratch_.colRange(0, (int)size).clone();
+                                nlohmann::json codec;
+                                codec["format"] = "rvl";
+                                codec["size"] = size;
+                                codec["ratio"] = (double)(depth_frame_.total() * depth_frame_.elemSize()) / (double)size;
+                                codec["encode_ms"] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                                depth_frame["codec"] = codec;
+                            }
+                        }
                         jMeta["depth_frame"] = depth_frame;
-                        depth_int["width"] = width;
-                        depth_int["height"] = height;
-                        depth_int["fx"] = depth_intrinsics_[0][0];
-                        depth_int["fy"] = depth_intrinsics_[1][1];
-                        depth_int["ppx"] = depth_intrinsics_[0][2];
-                        depth_int["ppy"] = depth_intrinsics_[1][2];
-                        intrinsic["depth"] = depth_int;
+                        if (!depth_intrinsics_.empty()) {
+                            depth_int["width"] = width;
+                            depth_int["height"] = height;
+                            depth_int["fx"] = depth_intrinsics_[0][0];
+                            depth_int["fy"] = depth_intrinsics_[1][1];
+                            depth_int["ppx"] = depth_intrinsics_[0][2];
+                            depth_int["ppy"] = depth_intrinsics_[1][2];
+                            intrinsic["depth"] = depth_int;
+                        }
+                    }
+                    else if (name == kPreviewStreamName && is_color_enabled_) {
+                        preview_frame_ = latestPacket[name]->getCvFrame();
+                        nlohmann::json preview_frame;
+                        preview_frame["w"] = preview_frame_.cols;
+                        preview_frame["h"] = preview_frame_.rows;
+                        preview_frame["frame_num"] = latestPacket[name]->getSequenceNum();
+                        preview_frame["timestamp"] = latestPacket[name]->getTimestamp().time_since_epoch().count();
+                        AddCaptureParams(*latestPacket[name], preview_frame);
+                        UpdateControlFeedback_(*latestPacket[name], preview_frame);
+                        jMeta["preview_frame"] = preview_frame;
+                        // Without the full resolution stream the preview is the reference frame
+                        if (!full_res_enabled_) {
+                            nlohmann::json ref;
+                            ref["w"] = preview_frame_.cols;
+                            ref["h"] = preview_frame_.rows;
+                            meta_data_["ref_frame"] = ref;
+                        }
+                        if (!rgb_intrinsics_.empty() && !preview_frame_.empty()) {
+                            // The preview is scaled from the ISP output to cover its size, then center cropped
+                            double scale = std::max((double)preview_frame_.cols / color_size_.width, (double)preview_frame_.rows / color_size_.height);
+                            double crop_x = (color_size_.width * scale - preview_frame_.cols) / 2.0;
+                            double crop_y = (color_size_.height * scale - preview_frame_.rows) / 2.0;
+                            nlohmann::json preview_int;
+                            preview_int["width"] = preview_frame_.cols;
+                            preview_int["height"] = preview_frame_.rows;
+                            preview_int["fx"] = rgb_intrinsics_[0][0] * scale;
+                            preview_int["fy"] = rgb_intrinsics_[1][1] * scale;
+                            preview_int["ppx"] = rgb_intrinsics_[0][2] * scale - crop_x;
+                            preview_int["ppy"] = rgb_intrinsics_[1][2] * scale - crop_y;
+                            intrinsic["preview"] = preview_int;
+                        }
                     }
                     else if (name == active_color_cfg_.str_stream_name && is_color_enabled_) {
                         color_frame_ = latestPacket[name]->getCvFrame();
                         nlohmann::json ref;
-                        ref["w"] = camRgb->getIspWidth();
-                        ref["h"] = camRgb->getIspHeight();
+                        ref["w"] = color_size_.width;
+                        ref["h"] = color_size_.height;
                         meta_data_["ref_frame"] = ref;
                         nlohmann::json color_frame;
+                        UpdateControlFeedback_(*latestPacket[name], color_frame);
                         if (!rgb_intrinsics_.empty()) {
                             color_frame["fps"] = camRgb->getFps();
                             color_frame["frame_num"] = latestPacket[name]->getSequenceNum();
                             color_frame["timestamp"] = latestPacket[name]->getTimestamp().time_since_epoch().count();
+                            AddCaptureParams(*latestPacket[name], color_frame);
                             jMeta["color_frame"] = color_frame;
                             nlohmann::json color_int;
-                            color_int["width"] = camRgb->getIspWidth();
-                            color_int["height"] = camRgb->getIspHeight();
+                            color_int["width"] = color_size_.width;
+                            color_int["height"] = color_size_.height;
                             color_int["fx"] = rgb_intrinsics_[0][0];
                             color_int["fy"] = rgb_intrinsics_[1][1];
                             color_int["ppx"] = rgb_intrinsics_[0][2];
@@ -385,39 +1551,1417 @@ void oak_camera::ProcessStreams()
                     }
                 }
             }
-            if (!intrinsic.empty())
+            // Host side undistortion and registration only run on newly received frames
+            bool new_color = latestPacket.find(active_color_cfg_.str_stream_name) != latestPacket.end();
+            bool new_depth = latestPacket.find(active_depth_cfg_.str_stream_name) != latestPacket.end();
+            if (is_gate_streaming_) {
+                if (gate_config_changed_)
+                    SendGateConfig_();
+                nlohmann::json gate;
+                auto openings = device->getOutputQueue(kGateStreamName)->tryGetAll<dai::Buffer>();
+                for (const auto &info : openings) {
+                    const auto &data = info->getData();
+                    if (data.size() < 2)
+                        continue;
+                    gate_forwarded_++;
+                    if (data[0] == 2)
+                        gate_keepalives_++;
+                    gate["reason"] = kGateReasons[std::min((int)data[0], 2)];
+                    gate["score"] = data[1];
+                }
+                // Gated ticks repeat the last frames on the outputs, they are still valid
+                if (new_color || new_depth)
+                    gate_last_frame_time_ = std::chrono::steady_clock::now();
+                gate["gated"] = !(new_color || new_depth);
+                gate["last_frame_ms"] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - gate_last_frame_time_).count();
+                gate["forwarded"] = gate_forwarded_;
+                gate["keepalives"] = gate_keepalives_;
+                jMeta["gate"] = gate;
+            }
+            // Over the memory budget the host derived outputs are the first thing to go after the queues
+            bool derived = !memory_.DropDerived();
+            if (derived && ((undistort_color_ && new_color) || (depth_align_mode_ == DepthAlign_Host && new_depth))) {
+                if (is_color_streaming_ && !rgb_intrinsics_.empty())
+                    registration_.SetColorCalibration(rgb_intrinsics_, rgb_distortion_, color_size_.width, color_size_.height);
+            }
+            if (derived && undistort_color_ && new_color && is_color_enabled_)
+                registration_.Undistort(color_frame_, color_undistorted_frame_);
+            if (derived && depth_align_mode_ == DepthAlign_Host && new_depth && is_depth_enabled_ && is_color_streaming_ && !depth_intrinsics_.empty()) {
+                registration_.SetDepthCalibration(depth_intrinsics_, right_rectification_, depth_to_rgb_extrinsics_,
+                                                  active_depth_cfg_.width, active_depth_cfg_.height);
+                registration_.Register(depth_frame_, depth_registered_frame_);
+            }
+            if (scan_enabled_ && new_depth && is_depth_enabled_ && !depth_intrinsics_.empty()) {
+                auto start = std::chrono::steady_clock::now();
+                scan_.SetIntrinsics(depth_intrinsics_, depth_frame_.cols, depth_frame_.rows);
+                if (scan_.Scan(depth_frame_, scan_ranges_)) {
+                    const auto &pkt = latestPacket[active_depth_cfg_.str_stream_name];
+                    const auto &angles = scan_.GetAngles();
+                    scan_data_.clear();
+                    scan_data_["frame_num"] = pkt->getSequenceNum();
+                    scan_data_["timestamp"] = pkt->getTimestamp().time_since_epoch().count();
+                    scan_data_["band_top"] = scan_.GetBandTop();
+                    scan_data_["band_bottom"] = scan_.GetBandBottom();
+                    scan_data_["angle_min"] = angles.front();
+                    scan_data_["angle_max"] = angles.back();
+                    scan_data_["angles"] = angles;
+                    scan_data_["ranges"] = scan_ranges_;
+                    scan_data_["scan_ms"] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                }
+            }
+            if (host_ae_enabled_ && new_color && is_color_enabled_ && !control_pending_)
+                UpdateHostExposure_(*latestPacket[active_color_cfg_.str_stream_name], jMeta);
+            if (derived && mask_enabled_ && new_depth && is_depth_enabled_) {
+                // The color frame can only be masked by depth that shares its pixel grid
+                auto start = std::chrono::steady_clock::now();
+                const cv::Mat *mask_depth = &depth_frame_;
+                cv::Mat mask_color;
+                if (mask_color_ && is_color_streaming_) {
+                    if (depth_align_mode_ == DepthAlign_Host && !depth_registered_frame_.empty())
+                        mask_depth = &depth_registered_frame_;
+                    if (IsDepthAlignedToColor_() || mask_depth == &depth_registered_frame_)
+                        mask_color = color_frame_;
+                }
+                if (mask_.Compute(*mask_depth, mask_color, mask_frame_, masked_color_frame_)) {
+                    nlohmann::json mask;
+                    mask["near_mm"] = mask_.GetNear();
+                    mask["far_mm"] = mask_.GetFar();
+                    mask["cleanup"] = mask_.GetCleanup();
+                    mask["w"] = mask_frame_.cols;
+                    mask["h"] = mask_frame_.rows;
+                    mask["masked_color"] = !masked_color_frame_.empty();
+                    mask["mask_ms"] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                    jMeta["mask"] = mask;
+                }
+            }
+            if (fusion_enabled_ && new_depth && is_depth_enabled_ && !depth_intrinsics_.empty()) {
+                // Integration runs on the fusion worker, a frame arriving while it is busy replaces the pending one
+                fusion_.SetIntrinsics(depth_intrinsics_);
+                fusion_.Submit(depth_frame_, fusion_pose_);
+                TsdfStats stats = fusion_.GetStats();
+                nlohmann::json fusion;
+                fusion["voxel_mm"] = fusion_voxel_mm_;
+                fusion["blocks"] = stats.blocks;
+                fusion["memory_mb"] = (double)stats.memory_bytes / (1024.0 * 1024.0);
+                // The host memory budget may hold the volume below its configured budget
+                fusion["budget_mb"] = (double)fusion_.GetMemoryBudget() / (1024.0 * 1024.0);
+                fusion["frames"] = stats.frames;
+                fusion["dropped"] = stats.dropped;
+                fusion["evicted"] = stats.evicted;
+                fusion["integrate_ms"] = stats.integrate_ms;
+                jMeta["fusion"] = fusion;
+            }
+
+            if (!intrinsic.empty()) {
+                intrinsic["calib_id"] = calib_id_;
                 jMeta["intrinsics"] = intrinsic;
-            if (!jMeta.empty())
-                meta_data_["data"].emplace_back(jMeta);
-        }
-    }
+            }
+            if (calib_changed_ && !jMeta.empty()) {
+                // Full calibration is only sent when it differs from what was last published
+                nlohmann::json calib;
+                calib["calib_id"] = calib_id_;
+                if (!rgb_intrinsics_.empty()) {
+                    calib["color"]["width"] = color_size_.width;
+                    calib["color"]["height"] = color_size_.height;
+                    calib["color"]["intrinsics"] = rgb_intrinsics_;
+                    calib["color"]["distortion"] = rgb_distortion_;
+                }
+                if (!depth_intrinsics_.empty()) {
+                    calib["depth"]["intrinsics"] = depth_intrinsics_;
+                    calib["depth"]["rectification"] = right_rectification_;
+                }
+                if (!depth_to_rgb_extrinsics_.empty())
+                    calib["depth_to_color"] = depth_to_rgb_extrinsics_;
+                calib["baseline_cm"] = stereo_baseline_;
+                jMeta["calibration"] = calib;
+                calib_changed_ = false;
+            }
+            if (link_changed_ && !jMeta.empty()) {
+                nlohmann::json link;
+                link["state"] = "connected";
+                link["reconnects"] = reconnect_count_;
+                link["last_downtime_ms"] = last_downtime_ms_;
+                link["total_downtime_ms"] = total_downtime_ms_;
+                link["last_error"] = link_error_;
+                jMeta["link"] = link;
+                link_changed_ = false;
+            }
+            if (bandwidth_changed_ && !jMeta.empty()) {
+                jMeta["bandwidth"] = bandwidth_plan_;
+                bandwidth_changed_ = false;
+            }
+            // Capture to output latency, host side processing of this tick included
+            auto now = std::chrono::steady_clock::now();
+            if (new_color && is_color_enabled_)
+                soak_.AddFrameLatency(std::chrono::duration<double, std::milli>(now - latestPacket[active_color_cfg_.str_stream_name]->getTimestamp()).count());
+            if (new_depth && is_depth_enabled_)
+                soak_.AddFrameLatency(std::chrono::duration<double, std::milli>(now - latestPacket[active_depth_cfg_.str_stream_name]->getTimestamp()).count());
+            if (soak_.Update() && soak_enabled_)
+                jMeta["soak"] = MakeSoakReport_();
+            if (memory_.IsDue())
+                jMeta["memory"] = UpdateMemory_(jMeta);
+            if (!jMeta.empty())
+                meta_data_["data"].emplace_back(jMeta);
+
+            if (shm_publish_ && (new_color || new_depth)) {
+                PublishSharedMemory_(new_color ? latestPacket[active_color_cfg_.str_stream_name] : nullptr,
+                                     new_depth ? latestPacket[active_depth_cfg_.str_stream_name] : nullptr);
+            }
+        }
+    }
+}
+
+void oak_camera::ApplyFeatureConfig_(dai::FeatureTrackerConfig &cfg) const
+{
+    cfg.setNumTargetFeatures(feature_max_);
+    cfg.setCornerDetector((dai::FeatureTrackerConfig::CornerDetector::Type)feature_corner_);
+    if (feature_motion_ == FeatureMotion_Optical_Flow)
+        cfg.setOpticalFlow();
+    else if (feature_motion_ == FeatureMotion_Hardware)
+        cfg.setHwMotionEstimation();
+    else
+        cfg.setMotionEstimator(false);
+}
+
+void oak_camera::ApplySpatialConfig_(dai::SpatialLocationCalculatorConfig &cfg) const
+{
+    // ROIs are normalized to the depth frame
+    std::vector<dai::SpatialLocationCalculatorConfigData> rois;
+    for (const auto &rect : spatial_rois_) {
+        dai::SpatialLocationCalculatorConfigData data;
+        data.roi = dai::Rect(rect.x, rect.y, rect.width, rect.height);
+        data.depthThresholds.lowerThreshold = spatial_lower_;
+        data.depthThresholds.upperThreshold = spatial_upper_;
+        data.calculationAlgorithm = (dai::SpatialLocationCalculatorAlgorithm)spatial_algorithm_;
+        rois.emplace_back(data);
+    }
+    cfg.setROIs(rois);
+}
+
+void oak_camera::LinkFrameSkip_(dai::Node::Output &src, dai::Node::Input &dst, const std::string &cfg_stream)
+{
+    auto script = pipeline->create<dai::node::Script>();
+    auto skipIn = pipeline->create<dai::node::XLinkIn>();
+    script->setScript(kFrameSkipScript);
+    skipIn->setStreamName(cfg_stream);
+    skipIn->out.link(script->inputs["skip"]);
+    src.link(script->inputs["in"]);
+    script->outputs["out"].link(dst);
+}
+
+void oak_camera::SendFrameSkip_()
+{
+    // Skip counts follow the governor target, only changes are sent
+    float target = governor_.GetTargetFps();
+    if (colorSkipQueue != nullptr) {
+        int skip = fps_governor::GetSkip((float)active_color_cfg_.fps_list.at(active_color_cfg_.fps_idx), target);
+        if (skip != color_skip_) {
+            dai::Buffer buf;
+            buf.setData({(uint8_t)skip});
+            colorSkipQueue->send(buf);
+            color_skip_ = skip;
+        }
+    }
+    if (depthSkipQueue != nullptr) {
+        int skip = fps_governor::GetSkip((float)active_depth_cfg_.fps_list.at(active_depth_cfg_.fps_idx), target);
+        if (skip != depth_skip_) {
+            dai::Buffer buf;
+            buf.setData({(uint8_t)skip});
+            depthSkipQueue->send(buf);
+            depth_skip_ = skip;
+        }
+    }
+}
+
+void oak_camera::CreateGate_(bool gate_color, bool gate_depth)
+{
+    gateScript = pipeline->create<dai::node::Script>();
+    gateScale = pipeline->create<dai::node::ImageManip>();
+    auto gateConfigIn = pipeline->create<dai::node::XLinkIn>();
+    auto gateOut = pipeline->create<dai::node::XLinkOut>();
+    std::string script = std::string("GATE_COLOR = ") + (gate_color ? "True" : "False") + "\nGATE_DEPTH = " +
+                         (gate_depth ? "True" : "False") + "\n" + kGateScript;
+    gateScript->setScript(script);
+    gateScale->initialConfig.setResize(kGateSize.width, kGateSize.height);
+    gateScale->initialConfig.setFrameType(dai::ImgFrame::Type::GRAY8);
+    gateScale->setMaxOutputFrameSize(kGateSize.width * kGateSize.height);
+    gateScale->out.link(gateScript->inputs["small"]);
+    // Frames waiting on a closed gate are replaced, never queued
+    for (const char *name : {"color", "depth", "small"}) {
+        gateScript->inputs[name].setBlocking(false);
+        gateScript->inputs[name].setQueueSize(1);
+    }
+    gateConfigIn->setStreamName(kGateConfigStream);
+    gateConfigIn->out.link(gateScript->inputs["cfg"]);
+    gateOut->setStreamName(kGateStreamName);
+    gateScript->outputs["info"].link(gateOut->input);
+    gate_last_frame_time_ = std::chrono::steady_clock::now();
+    is_gate_streaming_ = true;
+}
+
+void oak_camera::SendGateConfig_()
+{
+    if (gateConfigQueue == nullptr)
+        return;
+
+    dai::Buffer buf;
+    buf.setData({(uint8_t)gate_threshold_, (uint8_t)(gate_keepalive_ms_ & 0xFF), (uint8_t)(gate_keepalive_ms_ >> 8)});
+    gateConfigQueue->send(buf);
+    gate_config_changed_ = false;
+}
+
+void oak_camera::PlanBandwidth_()
+{
+    // Describe what the pipeline is about to send: ISP output is NV12, depth RAW16 and the preview interleaved BGR
+    auto make_modes = [](const std::vector<StreamConfig> &configs, const StreamConfig &active, int &mode_idx) {
+        std::vector<BandwidthMode> modes;
+        mode_idx = 0;
+        for (int i = 0; i < configs.size(); i++) {
+            if (configs[i].str_resolution == active.str_resolution)
+                mode_idx = i;
+            modes.emplace_back(BandwidthMode{configs[i].width, configs[i].height, configs[i].fps_list});
+        }
+        return modes;
+    };
+
+    std::vector<BandwidthStream> streams;
+    int color_idx = -1;
+    int depth_idx = -1;
+    int mode_idx;
+    if (is_color_enabled_) {
+        auto modes = make_modes(color_configs_, active_color_cfg_, mode_idx);
+        color_idx = (int)streams.size();
+        streams.emplace_back(BandwidthStream{active_color_cfg_.str_stream_name, full_res_enabled_ ? 1.5f : 0.0f, modes,
+                                             mode_idx, active_color_cfg_.fps_idx, -1, -1});
+        if (preview_enabled_) {
+            cv::Size size = GetPreviewSize_(preview_size_idx_);
+            streams.emplace_back(BandwidthStream{kPreviewStreamName, 3.0f, {{size.width, size.height, {0}}}, 0, 0, -1, color_idx});
+        }
+    }
+    if (is_depth_enabled_) {
+        auto modes = make_modes(depth_configs_, active_depth_cfg_, mode_idx);
+        depth_idx = (int)streams.size();
+        // Depth aligned on device comes out at the ISP size
+        int size_from = (color_idx >= 0 && depth_align_mode_ == DepthAlign_Device) ? color_idx : -1;
+        streams.emplace_back(BandwidthStream{active_depth_cfg_.str_stream_name, depth_output_enabled_ ? 2.0f : 0.0f, modes,
+                                             mode_idx, active_depth_cfg_.fps_idx, size_from, -1});
+    }
+
+    double required = bandwidth_planner::GetRequiredRate(streams);
+    double capacity = GetUsbCapacity(link_speed_);
+    bool fits = bandwidth_planner::Fits(streams, capacity);
+    bool adjusted = false;
+    if (!fits && auto_fit_bandwidth_ && bandwidth_planner::StepDown(streams, capacity)) {
+        if (color_idx >= 0) {
+            active_color_cfg_ = color_configs_[streams[color_idx].mode_idx];
+            active_color_cfg_.fps_idx = streams[color_idx].fps_idx;
+        }
+        if (depth_idx >= 0) {
+            active_depth_cfg_ = depth_configs_[streams[depth_idx].mode_idx];
+            active_depth_cfg_.fps_idx = streams[depth_idx].fps_idx;
+        }
+        fits = true;
+        adjusted = true;
+    }
+    if (!fits) {
+        std::cerr << "Oak streams need about " << (int)required << " MB/s but the " << GetUsbSpeedName(link_speed_)
+                  << " USB link carries about " << (int)capacity << " MB/s, expect dropped frames" << std::endl;
+    }
+
+    bandwidth_plan_.clear();
+    bandwidth_plan_["usb_speed"] = GetUsbSpeedName(link_speed_);
+    bandwidth_plan_["capacity_mbs"] = capacity;
+    bandwidth_plan_["required_mbs"] = required;
+    bandwidth_plan_["planned_mbs"] = bandwidth_planner::GetRequiredRate(streams);
+    bandwidth_plan_["fits"] = fits;
+    bandwidth_plan_["adjusted"] = adjusted;
+    for (int i = 0; i < streams.size(); i++) {
+        if (streams[i].bytes_per_pixel <= 0.0f)
+            continue;
+        nlohmann::json stream;
+        stream["name"] = streams[i].name;
+        stream["width"] = bandwidth_planner::GetWidth(streams, i);
+        stream["height"] = bandwidth_planner::GetHeight(streams, i);
+        stream["fps"] = bandwidth_planner::GetFps(streams, i);
+        stream["mbs"] = bandwidth_planner::GetStreamRate(streams, i);
+        bandwidth_plan_["streams"].emplace_back(stream);
+    }
+    bandwidth_changed_ = true;
+}
+
+void oak_camera::UpdateTelemetry_(const dai::SystemInformation &info)
+{
+    auto memory = [](const dai::MemoryInfo &mem) {
+        nlohmann::json j;
+        j["used"] = mem.used;
+        j["total"] = mem.total;
+        return j;
+    };
+
+    telemetry_.clear();
+    telemetry_["host_timestamp"] = std::chrono::steady_clock::now().time_since_epoch().count();
+    telemetry_["temperature"]["average"] = info.chipTemperature.average;
+    telemetry_["temperature"]["css"] = info.chipTemperature.css;
+    telemetry_["temperature"]["mss"] = info.chipTemperature.mss;
+    telemetry_["temperature"]["upa"] = info.chipTemperature.upa;
+    telemetry_["temperature"]["dss"] = info.chipTemperature.dss;
+    telemetry_["cpu"]["css"] = info.leonCssCpuUsage.average * 100.0f;
+    telemetry_["cpu"]["mss"] = info.leonMssCpuUsage.average * 100.0f;
+    telemetry_["memory"]["ddr"] = memory(info.ddrMemoryUsage);
+    telemetry_["memory"]["cmx"] = memory(info.cmxMemoryUsage);
+    telemetry_["memory"]["css_heap"] = memory(info.leonCssMemoryUsage);
+    telemetry_["memory"]["mss_heap"] = memory(info.leonMssMemoryUsage);
+    telemetry_["usb_speed"] = GetUsbSpeedName(link_speed_);
+}
+
+void oak_camera::PublishSharedMemory_(const std::shared_ptr<dai::ImgFrame> &color_pkt, const std::shared_ptr<dai::ImgFrame> &depth_pkt)
+{
+    // Every slot carries the latest frame of each stream so readers never have to combine slots
+    auto make_frame = [this](const cv::Mat &frame, const std::shared_ptr<dai::ImgFrame> &pkt, ShmStream stream, ShmFrameData &out) {
+        out = {};
+        if (pkt != nullptr) {
+            shm_frame_num_[stream] = pkt->getSequenceNum();
+            shm_timestamp_[stream] = pkt->getTimestamp().time_since_epoch().count();
+        }
+        if (frame.empty() || !frame.isContinuous())
+            return;
+        out.data = frame.data;
+        out.size = frame.total() * frame.elemSize();
+        out.width = frame.cols;
+        out.height = frame.rows;
+        out.type = frame.type();
+        out.step = (int32_t)frame.step[0];
+        out.frame_num = shm_frame_num_[stream];
+        out.timestamp = shm_timestamp_[stream];
+    };
+
+    ShmFrameData frames[ShmStream_Count];
+    make_frame(is_color_enabled_ ? color_frame_ : cv::Mat(), color_pkt, ShmStream_Color, frames[ShmStream_Color]);
+    make_frame(is_depth_enabled_ ? depth_frame_ : cv::Mat(), depth_pkt, ShmStream_Depth, frames[ShmStream_Depth]);
+    // Metadata belongs to the packet that triggered this slot
+    const ShmFrameData &trigger = color_pkt != nullptr ? frames[ShmStream_Color] : frames[ShmStream_Depth];
+    std::string meta = meta_data_.dump();
+    frames[ShmStream_Meta] = {meta.data(), meta.size(), 0, 0, 0, 0, trigger.frame_num, trigger.timestamp};
+    shm_publisher_.Publish(frames);
+}
+
+void oak_camera::LoadCalibration_(bool from_device)
+{
+    has_calib_ = false;
+    rgb_distortion_.clear();
+    depth_to_rgb_extrinsics_.clear();
+    right_rectification_.clear();
+    stereo_baseline_ = 0.0f;
+
+    // Calibration is read over XLink once per device and cached on disk by mxid
+    std::filesystem::path cache_file = GetCalibCacheDir() / (oak_dev_serial_ + ".json");
+    std::error_code ec;
+    if (!from_device && std::filesystem::exists(cache_file, ec)) {
+        try {
+            calib_ = dai::CalibrationHandler(cache_file.string());
+            has_calib_ = true;
+        }
+        catch (const std::exception &e) {
+            std::cerr << "Ignoring invalid Oak calibration cache " << cache_file << ": " << e.what() << std::endl;
+        }
+    }
+    if (!has_calib_ && device->isEepromAvailable()) {
+        calib_ = device->readCalibration2();
+        has_calib_ = true;
+        std::filesystem::create_directories(cache_file.parent_path(), ec);
+        if (ec || !calib_.eepromToJsonFile(cache_file.string()))
+            std::cerr << "Unable to write Oak calibration cache " << cache_file << std::endl;
+    }
+    if (!has_calib_)
+        return;
+
+    // Resolution independent parameters, invalid entries are left empty
+    try {
+        if (has_rgb_)
+            rgb_distortion_ = calib_.getDistortionCoefficients(dai::CameraBoardSocket::RGB);
+        if (has_depth_) {
+            right_rectification_ = calib_.getStereoRightRectificationRotation();
+            stereo_baseline_ = calib_.getBaselineDistance(dai::CameraBoardSocket::RIGHT, dai::CameraBoardSocket::LEFT, false);
+        }
+        if (has_rgb_ && has_depth_)
+            depth_to_rgb_extrinsics_ = calib_.getCameraExtrinsics(dai::CameraBoardSocket::RIGHT, dai::CameraBoardSocket::RGB);
+    }
+    catch (const std::exception &e) {
+        std::cerr << "Incomplete Oak calibration: " << e.what() << std::endl;
+    }
+}
+
+void oak_camera::ReloadCalibration()
+{
+    std::lock_guard<std::mutex> lck(io_mutex_);
+    if (is_init_) {
+        LoadCalibration_(true);
+        rgb_intrinsics_.clear();
+        depth_intrinsics_.clear();
+        UpdateCalibData_();
+    }
+}
+
+void oak_camera::UpdateCalibData_()
+{
+    std::vector<std::vector<float>> depth_intrinsics;
+    std::vector<std::vector<float>> rgb_intrinsics;
+
+    if (has_calib_) {
+        try {
+            if (is_color_streaming_) {
+                int width = color_size_.width;
+                int height = color_size_.height;
+                rgb_intrinsics = calib_.getCameraIntrinsics(dai::CameraBoardSocket::RGB, width, height);
+            }
+
+            if (is_depth_streaming_) {
+                // Depth aligned on device is reprojected into the color camera and shares its intrinsics
+                if (IsDepthAlignedToColor_())
+                    depth_intrinsics = rgb_intrinsics;
+                else
+                    depth_intrinsics = calib_.getCameraIntrinsics(dai::CameraBoardSocket::RIGHT, right->getResolutionWidth(), right->getResolutionHeight());
+            }
+        }
+        catch (const std::exception &e) {
+            std::cerr << "Error reading Oak intrinsics: " << e.what() << std::endl;
+        }
+    }
+
+    if (depth_intrinsics != depth_intrinsics_ || rgb_intrinsics != rgb_intrinsics_) {
+        depth_intrinsics_ = depth_intrinsics;
+        rgb_intrinsics_ = rgb_intrinsics;
+        calib_id_++;
+        calib_changed_ = true;
+    }
+}
+
+bool oak_camera::IsDepthAlignedToColor_() const
+{
+    return is_color_streaming_ && depth_align_mode_ == DepthAlign_Device;
+}
+
+cv::Mat &oak_camera::GetFrame(dai::CameraBoardSocket stream)
+{
+    if (stream == dai::CameraBoardSocket::AUTO)
+        return depth_frame_;
+
+    return color_frame_;
+}
+
+cv::Mat &oak_camera::GetUndistortedFrame()
+{
+    return color_undistorted_frame_;
+}
+
+cv::Mat &oak_camera::GetRegisteredFrame()
+{
+    return depth_registered_frame_;
+}
+
+void oak_camera::SetUndistortColor(bool enable)
+{
+    undistort_color_ = enable;
+    if (!enable)
+        color_undistorted_frame_.release();
+}
+
+bool oak_camera::GetUndistortColor() const
+{
+    return undistort_color_;
+}
+
+void oak_camera::SetDepthAlignMode(int mode)
+{
+    if (mode == depth_align_mode_)
+        return;
+
+    depth_align_mode_ = mode;
+    // Device alignment is part of the stereo node so switching needs a pipeline rebuild
+    if (is_depth_enabled_ && is_color_enabled_)
+        reconfigure_ = true;
+}
+
+int oak_camera::GetDepthAlignMode() const
+{
+    return depth_align_mode_;
+}
+
+cv::Mat &oak_camera::GetPreviewFrame()
+{
+    return preview_frame_;
+}
+
+cv::Mat &oak_camera::GetCompressedDepthFrame()
+{
+    return depth_compressed_frame_;
+}
+
+void oak_camera::UpdateHostExposure_(dai::ImgFrame &frame, nlohmann::json &meta)
+{
+    if (color_props_.size() != ColorProp_Count)
+        return;
+
+    // The ISP output is NV12, its first plane is the luma the controller wants
+    bool stepped;
+    int frame_exposure = (int)frame.getExposureTime().count();
+    int frame_iso = frame.getSensitivity();
+    if (frame.getType() == dai::ImgFrame::Type::NV12) {
+        const auto &data = frame.getData();
+        int width = (int)frame.getWidth();
+        int height = (int)frame.getHeight();
+        if (data.size() < (size_t)width * height)
+            return;
+        stepped = host_ae_.Update(data.data(), width, height, width, frame_exposure, frame_iso);
+    }
+    else {
+        cv::Mat gray;
+        cv::cvtColor(color_frame_, gray, cv::COLOR_BGR2GRAY);
+        stepped = host_ae_.Update(gray.data, gray.cols, gray.rows, (int)gray.step, frame_exposure, frame_iso);
+    }
+
+    // The first frame after enabling takes over from the device AE where it stood, even when already converged.
+    // Exposure and ISO go out with any other pending color change as one control message
+    bool take_over = (bool)color_props_[ColorProp_Auto_Exposure].value && frame_exposure > 0 && frame_iso > 0;
+    if (stepped || take_over) {
+        auto &exposure = color_props_[ColorProp_Exposure];
+        auto &iso = color_props_[ColorProp_ISO];
+        exposure.value = std::clamp(stepped ? host_ae_.GetExposure() : frame_exposure, exposure.range.min, exposure.range.max);
+        iso.value = std::clamp(stepped ? host_ae_.GetIso() : frame_iso, iso.range.min, iso.range.max);
+        SetProperty(dai::CameraBoardSocket::RGB, ColorProp_Exposure);
+        SetProperty(dai::CameraBoardSocket::RGB, ColorProp_ISO);
+    }
+
+    nlohmann::json ae;
+    ae["mean"] = host_ae_.GetMean();
+    ae["clipped"] = host_ae_.GetClipped();
+    ae["target"] = host_ae_.GetTarget();
+    ae["flicker"] = kFlickerModes[host_ae_.GetFlicker()];
+    ae["converged"] = host_ae_.IsConverged();
+    ae["exposure_us"] = color_props_[ColorProp_Exposure].value;
+    ae["iso"] = color_props_[ColorProp_ISO].value;
+    meta["host_ae"] = ae;
+}
+
+void oak_camera::SetHostAutoExposure(bool enable)
+{
+    if (enable == host_ae_enabled_)
+        return;
+
+    host_ae_enabled_ = enable;
+    host_ae_.Reset();
+    // Hand exposure back to the device AE, taking over happens on the next frame
+    if (!enable && color_props_.size() == ColorProp_Count) {
+        color_props_[ColorProp_Auto_Exposure].value = (int)true;
+        SetProperty(dai::CameraBoardSocket::RGB, ColorProp_Auto_Exposure);
+    }
+}
+
+bool oak_camera::GetHostAutoExposure() const
+{
+    return host_ae_enabled_;
+}
+
+void oak_camera::SetHostAutoExposureConfig(int target, int flicker, const cv::Rect2f &region)
+{
+    host_ae_.SetTarget(target);
+    host_ae_.SetFlicker(flicker);
+    host_ae_.SetRegion(region);
+}
+
+int oak_camera::GetHostAutoExposureTarget() const
+{
+    return host_ae_.GetTarget();
+}
+
+int oak_camera::GetHostAutoExposureFlicker() const
+{
+    return host_ae_.GetFlicker();
+}
+
+const cv::Rect2f &oak_camera::GetHostAutoExposureRegion() const
+{
+    return host_ae_.GetRegion();
+}
+
+void oak_camera::SetMaskEnabled(bool enable)
+{
+    mask_enabled_ = enable;
+    if (!enable) {
+        mask_frame_.release();
+        masked_color_frame_.release();
+    }
+}
+
+bool oak_camera::GetMaskEnabled() const
+{
+    return mask_enabled_;
+}
+
+void oak_camera::SetMaskRange(int near_mm, int far_mm)
+{
+    mask_.SetRange(near_mm, far_mm);
+}
+
+int oak_camera::GetMaskNear() const
+{
+    return mask_.GetNear();
+}
+
+int oak_camera::GetMaskFar() const
+{
+    return mask_.GetFar();
+}
+
+void oak_camera::SetMaskCleanup(int radius)
+{
+    mask_.SetCleanup(radius);
+}
+
+int oak_camera::GetMaskCleanup() const
+{
+    return mask_.GetCleanup();
+}
+
+void oak_camera::SetMaskColor(bool enable)
+{
+    mask_color_ = enable;
+    if (!enable)
+        masked_color_frame_.release();
+}
+
+bool oak_camera::GetMaskColor() const
+{
+    return mask_color_;
+}
+
+cv::Mat &oak_camera::GetMaskFrame()
+{
+    return mask_frame_;
+}
+
+cv::Mat &oak_camera::GetMaskedColorFrame()
+{
+    return masked_color_frame_;
+}
+
+void oak_camera::SetCompressDepth(bool enable)
+{
+    compress_depth_ = enable;
+    if (!enable) {
+        depth_compressed_frame_.release();
+        depth_codec_scratch_.release();
+    }
+}
+
+bool oak_camera::GetCompressDepth() const
+{
+    return compress_depth_;
+}
+
+nlohmann::json &oak_camera::GetTelemetry()
+{
+    return telemetry_;
+}
+
+const std::vector<std::string> &oak_camera::GetUsbSpeedList()
+{
+    return usb_speed_names_;
+}
+
+void oak_camera::SetMaxUsbSpeed(int index)
+{
+    if (index < 0 || index >= usb_speed_names_.size() || kUsbSpeeds[index] == max_usb_speed_)
+        return;
+
+    // Takes effect when the device is next opened
+    max_usb_speed_ = kUsbSpeeds[index];
+    if (is_color_enabled_ || is_depth_enabled_)
+        reconfigure_ = true;
+}
+
+int oak_camera::GetMaxUsbSpeed() const
+{
+    for (int i = 0; i < sizeof(kUsbSpeeds) / sizeof(kUsbSpeeds[0]); i++) {
+        if (kUsbSpeeds[i] == max_usb_speed_)
+            return i;
+    }
+
+    return 0;
+}
+
+void oak_camera::SetAutoFitBandwidth(bool enable)
+{
+    if (enable == auto_fit_bandwidth_)
+        return;
+
+    auto_fit_bandwidth_ = enable;
+    if (enable && bandwidth_plan_.contains("fits") && !bandwidth_plan_["fits"].get<bool>())
+        reconfigure_ = true;
+}
+
+bool oak_camera::GetAutoFitBandwidth() const
+{
+    return auto_fit_bandwidth_;
+}
+
+nlohmann::json &oak_camera::GetBandwidthPlan()
+{
+    return bandwidth_plan_;
+}
+
+void oak_camera::SetAdaptiveFps(bool enable)
+{
+    if (enable == adaptive_fps_)
+        return;
+
+    // Frame skip nodes are only part of the pipeline while the governor is active
+    adaptive_fps_ = enable;
+    if (is_color_enabled_ || is_depth_enabled_)
+        reconfigure_ = true;
+}
+
+bool oak_camera::GetAdaptiveFps() const
+{
+    return adaptive_fps_;
+}
+
+void oak_camera::SetAdaptiveFpsBounds(int min_fps, int max_fps)
+{
+    // Picked up by the next governor window
+    governor_.SetBounds(min_fps, max_fps);
+}
+
+int oak_camera::GetAdaptiveFpsMin() const
+{
+    return governor_.GetMinFps();
+}
+
+int oak_camera::GetAdaptiveFpsMax() const
+{
+    return governor_.GetMaxFps();
+}
+
+void oak_camera::SetMemoryBudget(int budget_mb)
+{
+    if (std::max(0, budget_mb) == memory_.GetBudget())
+        return;
+
+    RestoreMemoryLevel_();
+    memory_.SetBudget(budget_mb);
+}
+
+int oak_camera::GetMemoryBudget() const
+{
+    return memory_.GetBudget();
+}
+
+void oak_camera::ResetMemoryLevel()
+{
+    RestoreMemoryLevel_();
+}
+
+void oak_camera::RestoreMemoryLevel_()
+{
+    int level = memory_.GetLevel();
+    memory_.Reset();
+    if (level == MemoryLevel_None)
+        return;
+
+    // Queue depth and stream modes are pipeline settings, derived outputs resume on their own
+    if (level >= MemoryLevel_Fusion) {
+        fusion_shrunk_bytes_ = std::numeric_limits<size_t>::max();
+        fusion_.SetMemoryBudget((size_t)fusion_budget_mb_ * 1024 * 1024);
+    }
+    if (level >= MemoryLevel_Resolution) {
+        if (is_color_enabled_ && !requested_color_cfg_.fps_list.empty())
+            active_color_cfg_ = requested_color_cfg_;
+        if (is_depth_enabled_ && !requested_depth_cfg_.fps_list.empty())
+            active_depth_cfg_ = requested_depth_cfg_;
+    }
+    if (is_color_enabled_ || is_depth_enabled_)
+        reconfigure_ = true;
+}
+
+static int FindConfig(const std::vector<StreamConfig> &configs, const StreamConfig &active)
+{
+    for (int i = 0; i < configs.size(); i++) {
+        if (configs[i].str_resolution == active.str_resolution)
+            return i;
+    }
+
+    return -1;
+}
+
+bool oak_camera::StepMemoryResolution_(bool apply)
+{
+    // The stream with the bigger frames steps to the next smaller mode, configs are sorted largest first
+    auto frame_bytes = [](const StreamConfig &cfg, float bytes_per_pixel) {
+        return (double)cfg.width * cfg.height * bytes_per_pixel;
+    };
+    int color_idx = is_color_enabled_ ? FindConfig(color_configs_, active_color_cfg_) : -1;
+    int depth_idx = is_depth_enabled_ ? FindConfig(depth_configs_, active_depth_cfg_) : -1;
+    bool color_can = color_idx >= 0 && color_idx + 1 < color_configs_.size();
+    bool depth_can = depth_idx >= 0 && depth_idx + 1 < depth_configs_.size() && !IsDepthAlignedToColor_();
+    if (!color_can && !depth_can)
+        return false;
+    if (!apply)
+        return true;
+
+    // NV12 on the queue plus BGR once converted for color, RAW16 for depth
+    bool step_color = color_can && (!depth_can || frame_bytes(active_color_cfg_, 4.5f) >= frame_bytes(active_depth_cfg_, 2.0f));
+    auto &configs = step_color ? color_configs_ : depth_configs_;
+    auto &active = step_color ? active_color_cfg_ : active_depth_cfg_;
+    int fps = active.fps_list.at(active.fps_idx);
+    active = configs[(step_color ? color_idx : depth_idx) + 1];
+    active.fps_idx = (int)active.fps_list.size() - 1;
+    for (int i = 0; i < active.fps_list.size(); i++) {
+        if (active.fps_list[i] <= fps) {
+            active.fps_idx = i;
+            break;
+        }
+    }
+    reconfigure_ = true;
+
+    return true;
+}
+
+nlohmann::json oak_camera::UpdateMemory_(const nlohmann::json &meta)
+{
+    // Queues are accounted at their depth with the last frame size seen on them, whether full or not
+    MemoryUsage usage{};
+    usage.frames = memory_budget::MatBytes(color_frame_) + memory_budget::MatBytes(depth_frame_) +
+                   memory_budget::MatBytes(preview_frame_) + memory_budget::MatBytes(still_frame_);
+    usage.derived = memory_budget::MatBytes(color_undistorted_frame_) + memory_budget::MatBytes(depth_registered_frame_) +
+                    memory_budget::MatBytes(depth_compressed_frame_) + memory_budget::MatBytes(depth_codec_scratch_) +
+                    memory_budget::MatBytes(mask_frame_) + memory_budget::MatBytes(masked_color_frame_) +
+                    memory_budget::MatBytes(fusion_points_);
+    for (const auto &name : queueNames) {
+        auto it = queue_frame_bytes_.find(name);
+        if (it != queue_frame_bytes_.end())
+            usage.queues += it->second * memory_.GetQueueDepth();
+    }
+    usage.metadata = meta.dump().size() + scan_data_.dump().size() + feature_data_.dump().size() + spatial_data_.dump().size();
+    usage.fusion = fusion_enabled_ ? fusion_.GetStats().memory_bytes : 0;
+
+    if (memory_.Update(usage, StepMemoryResolution_(false))) {
+        int level = memory_.GetLevel();
+        std::cerr << "Oak host memory " << usage.Total() / (1024 * 1024) << " MB over the " << memory_.GetBudget()
+                  << " MB budget, reducing: " << memory_budget::GetLevelName(level) << std::endl;
+        if (level <= MemoryLevel_Queue1) {
+            for (const auto &name : queueNames)
+                SetQueueDepth_(name, memory_.GetQueueDepth());
+        }
+        if (level == MemoryLevel_NoDerived) {
+            color_undistorted_frame_.release();
+            depth_registered_frame_.release();
+            depth_compressed_frame_.release();
+            depth_codec_scratch_.release();
+            mask_frame_.release();
+            masked_color_frame_.release();
+        }
+        if (level == MemoryLevel_Fusion && usage.fusion > 0) {
+            // Shrink the volume by the overshoot, eviction drops its least recently observed blocks
+            size_t over = usage.Total() - (size_t)memory_.GetBudget() * 1024 * 1024;
+            fusion_shrunk_bytes_ = usage.fusion > over ? usage.fusion - over : 0;
+            fusion_.SetMemoryBudget(fusion_shrunk_bytes_);
+        }
+        if (level >= MemoryLevel_Resolution)
+            StepMemoryResolution_(true);
+    }
+
+    auto to_mb = [](size_t bytes) {
+        return (double)bytes / (1024.0 * 1024.0);
+    };
+    nlohmann::json memory;
+    memory["frames_mb"] = to_mb(usage.frames);
+    memory["derived_mb"] = to_mb(usage.derived);
+    memory["queues_mb"] = to_mb(usage.queues);
+    memory["metadata_mb"] = to_mb(usage.metadata);
+    memory["fusion_mb"] = to_mb(usage.fusion);
+    memory["total_mb"] = to_mb(usage.Total());
+    memory["budget_mb"] = memory_.GetBudget();
+    memory["level"] = memory_budget::GetLevelName(memory_.GetLevel());
+    memory["queue_depth"] = memory_.GetQueueDepth();
+    memory["resolution_steps"] = memory_.GetResolutionSteps();
+
+    return memory;
+}
+
+void oak_camera::SetSoakMonitor(bool enable)
+{
+    if (enable == soak_enabled_)
+        return;
+
+    // Every run starts from a fresh baseline
+    soak_enabled_ = enable;
+    ResetSoak();
+}
+
+bool oak_camera::GetSoakMonitor() const
+{
+    return soak_enabled_;
+}
+
+void oak_camera::SetSoakBudget(const SoakBudget &budget)
+{
+    soak_.SetBudget(budget);
+}
+
+const SoakBudget &oak_camera::GetSoakBudget() const
+{
+    return soak_.GetBudget();
+}
+
+void oak_camera::ResetSoak()
+{
+    soak_.Reset();
+    soak_reported_ = 0;
+}
+
+nlohmann::json oak_camera::MakeSoakReport_()
+{
+    const auto &stats = soak_.GetStats();
+    const auto &budget = soak_.GetBudget();
+    nlohmann::json soak;
+    soak["uptime_min"] = stats.uptime_min;
+    soak["rss_mb"] = stats.rss_mb;
+    soak["rss_growth_mb"] = stats.rss_growth_mb;
+    soak["latency_p50_ms"] = stats.latency_p50_ms;
+    soak["latency_p95_ms"] = stats.latency_p95_ms;
+    soak["latency_p99_ms"] = stats.latency_p99_ms;
+    soak["latency_max_ms"] = stats.latency_max_ms;
+    soak["frames"] = stats.frames;
+    soak["reconfigures"] = stats.reconfigures;
+    soak["reconfigure_last_ms"] = stats.reconfigure_last_ms;
+    soak["reconfigure_max_ms"] = stats.reconfigure_max_ms;
+    soak["property_changes"] = stats.property_changes;
+    soak["budget"]["rss_growth_mb"] = budget.rss_growth_mb;
+    soak["budget"]["latency_p99_ms"] = budget.latency_p99_ms;
+    soak["budget"]["reconfigure_ms"] = budget.reconfigure_ms;
+    soak["status"] = stats.violations == 0 ? "ok" : "fail";
+    soak["violations"] = soak_monitor::GetViolationNames(stats.violations);
+
+    // Each exceeded budget is logged once per run
+    uint32_t fresh = stats.violations & ~soak_reported_;
+    if (fresh != 0) {
+        for (const auto &name : soak_monitor::GetViolationNames(fresh))
+            std::cerr << "Oak soak budget exceeded: " << name << std::endl;
+        soak_reported_ |= fresh;
+    }
+
+    return soak;
+}
+
+nlohmann::json &oak_camera::GetScanData()
+{
+    return scan_data_;
+}
+
+nlohmann::json &oak_camera::GetSpatialData()
+{
+    return spatial_data_;
+}
+
+void oak_camera::SetDepthOutput(bool enable)
+{
+    if (enable == depth_output_enabled_)
+        return;
+
+    depth_output_enabled_ = enable;
+    if (!enable)
+        depth_frame_.release();
+    if (is_depth_enabled_)
+        reconfigure_ = true;
+}
+
+bool oak_camera::GetDepthOutput() const
+{
+    return depth_output_enabled_;
+}
+
+void oak_camera::SetSpatialEnabled(bool enable)
+{
+    if (enable == spatial_enabled_)
+        return;
+
+    spatial_enabled_ = enable;
+    if (!enable)
+        spatial_data_.clear();
+    if (is_depth_enabled_)
+        reconfigure_ = true;
 }
 
-void oak_camera::UpdateCalibData_()
+bool oak_camera::GetSpatialEnabled() const
 {
-    if (is_depth_streaming_) {
-        int width = right->getResolutionWidth();
-        int height = right->getResolutionHeight();
-        if (is_color_streaming_) {
-            width = camRgb->getIspWidth();
-            height = camRgb->getIspHeight();
-        }
-        depth_intrinsics_ = device->readCalibration2().getCameraIntrinsics(dai::CameraBoardSocket::RIGHT, width, height);
+    return spatial_enabled_;
+}
+
+void oak_camera::SetSpatialRois(const std::vector<cv::Rect2f> &rois)
+{
+    // The calculator needs at least one ROI, an empty list keeps the current one
+    if (rois.empty() || rois == spatial_rois_)
+        return;
+
+    spatial_rois_.clear();
+    for (const auto &roi : rois) {
+        float x = std::clamp(roi.x, 0.0f, 1.0f);
+        float y = std::clamp(roi.y, 0.0f, 1.0f);
+        spatial_rois_.emplace_back(x, y, std::clamp(roi.width, 0.0f, 1.0f - x), std::clamp(roi.height, 0.0f, 1.0f - y));
+    }
+    spatial_config_changed_ = true;
+}
+
+const std::vector<cv::Rect2f> &oak_camera::GetSpatialRois() const
+{
+    return spatial_rois_;
+}
+
+void oak_camera::SetSpatialConfig(int algorithm, int lower_mm, int upper_mm)
+{
+    spatial_algorithm_ = std::clamp(algorithm, 0, (int)(sizeof(kSpatialAlgorithms) / sizeof(kSpatialAlgorithms[0])) - 1);
+    spatial_lower_ = std::max(0, lower_mm);
+    spatial_upper_ = std::max(spatial_lower_ + 1, upper_mm);
+    spatial_config_changed_ = true;
+}
+
+int oak_camera::GetSpatialAlgorithm() const
+{
+    return spatial_algorithm_;
+}
+
+int oak_camera::GetSpatialLower() const
+{
+    return spatial_lower_;
+}
+
+int oak_camera::GetSpatialUpper() const
+{
+    return spatial_upper_;
+}
+
+nlohmann::json &oak_camera::GetFeatureData()
+{
+    return feature_data_;
+}
+
+void oak_camera::SetFeatureSource(int source)
+{
+    // Saved states may come from elsewhere, the source indexes the metadata names
+    source = std::clamp(source, (int)FeatureSource_Off, (int)FeatureSource_Right);
+    if (source == feature_source_)
+        return;
+
+    feature_source_ = source;
+    if (source == FeatureSource_Off)
+        feature_data_.clear();
+    if (is_color_enabled_ || is_depth_enabled_)
+        reconfigure_ = true;
+}
+
+int oak_camera::GetFeatureSource() const
+{
+    return feature_source_;
+}
+
+void oak_camera::SetFeatureConfig(int max_features, int corner_detector, int motion)
+{
+    // Same limits as the GUI, saved states may hold anything
+    using CornerType = dai::FeatureTrackerConfig::CornerDetector::Type;
+    feature_max_ = std::clamp(max_features, 8, 320);
+    feature_corner_ = std::clamp(corner_detector, (int)CornerType::HARRIS, (int)CornerType::SHI_THOMASI);
+    feature_motion_ = std::clamp(motion, (int)FeatureMotion_Off, (int)FeatureMotion_Hardware);
+    feature_config_changed_ = true;
+}
+
+int oak_camera::GetFeatureMaxFeatures() const
+{
+    return feature_max_;
+}
+
+int oak_camera::GetFeatureCornerDetector() const
+{
+    return feature_corner_;
+}
+
+int oak_camera::GetFeatureMotion() const
+{
+    return feature_motion_;
+}
+
+void oak_camera::SetScanEnabled(bool enable)
+{
+    scan_enabled_ = enable;
+    if (!enable)
+        scan_data_.clear();
+}
+
+bool oak_camera::GetScanEnabled() const
+{
+    return scan_enabled_;
+}
+
+void oak_camera::SetScanBand(int top_pct, int bottom_pct)
+{
+    scan_.SetBand(top_pct, bottom_pct);
+}
+
+int oak_camera::GetScanBandTop() const
+{
+    return scan_.GetBandTop();
+}
+
+int oak_camera::GetScanBandBottom() const
+{
+    return scan_.GetBandBottom();
+}
+
+void oak_camera::SetGateEnabled(bool enable)
+{
+    if (enable == gate_enabled_)
+        return;
+
+    // The gate script is part of the pipeline only while gating is on
+    gate_enabled_ = enable;
+    if (is_color_enabled_ || is_depth_enabled_)
+        reconfigure_ = true;
+}
+
+bool oak_camera::GetGateEnabled() const
+{
+    return gate_enabled_;
+}
+
+void oak_camera::SetGateConfig(int threshold, int keepalive_ms)
+{
+    gate_threshold_ = std::clamp(threshold, 0, 254);
+    gate_keepalive_ms_ = std::clamp(keepalive_ms, 100, 65535);
+    gate_config_changed_ = true;
+}
+
+int oak_camera::GetGateThreshold() const
+{
+    return gate_threshold_;
+}
+
+int oak_camera::GetGateKeepAlive() const
+{
+    return gate_keepalive_ms_;
+}
+
+void oak_camera::SetFusionEnabled(bool enable)
+{
+    if (enable == fusion_enabled_)
+        return;
+
+    fusion_enabled_ = enable;
+    if (enable)
+        fusion_.Start();
+    else
+        fusion_.Stop();
+}
+
+bool oak_camera::GetFusionEnabled() const
+{
+    return fusion_enabled_;
+}
+
+void oak_camera::SetFusionConfig(int voxel_mm, int budget_mb, bool incremental)
+{
+    fusion_voxel_mm_ = std::clamp(voxel_mm, 2, 100);
+    fusion_budget_mb_ = std::clamp(budget_mb, 16, 8192);
+    fusion_incremental_ = incremental;
+    fusion_.SetVoxelSize((float)fusion_voxel_mm_ * 0.001f);
+    // A volume shrunk for the memory budget stays shrunk until the measures are lifted
+    fusion_.SetMemoryBudget(std::min((size_t)fusion_budget_mb_ * 1024 * 1024, fusion_shrunk_bytes_));
+}
+
+int oak_camera::GetFusionVoxelSize() const
+{
+    return fusion_voxel_mm_;
+}
+
+int oak_camera::GetFusionBudget() const
+{
+    return fusion_budget_mb_;
+}
+
+bool oak_camera::GetFusionIncremental() const
+{
+    return fusion_incremental_;
+}
+
+void oak_camera::SetFusionPose(const cv::Matx44f &pose)
+{
+    fusion_pose_ = pose;
+}
+
+void oak_camera::ResetFusion()
+{
+    fusion_.Reset();
+}
+
+void oak_camera::ExtractFusionPoints()
+{
+    // N x 1 CV_32FC3 in meters, world frame of the supplied poses
+    fusion_.ExtractPoints(fusion_scratch_, fusion_incremental_);
+    fusion_points_ = cv::Mat((int)fusion_scratch_.size(), 1, CV_32FC3);
+    if (!fusion_scratch_.empty())
+        std::memcpy(fusion_points_.data, fusion_scratch_.data(), fusion_scratch_.size() * sizeof(cv::Point3f));
+}
+
+cv::Mat &oak_camera::GetFusionPoints()
+{
+    return fusion_points_;
+}
+
+void oak_camera::SetStillCapture(bool enable, bool jpeg)
+{
+    if (enable == still_enabled_ && jpeg == still_jpeg_)
+        return;
+
+    still_enabled_ = enable;
+    still_jpeg_ = jpeg;
+    if (is_color_enabled_)
+        reconfigure_ = true;
+}
+
+bool oak_camera::GetStillCapture() const
+{
+    return still_enabled_;
+}
+
+bool oak_camera::GetStillJpeg() const
+{
+    return still_jpeg_;
+}
+
+void oak_camera::CaptureStill()
+{
+    if (!still_enabled_)
+        return;
+
+    still_requested_ = true;
+    change_props_ = true;
+}
+
+cv::Mat &oak_camera::GetStillFrame()
+{
+    return still_frame_;
+}
+
+void oak_camera::SetColorOutputs(bool full_res, bool preview)
+{
+    if (full_res == full_res_enabled_ && preview == preview_enabled_)
+        return;
+
+    full_res_enabled_ = full_res;
+    preview_enabled_ = preview;
+    if (is_color_enabled_)
+        reconfigure_ = true;
+}
+
+bool oak_camera::GetFullResOutput() const
+{
+    return full_res_enabled_;
+}
+
+bool oak_camera::GetPreviewOutput() const
+{
+    return preview_enabled_;
+}
+
+const std::vector<std::string> &oak_camera::GetPreviewSizeList()
+{
+    return preview_size_names_;
+}
+
+void oak_camera::SetPreviewSize(int index)
+{
+    if (index < 0 || index >= preview_size_names_.size() || index == preview_size_idx_)
+        return;
+
+    preview_size_idx_ = index;
+    if (is_color_enabled_ && preview_enabled_)
+        reconfigure_ = true;
+}
+
+int oak_camera::GetPreviewSize() const
+{
+    return preview_size_idx_;
+}
+
+cv::Size oak_camera::GetPreviewSize_(int index) const
+{
+    int width = kPreviewWidths[std::clamp(index, 0, (int)std::size(kPreviewWidths) - 1)];
+    double aspect = 16.0 / 9.0;
+    if (active_color_cfg_.width > 0 && active_color_cfg_.height > 0)
+        aspect = (double)active_color_cfg_.width / active_color_cfg_.height;
+
+    // Heights are kept even for the ISP scaler
+    return {width, (int)std::lround(width / aspect / 2.0) * 2};
+}
+
+void oak_camera::UpdatePreviewSizes_()
+{
+    preview_size_names_.clear();
+    for (int i = 0; i < std::size(kPreviewWidths); i++) {
+        cv::Size size = GetPreviewSize_(i);
+        preview_size_names_.emplace_back(std::to_string(size.width) + " x " + std::to_string(size.height));
     }
+}
 
-    if (is_color_streaming_) {
-        int width = camRgb->getIspWidth();
-        int height = camRgb->getIspHeight();
-        rgb_intrinsics_ = device->readCalibration2().getCameraIntrinsics(dai::CameraBoardSocket::RGB, width, height);
+void oak_camera::UpdateControlFeedback_(const dai::ImgFrame &frame, nlohmann::json &meta)
+{
+    if (control_pending_ && frame.getTimestamp() >= control_time_) {
+        // First frame captured after the last control transaction was sent, from here on wait for its values
+        control_sent_frame_num_ = frame.getSequenceNum();
+        control_frame_num_ = -1;
+        control_wait_frames_ = 0;
+        control_pending_ = false;
+    }
+    if (control_wait_frames_ >= 0) {
+        auto near = [](double reported, int sent, double min_tolerance) {
+            return sent < 0 || std::fabs(reported - sent) <= std::max(min_tolerance, sent * kControlMatchTolerance);
+        };
+        // Changes the frames do not report, such as brightness or auto modes, count as applied on the first frame
+        if (near((double)frame.getExposureTime().count(), control_exposure_us_, 50.0) && near(frame.getSensitivity(), control_iso_, 1.0) &&
+            near(frame.getLensPosition(), control_lens_pos_, 1.0) && near(frame.getColorTemperature(), control_color_temp_, 100.0)) {
+            control_frame_num_ = frame.getSequenceNum();
+            control_wait_frames_ = -1;
+        }
+        else if (++control_wait_frames_ > kControlApplyFrames) {
+            control_wait_frames_ = -1;
+        }
+    }
+    if (control_sent_frame_num_ >= 0) {
+        nlohmann::json control;
+        control["id"] = control_id_;
+        control["sent_frame_num"] = control_sent_frame_num_;
+        control["applied"] = control_frame_num_ >= 0;
+        if (control_frame_num_ >= 0)
+            control["frame_num"] = control_frame_num_;
+        else if (control_wait_frames_ < 0)
+            control["timed_out"] = true;
+        meta["control"] = control;
     }
 }
 
-cv::Mat &oak_camera::GetFrame(dai::CameraBoardSocket stream)
+void oak_camera::SetSharedMemoryPublish(bool enable)
 {
-    if (stream == dai::CameraBoardSocket::AUTO)
-        return depth_frame_;
+    shm_publish_ = enable;
+    if (!enable)
+        shm_publisher_.Close();
+}
 
-    return color_frame_;
+bool oak_camera::GetSharedMemoryPublish() const
+{
+    return shm_publish_;
+}
+
+std::string oak_camera::GetSharedMemoryName() const
+{
+    return shm_publisher_.GetName();
 }
 
 std::vector<StreamConfig> *oak_camera::GetStreamConfigList(dai::CameraBoardSocket stream_type)
@@ -433,7 +2977,7 @@ bool oak_camera::IsInit()
     return is_init_;
 }
 
-std::map<std::string, Property> *oak_camera::GetPropertyList(dai::CameraBoardSocket stream_type)
+std::vector<Property> *oak_camera::GetPropertyList(dai::CameraBoardSocket stream_type)
 {
     if (stream_type == dai::CameraBoardSocket::RGB)
         return &color_props_;
@@ -445,152 +2989,376 @@ std::map<std::string, Property> *oak_camera::GetPropertyList(dai::CameraBoardSoc
 
 void oak_camera::SetAllRgbControls()
 {
-    if (is_init_ && is_color_enabled_ && is_color_streaming_) {
-        dai::CameraControl ctrl;
+    if (is_init_ && is_color_enabled_ && is_color_streaming_)
+        SendColorControl_(true);
+}
+
+void oak_camera::SendColorControl_(bool send_all)
+{
+    if (color_props_.size() != ColorProp_Count)
+        return;
+
+    auto changed = [&](int prop) {
+        return send_all || color_props_[prop].has_changed;
+    };
+
+    dai::CameraControl ctrl;
+    bool props_changed = false;
+    for (const auto &prop : color_props_)
+        props_changed |= prop.has_changed;
+    // Manual values the frames report back once they are in effect
+    int exposure_us = -1;
+    int iso = -1;
+    int lens_pos = -1;
+    int color_temp = -1;
 
-        ctrl.setBrightness(color_props_["Brightness"].value);
-        ctrl.setContrast(color_props_["Contrast"].value);
-        ctrl.setSaturation(color_props_["Saturation"].value);
-        ctrl.setSharpness(color_props_["Sharpness"].value);
+    // Pending still request rides along with whatever else goes out
+    if (still_requested_) {
+        ctrl.setCaptureStill(true);
+        still_requested_ = false;
+        still_request_time_ = std::chrono::steady_clock::now();
+    }
+
+    if (changed(ColorProp_Brightness))
+        ctrl.setBrightness(color_props_[ColorProp_Brightness].value);
+    if (changed(ColorProp_Contrast))
+        ctrl.setContrast(color_props_[ColorProp_Contrast].value);
+    if (changed(ColorProp_Saturation))
+        ctrl.setSaturation(color_props_[ColorProp_Saturation].value);
+    if (changed(ColorProp_Sharpness))
+        ctrl.setSharpness(color_props_[ColorProp_Sharpness].value);
 
-        if (color_props_["Auto_Exposure"].value)
+    // An explicit Auto Exposure change wins, otherwise touching Exposure or ISO switches to manual exposure
+    if (changed(ColorProp_Auto_Exposure)) {
+        if ((bool)color_props_[ColorProp_Auto_Exposure].value) {
             ctrl.setAutoExposureEnable();
-        else
-            ctrl.setManualExposure(color_props_["Exposure"].value, color_props_["ISO"].value);
+        }
+        else {
+            exposure_us = color_props_[ColorProp_Exposure].value;
+            iso = color_props_[ColorProp_ISO].value;
+            ctrl.setManualExposure(exposure_us, iso);
+        }
+    }
+    else if (changed(ColorProp_Exposure) || changed(ColorProp_ISO)) {
+        color_props_[ColorProp_Auto_Exposure].value = (int)false;
+        exposure_us = color_props_[ColorProp_Exposure].value;
+        iso = color_props_[ColorProp_ISO].value;
+        ctrl.setManualExposure(exposure_us, iso);
+    }
 
-        if (color_props_["White_Balance_Mode"].value == 0)
-            ctrl.setManualWhiteBalance(color_props_["White_Balance"].value);
+    if (changed(ColorProp_White_Balance_Mode) || (changed(ColorProp_White_Balance) && color_props_[ColorProp_White_Balance_Mode].value == 0)) {
+        if (color_props_[ColorProp_White_Balance_Mode].value == 0) {
+            color_temp = color_props_[ColorProp_White_Balance].value;
+            ctrl.setManualWhiteBalance(color_temp);
+        }
         else
-            ctrl.setAutoWhiteBalanceMode((dai::CameraControl::AutoWhiteBalanceMode)(color_props_["White_Balance_Mode"].value));
+            ctrl.setAutoWhiteBalanceMode((dai::CameraControl::AutoWhiteBalanceMode)(color_props_[ColorProp_White_Balance_Mode].value));
+    }
 
-        ctrl.setAutoFocusMode((dai::CameraControl::AutoFocusMode)color_props_["Focus_Mode"].value);
-        if (color_props_["Focus_Mode"].value == 0)
-            ctrl.setManualFocus(color_props_["Focus_Pos"].value);
-        else
+    if (changed(ColorProp_Focus_Mode)) {
+        ctrl.setAutoFocusMode((dai::CameraControl::AutoFocusMode)color_props_[ColorProp_Focus_Mode].value);
+        if (color_props_[ColorProp_Focus_Mode].value == 0) {
+            lens_pos = color_props_[ColorProp_Focus_Pos].value;
+            ctrl.setManualFocus(lens_pos);
+        }
+        else {
             ctrl.setAutoFocusTrigger();
+        }
+    }
+    else if (changed(ColorProp_Focus_Pos) && color_props_[ColorProp_Focus_Mode].value == 0) {
+        lens_pos = color_props_[ColorProp_Focus_Pos].value;
+        ctrl.setManualFocus(lens_pos);
+    }
 
+    if (frame_source_ != nullptr)
+        frame_source_->SendControl(ctrl);
+    else
         controlQueue->send(ctrl);
+
+    for (auto &prop : color_props_)
+        prop.has_changed = false;
+
+    if (!send_all && !props_changed)
+        return;
+
+    control_id_++;
+    control_time_ = std::chrono::steady_clock::now();
+    control_pending_ = true;
+    control_sent_frame_num_ = -1;
+    control_frame_num_ = -1;
+    control_wait_frames_ = -1;
+    control_exposure_us_ = exposure_us;
+    control_iso_ = iso;
+    control_lens_pos_ = lens_pos;
+    control_color_temp_ = color_temp;
+}
+
+void oak_camera::ApplyStereoProperties_(dai::RawStereoDepthConfig &cfg)
+{
+    if (depth_props_.size() != DepthProp_Count)
+        return;
+
+    // Only what the user set goes on top of the preset
+    auto set = [&](int prop) {
+        return (depth_overrides_ & (1u << prop)) != 0;
+    };
+
+    if (set(DepthProp_Confidence))
+        cfg.costMatching.confidenceThreshold = (uint8_t)depth_props_[DepthProp_Confidence].value;
+    if (set(DepthProp_LR_Check))
+        cfg.algorithmControl.enableLeftRightCheck = (bool)depth_props_[DepthProp_LR_Check].value;
+    if (set(DepthProp_LR_Threshold))
+        cfg.algorithmControl.leftRightCheckThreshold = depth_props_[DepthProp_LR_Threshold].value;
+    if (set(DepthProp_Subpixel))
+        cfg.algorithmControl.enableSubpixel = (bool)depth_props_[DepthProp_Subpixel].value;
+    if (set(DepthProp_Subpixel_Bits))
+        cfg.algorithmControl.subpixelFractionalBits = 3 + depth_props_[DepthProp_Subpixel_Bits].value;
+    if (set(DepthProp_Median))
+        cfg.postProcessing.median = kMedianModes[depth_props_[DepthProp_Median].value];
+    // 7x7 median is not available together with subpixel
+    if (cfg.algorithmControl.enableSubpixel && cfg.postProcessing.median == dai::MedianFilter::KERNEL_7x7)
+        cfg.postProcessing.median = dai::MedianFilter::KERNEL_5x5;
+    if (set(DepthProp_Speckle))
+        cfg.postProcessing.speckleFilter.enable = (bool)depth_props_[DepthProp_Speckle].value;
+    if (set(DepthProp_Speckle_Range))
+        cfg.postProcessing.speckleFilter.speckleRange = depth_props_[DepthProp_Speckle_Range].value;
+    if (set(DepthProp_Temporal))
+        cfg.postProcessing.temporalFilter.enable = (bool)depth_props_[DepthProp_Temporal].value;
+    if (set(DepthProp_Temporal_Alpha))
+        cfg.postProcessing.temporalFilter.alpha = (float)depth_props_[DepthProp_Temporal_Alpha].value / 100.0f;
+    if (set(DepthProp_Temporal_Delta))
+        cfg.postProcessing.temporalFilter.delta = depth_props_[DepthProp_Temporal_Delta].value;
+}
+
+void oak_camera::SeedDepthProps_(const dai::RawStereoDepthConfig &cfg)
+{
+    if (depth_props_.size() != DepthProp_Count)
+        return;
+
+    // Properties the user has not set show what the preset configured
+    auto seed = [&](int prop, int value) {
+        if ((depth_overrides_ & (1u << prop)) == 0)
+            depth_props_[prop].value = std::clamp(value, depth_props_[prop].range.min, depth_props_[prop].range.max);
+    };
+
+    int median = 0;
+    for (int i = 0; i < (int)(sizeof(kMedianModes) / sizeof(kMedianModes[0])); i++) {
+        if (kMedianModes[i] == cfg.postProcessing.median)
+            median = i;
     }
+    seed(DepthProp_Confidence, cfg.costMatching.confidenceThreshold);
+    seed(DepthProp_LR_Check, cfg.algorithmControl.enableLeftRightCheck);
+    seed(DepthProp_LR_Threshold, cfg.algorithmControl.leftRightCheckThreshold);
+    seed(DepthProp_Subpixel, cfg.algorithmControl.enableSubpixel);
+    seed(DepthProp_Subpixel_Bits, cfg.algorithmControl.subpixelFractionalBits - 3);
+    seed(DepthProp_Median, median);
+    seed(DepthProp_Speckle, cfg.postProcessing.speckleFilter.enable);
+    seed(DepthProp_Speckle_Range, (int)cfg.postProcessing.speckleFilter.speckleRange);
+    seed(DepthProp_Temporal, cfg.postProcessing.temporalFilter.enable);
+    seed(DepthProp_Temporal_Alpha, (int)std::lround(cfg.postProcessing.temporalFilter.alpha * 100.0f));
+    seed(DepthProp_Temporal_Delta, cfg.postProcessing.temporalFilter.delta);
+}
+
+void oak_camera::SendStereoConfig_()
+{
+    dai::RawStereoDepthConfig raw = stereo_base_config_;
+    ApplyStereoProperties_(raw);
+    dai::StereoDepthConfig cfg;
+    cfg.set(raw);
+    if (frame_source_ != nullptr)
+        frame_source_->SendStereoConfig(cfg);
+    else
+        depthConfigQueue->send(cfg);
+
+    for (auto &prop : depth_props_)
+        prop.has_changed = false;
+    depth_config_time_ = std::chrono::steady_clock::now();
 }
 
-void oak_camera::SetProperty(dai::CameraBoardSocket stream_type, std::string prop_name, bool immediate_mode)
+void oak_camera::SetProperty(dai::CameraBoardSocket stream_type, int prop)
 {
     if (stream_type == dai::CameraBoardSocket::RGB) {
         if (is_init_ && is_color_enabled_ && is_color_streaming_) {
-            if (immediate_mode) {
-                if (color_props_.find(prop_name) != color_props_.end()) {
-                    dai::CameraControl ctrl;
-                    if (prop_name == "Brightness")
-                        ctrl.setBrightness(color_props_[prop_name].value);
-                    else if (prop_name == "Contrast")
-                        ctrl.setContrast(color_props_[prop_name].value);
-                    else if (prop_name == "Saturation")
-                        ctrl.setSaturation(color_props_[prop_name].value);
-                    else if (prop_name == "Sharpness")
-                        ctrl.setSharpness(color_props_[prop_name].value);
-                    else if (prop_name == "Exposure") {
-                        color_props_["Auto_Exposure"].value = (int)false;
-                        ctrl.setManualExposure(color_props_["Exposure"].value, color_props_["ISO"].value);
-                    }
-                    else if (prop_name == "ISO") {
-                        color_props_["Auto_Exposure"].value = (int)false;
-                        ctrl.setManualExposure(color_props_["Exposure"].value, color_props_["ISO"].value);
-                    }
-                    else if (prop_name == "Auto_Exposure") {
-                        if ((bool)color_props_[prop_name].value)
-                            ctrl.setAutoExposureEnable();
-                        else
-                            ctrl.setManualExposure(color_props_["Exposure"].value, color_props_["ISO"].value);
-                    }
-                    else if (prop_name == "White_Balance_Mode") {
-                        if (color_props_[prop_name].value == 0)
-                            ctrl.setManualWhiteBalance(color_props_["White_Balance"].value);
-                        else
-                            ctrl.setAutoWhiteBalanceMode((dai::CameraControl::AutoWhiteBalanceMode)(color_props_[prop_name].value));
-                    }
-                    else if (prop_name == "White_Balance") {
-                        if (color_props_["White_Balance_Mode"].value == 0)
-                            ctrl.setManualWhiteBalance(color_props_["White_Balance"].value);
-                    }
-                    else if (prop_name == "Focus_Mode") {
-                        ctrl.setAutoFocusMode((dai::CameraControl::AutoFocusMode) color_props_[prop_name].value);
-                        if (color_props_[prop_name].value == 0)
-                            ctrl.setManualFocus(color_props_["Focus_Pos"].value);
-                        else
-                            ctrl.setAutoFocusTrigger();
-                    }
-                    else if (prop_name == "Focus_Pos") {
-                        if (color_props_["Focus_Mode"].value == 0)
-                            ctrl.setManualFocus(color_props_["Focus_Pos"].value);
-                    }
-                    controlQueue->send(ctrl);
-                }
-            } else {
-                if (color_props_.find(prop_name) != color_props_.end()) {
-                    color_props_[prop_name].has_changed = true;
-                    change_props_ = true;
-                }
+            if (prop >= 0 && prop < color_props_.size()) {
+                color_props_[prop].has_changed = true;
+                change_props_ = true;
+                soak_.AddPropertyChange();
             }
         }
     }
     else if (stream_type == dai::CameraBoardSocket::AUTO) {
         if (is_init_ && is_depth_enabled_ && is_depth_streaming_) {
-            if (depth_props_.find(prop_name) != depth_props_.end()) {
-                if (prop_name == "Preset") {
-                    if (depth_props_[prop_name].value == 0)
-                        stereo->setDefaultProfilePreset(dai::node::StereoDepth::PresetMode::HIGH_ACCURACY);
-                    else if (depth_props_[prop_name].value == 1)
-                        stereo->setDefaultProfilePreset(dai::node::StereoDepth::PresetMode::HIGH_DENSITY);
-                }
+            // Preset is a pipeline setting, it can only be applied by rebuilding the stereo node
+            if (prop == DepthProp_Preset) {
+                reconfigure_ = true;
+                soak_.AddPropertyChange();
+            }
+            else if (prop > DepthProp_Preset && prop < depth_props_.size()) {
+                depth_props_[prop].has_changed = true;
+                change_props_ = true;
+                soak_.AddPropertyChange();
             }
         }
     }
 }
 
-int oak_camera::GetProperty(dai::CameraBoardSocket stream_type, std::string& prop_name)
+void oak_camera::SetPropertyValue(dai::CameraBoardSocket stream_type, int prop, int value)
 {
-    if (stream_type == dai::CameraBoardSocket::RGB) {
-        if (color_props_.find(prop_name) != color_props_.end())
-            return color_props_[prop_name].value;
-    }
-    else if (stream_type == dai::CameraBoardSocket::AUTO) {
-        if (depth_props_.find(prop_name) != depth_props_.end())
-            return depth_props_[prop_name].value;
-    }
+    auto props = GetPropertyList(stream_type);
+    if (props == nullptr || prop < 0 || prop >= props->size())
+        return;
+
+    auto &property = props->at(prop);
+    property.value = std::clamp(value, property.range.min, property.range.max);
+    // A new preset starts over from its own tuning, anything set after it is kept across rebuilds
+    if (stream_type == dai::CameraBoardSocket::AUTO)
+        depth_overrides_ = (prop == DepthProp_Preset) ? 0 : (depth_overrides_ | (1u << prop));
+    SetProperty(stream_type, prop);
+}
+
+std::shared_ptr<CameraSnapshot> oak_camera::MakeSnapshot()
+{
+    auto snap = std::make_shared<CameraSnapshot>();
+    snap->version = ++snapshot_version_;
+    snap->command_seq = 0;
+    snap->is_init = is_init_;
+    snap->device_idx = init_idx_;
+    snap->shared_clients = 0;
+    snap->color_override.clear();
+    snap->depth_override.clear();
+    snap->device_name = oak_dev_name_;
+    snap->device_list = camera_name_list_;
+    for (const auto &info : infos_)
+        snap->device_serials.emplace_back(info.mxid);
+    snap->is_reconnecting = link_lost_;
+    snap->reconnect_attempts = reconnect_attempts_;
+    snap->has_color = has_rgb_;
+    snap->has_depth = has_depth_;
+    snap->color_enabled = is_color_enabled_;
+    snap->depth_enabled = is_depth_enabled_;
+    snap->color_configs = color_configs_;
+    snap->depth_configs = depth_configs_;
+    snap->color_props = color_props_;
+    snap->depth_props = depth_props_;
+    snap->shm_publish = shm_publish_;
+    snap->shm_name = shm_publisher_.GetName();
+    snap->usb_speed_list = usb_speed_names_;
+    snap->max_usb_speed = GetMaxUsbSpeed();
+    snap->auto_fit_bandwidth = auto_fit_bandwidth_;
+    snap->adaptive_fps = adaptive_fps_;
+    snap->adaptive_fps_min = GetAdaptiveFpsMin();
+    snap->adaptive_fps_max = GetAdaptiveFpsMax();
+    snap->feature_source = feature_source_;
+    snap->feature_max = feature_max_;
+    snap->feature_corner = feature_corner_;
+    snap->feature_motion = feature_motion_;
+    snap->telemetry = telemetry_;
+    snap->bandwidth_plan = bandwidth_plan_;
+    snap->undistort_color = GetUndistortColor();
+    snap->full_res_output = full_res_enabled_;
+    snap->preview_output = preview_enabled_;
+    snap->preview_size = preview_size_idx_;
+    snap->preview_size_list = preview_size_names_;
+    snap->still_capture = still_enabled_;
+    snap->still_jpeg = still_jpeg_;
+    snap->depth_align_mode = depth_align_mode_;
+    snap->depth_output = depth_output_enabled_;
+    snap->compress_depth = compress_depth_;
+    snap->scan_enabled = scan_enabled_;
+    snap->scan_band_top = scan_.GetBandTop();
+    snap->scan_band_bottom = scan_.GetBandBottom();
+    snap->host_ae_enabled = host_ae_enabled_;
+    snap->host_ae_target = host_ae_.GetTarget();
+    snap->host_ae_flicker = host_ae_.GetFlicker();
+    snap->host_ae_region = host_ae_.GetRegion();
+    snap->mask_enabled = mask_enabled_;
+    snap->mask_near = mask_.GetNear();
+    snap->mask_far = mask_.GetFar();
+    snap->mask_cleanup = mask_.GetCleanup();
+    snap->mask_color = mask_color_;
+    snap->spatial_enabled = spatial_enabled_;
+    snap->spatial_algorithm = spatial_algorithm_;
+    snap->spatial_lower = spatial_lower_;
+    snap->spatial_upper = spatial_upper_;
+    snap->spatial_rois = spatial_rois_;
+    snap->gate_enabled = gate_enabled_;
+    snap->gate_threshold = gate_threshold_;
+    snap->gate_keepalive_ms = gate_keepalive_ms_;
+    snap->fusion_enabled = fusion_enabled_;
+    snap->fusion_incremental = fusion_incremental_;
+    snap->fusion_voxel_mm = fusion_voxel_mm_;
+    snap->fusion_budget_mb = fusion_budget_mb_;
+    snap->fusion_stats = fusion_.GetStats();
+    snap->memory_budget_mb = memory_.GetBudget();
+    snap->memory_level = memory_.GetLevel();
+    snap->memory_usage = memory_.GetUsage();
+    snap->soak_enabled = soak_enabled_;
+    snap->soak_budget = soak_.GetBudget();
+    snap->soak_stats = soak_.GetStats();
+    snap->soak_rss_history = soak_.GetRssHistory();
+    snap->soak_latency_history = soak_.GetLatencyHistory();
+
+    return snap;
+}
+
+int oak_camera::GetProperty(dai::CameraBoardSocket stream_type, int prop)
+{
+    auto props = GetPropertyList(stream_type);
+    if (props != nullptr && prop >= 0 && prop < props->size())
+        return props->at(prop).value;
 
     return 0;
 }
 
 void oak_camera::ChangeProperties_()
 {
-    bool set_exp = false;
-    bool set_auto_exp = false;
-
-    for (auto &prop : color_props_) {
-        if (prop.second.has_changed) {
-            if (prop.first == "Auto_Exposure")
-                set_auto_exp = true;
-            else if (prop.first == "Exposure")
-                set_exp = true;
-            SetProperty(dai::CameraBoardSocket::RGB, prop.first, true);
-            prop.second.has_changed = false;
+    // Merge everything changed since the last transaction into a single message per stream
+    auto now = std::chrono::steady_clock::now();
+    bool pending = false;
+    auto any_changed = [](const std::vector<Property> &props) {
+        for (const auto &prop : props) {
+            if (prop.has_changed)
+                return true;
         }
+        return false;
+    };
+
+    if (is_init_ && is_color_enabled_ && is_color_streaming_ && (any_changed(color_props_) || still_requested_)) {
+        if (now - control_time_ >= std::chrono::milliseconds(kControlIntervalMs))
+            SendColorControl_(false);
+        else
+            pending = true;
     }
-    if (set_auto_exp && set_exp) {
-        color_props_["Auto_Exposure"].value = (int)true;
-        SetProperty(dai::CameraBoardSocket::RGB, "Auto_Exposure", true);
+
+    if (is_init_ && is_depth_enabled_ && is_depth_streaming_ && any_changed(depth_props_)) {
+        if (now - depth_config_time_ >= std::chrono::milliseconds(kControlIntervalMs))
+            SendStereoConfig_();
+        else
+            pending = true;
     }
 
-    change_props_ = false;
+    change_props_ = pending;
 }
 
 void oak_camera::ResetProperties(dai::CameraBoardSocket stream_type)
 {
     if (stream_type == dai::CameraBoardSocket::RGB) {
         for (auto &prop: color_props_) {
-            prop.second.value = prop.second.range.def;
-            prop.second.has_changed = true;
+            prop.value = prop.range.def;
+            prop.has_changed = true;
+        }
+    }
+    else if (stream_type == dai::CameraBoardSocket::AUTO) {
+        for (int i = 0; i < depth_props_.size(); i++) {
+            if (i == DepthProp_Preset && depth_props_[i].value != depth_props_[i].range.def)
+                reconfigure_ = true;
+            depth_props_[i].value = depth_props_[i].range.def;
+            depth_props_[i].has_changed = (i != DepthProp_Preset);
         }
+        // Back to the plain preset, a rebuild for a changed preset seeds again
+        depth_overrides_ = 0;
+        if (is_depth_streaming_)
+            SeedDepthProps_(stereo_base_config_);
     }
     change_props_ = true;
 }
@@ -7,9 +7,25 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <thread>
 #include "opencv2/opencv.hpp"
 #include "depthai/depthai.hpp"
 #include <json.hpp>
+#include "frame_registration.hpp"
+#include "shm_frame_publisher.hpp"
+#include "depth_codec.hpp"
+#include "depth_scan.hpp"
+#include "range_mask.hpp"
+#include "exposure_controller.hpp"
+#include "bandwidth_planner.hpp"
+#include "fps_governor.hpp"
+#include "tsdf_volume.hpp"
+#include "soak_monitor.hpp"
+#include "frame_source.hpp"
+#include "memory_budget.hpp"
 
 struct OakRange
 {
@@ -19,8 +35,63 @@ struct OakRange
     float step;
 };
 
+enum ColorProperty
+{
+    ColorProp_Brightness = 0,
+    ColorProp_Contrast,
+    ColorProp_Saturation,
+    ColorProp_Sharpness,
+    ColorProp_Auto_Exposure,
+    ColorProp_Exposure,
+    ColorProp_ISO,
+    ColorProp_White_Balance_Mode,
+    ColorProp_White_Balance,
+    ColorProp_Focus_Mode,
+    ColorProp_Focus_Pos,
+    ColorProp_Count
+};
+
+enum DepthProperty
+{
+    DepthProp_Preset = 0,
+    DepthProp_Confidence,
+    DepthProp_Median,
+    DepthProp_LR_Check,
+    DepthProp_LR_Threshold,
+    DepthProp_Subpixel,
+    DepthProp_Subpixel_Bits,
+    DepthProp_Speckle,
+    DepthProp_Speckle_Range,
+    DepthProp_Temporal,
+    DepthProp_Temporal_Alpha,
+    DepthProp_Temporal_Delta,
+    DepthProp_Count
+};
+
+enum DepthAlignMode
+{
+    DepthAlign_Device = 0,
+    DepthAlign_Host
+};
+
+enum FeatureSource
+{
+    FeatureSource_Off = 0,
+    FeatureSource_Color,
+    FeatureSource_Left,
+    FeatureSource_Right
+};
+
+enum FeatureMotion
+{
+    FeatureMotion_Off = 0,
+    FeatureMotion_Optical_Flow,
+    FeatureMotion_Hardware
+};
+
 struct Property
 {
+    std::string name;
     int value;
     OakRange range;
     std::vector<std::string> opt_list;
@@ -43,42 +114,288 @@ struct StreamConfig
     int fps_idx;
 };
 
+// Copy of the camera state the GUI renders from, built on the processing thread and never modified once published
+struct CameraSnapshot
+{
+    uint64_t version;
+    uint64_t command_seq;          // Commands applied before the copy was taken
+    bool is_init;
+    int device_idx;
+    int shared_clients;            // Nodes attached to the device, filled in by the plugin
+    std::string color_override;    // Merged mode served instead of the node's own request, filled in by the plugin
+    std::string depth_override;
+    std::string device_name;
+    std::vector<std::string> device_list;
+    std::vector<std::string> device_serials;
+    bool is_reconnecting;
+    int reconnect_attempts;
+    bool has_color;
+    bool has_depth;
+    bool color_enabled;
+    bool depth_enabled;
+    std::vector<StreamConfig> color_configs;
+    std::vector<StreamConfig> depth_configs;
+    std::vector<Property> color_props;
+    std::vector<Property> depth_props;
+    bool shm_publish;
+    std::string shm_name;
+    std::vector<std::string> usb_speed_list;
+    int max_usb_speed;
+    bool auto_fit_bandwidth;
+    bool adaptive_fps;
+    int adaptive_fps_min;
+    int adaptive_fps_max;
+    int feature_source;
+    int feature_max;
+    int feature_corner;
+    int feature_motion;
+    nlohmann::json telemetry;
+    nlohmann::json bandwidth_plan;
+    bool undistort_color;
+    bool full_res_output;
+    bool preview_output;
+    int preview_size;
+    std::vector<std::string> preview_size_list;
+    bool still_capture;
+    bool still_jpeg;
+    int depth_align_mode;
+    bool depth_output;
+    bool compress_depth;
+    bool scan_enabled;
+    int scan_band_top;
+    int scan_band_bottom;
+    bool host_ae_enabled;
+    int host_ae_target;
+    int host_ae_flicker;
+    cv::Rect2f host_ae_region;
+    bool mask_enabled;
+    int mask_near;
+    int mask_far;
+    int mask_cleanup;
+    bool mask_color;
+    bool spatial_enabled;
+    int spatial_algorithm;
+    int spatial_lower;
+    int spatial_upper;
+    std::vector<cv::Rect2f> spatial_rois;
+    bool gate_enabled;
+    int gate_threshold;
+    int gate_keepalive_ms;
+    bool fusion_enabled;
+    bool fusion_incremental;
+    int fusion_voxel_mm;
+    int fusion_budget_mb;
+    TsdfStats fusion_stats;
+    int memory_budget_mb;
+    int memory_level;
+    MemoryUsage memory_usage;
+    bool soak_enabled;
+    SoakBudget soak_budget;
+    SoakStats soak_stats;
+    std::vector<float> soak_rss_history;
+    std::vector<float> soak_latency_history;
+};
+
 class oak_camera {
   public:
     oak_camera();
+    ~oak_camera();
     void RefreshDeviceList();
+    // Devices opened by other nodes of this process are booted and not enumerated, lists them as well
+    void AddOpenDevices(const std::vector<std::string> &mxids);
     int GetDeviceCount();
     std::string GetDeviceSerial(int index);
     std::string GetDeviceName(int index);
     const std::vector<std::string> &GetDeviceList();
     void InitCamera(int index, bool immediate = false);
+    // Serves frames from the source instead of a device, for device free soak runs
+    void SetFrameSource(std::shared_ptr<frame_source> source);
     bool IsInit();
     [[nodiscard]] bool IsReconfiguring() const;
+    [[nodiscard]] bool IsReconnecting() const;
+    [[nodiscard]] int GetReconnectAttempts() const;
     std::vector<StreamConfig> *GetStreamConfigList(dai::CameraBoardSocket stream_type);
     void SetAllRgbControls();
-    std::map<std::string, Property> *GetPropertyList(dai::CameraBoardSocket stream_type);
-    int GetProperty(dai::CameraBoardSocket stream_type, std::string& prop_name);
-    void SetProperty(dai::CameraBoardSocket stream_type, std::string prop_name, bool immediate_mode = false);
+    std::vector<Property> *GetPropertyList(dai::CameraBoardSocket stream_type);
+    int GetProperty(dai::CameraBoardSocket stream_type, int prop);
+    void SetProperty(dai::CameraBoardSocket stream_type, int prop);
+    void SetPropertyValue(dai::CameraBoardSocket stream_type, int prop, int value);
+    std::shared_ptr<CameraSnapshot> MakeSnapshot();
     void ResetProperties(dai::CameraBoardSocket stream_type);
     bool EnableStream(StreamConfig& config, bool immediate = false);
     void DisableStream(dai::CameraBoardSocket stream);
     void ProcessStreams();
     cv::Mat &GetFrame(dai::CameraBoardSocket stream);
+    cv::Mat &GetUndistortedFrame();
+    cv::Mat &GetRegisteredFrame();
+    void SetUndistortColor(bool enable);
+    [[nodiscard]] bool GetUndistortColor() const;
+    void SetDepthAlignMode(int mode);
+    [[nodiscard]] int GetDepthAlignMode() const;
+    cv::Mat &GetPreviewFrame();
+    cv::Mat &GetCompressedDepthFrame();
+    void SetCompressDepth(bool enable);
+    [[nodiscard]] bool GetCompressDepth() const;
+    nlohmann::json &GetScanData();
+    nlohmann::json &GetFeatureData();
+    nlohmann::json &GetSpatialData();
+    void SetDepthOutput(bool enable);
+    [[nodiscard]] bool GetDepthOutput() const;
+    void SetSpatialEnabled(bool enable);
+    [[nodiscard]] bool GetSpatialEnabled() const;
+    void SetSpatialRois(const std::vector<cv::Rect2f> &rois);
+    [[nodiscard]] const std::vector<cv::Rect2f> &GetSpatialRois() const;
+    void SetSpatialConfig(int algorithm, int lower_mm, int upper_mm);
+    [[nodiscard]] int GetSpatialAlgorithm() const;
+    [[nodiscard]] int GetSpatialLower() const;
+    [[nodiscard]] int GetSpatialUpper() const;
+    void SetFeatureSource(int source);
+    [[nodiscard]] int GetFeatureSource() const;
+    void SetFeatureConfig(int max_features, int corner_detector, int motion);
+    [[nodiscard]] int GetFeatureMaxFeatures() const;
+    [[nodiscard]] int GetFeatureCornerDetector() const;
+    [[nodiscard]] int GetFeatureMotion() const;
+    void SetScanEnabled(bool enable);
+    [[nodiscard]] bool GetScanEnabled() const;
+    void SetScanBand(int top_pct, int bottom_pct);
+    [[nodiscard]] int GetScanBandTop() const;
+    [[nodiscard]] int GetScanBandBottom() const;
+    void SetHostAutoExposure(bool enable);
+    [[nodiscard]] bool GetHostAutoExposure() const;
+    void SetHostAutoExposureConfig(int target, int flicker, const cv::Rect2f &region);
+    [[nodiscard]] int GetHostAutoExposureTarget() const;
+    [[nodiscard]] int GetHostAutoExposureFlicker() const;
+    [[nodiscard]] const cv::Rect2f &GetHostAutoExposureRegion() const;
+    void SetMaskEnabled(bool enable);
+    [[nodiscard]] bool GetMaskEnabled() const;
+    void SetMaskRange(int near_mm, int far_mm);
+    [[nodiscard]] int GetMaskNear() const;
+    [[nodiscard]] int GetMaskFar() const;
+    void SetMaskCleanup(int radius);
+    [[nodiscard]] int GetMaskCleanup() const;
+    void SetMaskColor(bool enable);
+    [[nodiscard]] bool GetMaskColor() const;
+    cv::Mat &GetMaskFrame();
+    cv::Mat &GetMaskedColorFrame();
+    void SetGateEnabled(bool enable);
+    [[nodiscard]] bool GetGateEnabled() const;
+    void SetGateConfig(int threshold, int keepalive_ms);
+    [[nodiscard]] int GetGateThreshold() const;
+    [[nodiscard]] int GetGateKeepAlive() const;
+    void SetFusionEnabled(bool enable);
+    [[nodiscard]] bool GetFusionEnabled() const;
+    void SetFusionConfig(int voxel_mm, int budget_mb, bool incremental);
+    [[nodiscard]] int GetFusionVoxelSize() const;
+    [[nodiscard]] int GetFusionBudget() const;
+    [[nodiscard]] bool GetFusionIncremental() const;
+    void SetFusionPose(const cv::Matx44f &pose);
+    void ResetFusion();
+    void ExtractFusionPoints();
+    cv::Mat &GetFusionPoints();
+    void SetColorOutputs(bool full_res, bool preview);
+    void SetStillCapture(bool enable, bool jpeg);
+    [[nodiscard]] bool GetStillCapture() const;
+    [[nodiscard]] bool GetStillJpeg() const;
+    void CaptureStill();
+    cv::Mat &GetStillFrame();
+    [[nodiscard]] bool GetFullResOutput() const;
+    [[nodiscard]] bool GetPreviewOutput() const;
+    const std::vector<std::string> &GetPreviewSizeList();
+    void SetPreviewSize(int index);
+    [[nodiscard]] int GetPreviewSize() const;
+    void SetSharedMemoryPublish(bool enable);
+    [[nodiscard]] bool GetSharedMemoryPublish() const;
+    [[nodiscard]] std::string GetSharedMemoryName() const;
     nlohmann::json &GetMetaData();
+    nlohmann::json &GetTelemetry();
+    const std::vector<std::string> &GetUsbSpeedList();
+    void SetMaxUsbSpeed(int index);
+    [[nodiscard]] int GetMaxUsbSpeed() const;
+    void SetAutoFitBandwidth(bool enable);
+    [[nodiscard]] bool GetAutoFitBandwidth() const;
+    nlohmann::json &GetBandwidthPlan();
+    void SetAdaptiveFps(bool enable);
+    [[nodiscard]] bool GetAdaptiveFps() const;
+    void SetAdaptiveFpsBounds(int min_fps, int max_fps);
+    [[nodiscard]] int GetAdaptiveFpsMin() const;
+    [[nodiscard]] int GetAdaptiveFpsMax() const;
+    void SetMemoryBudget(int budget_mb);
+    [[nodiscard]] int GetMemoryBudget() const;
+    void ResetMemoryLevel();
+    void SetSoakMonitor(bool enable);
+    [[nodiscard]] bool GetSoakMonitor() const;
+    void SetSoakBudget(const SoakBudget &budget);
+    [[nodiscard]] const SoakBudget &GetSoakBudget() const;
+    void ResetSoak();
+    void ReloadCalibration();
     bool HasColor() const;
     bool HasDepth() const;
 
   protected:
     void InitCamera_();
+    void InitDepthProps_();
+    void InitColorProps_();
+    void StartFrameSource_();
+    bool WaitFrames_(const std::vector<std::string> &names, int timeout_ms);
+    [[nodiscard]] double LinkTimeoutMs_() const;
+    std::vector<std::shared_ptr<dai::ImgFrame>> TryGetFrames_(const std::string &name);
+    void SetQueueDepth_(const std::string &name, int depth);
+    void ProcessStreams_();
+    void OnLinkLost_(const std::string &error);
+    void CheckReconnect_();
+    void StopReconnect_();
+    void ReconnectWorker_(const std::string &mxid, dai::UsbSpeed usb_speed);
     void ReconfigureDevice_();
     void ChangeProperties_();
+    void SendColorControl_(bool send_all);
+    void SendStereoConfig_();
+    void ApplyStereoProperties_(dai::RawStereoDepthConfig &cfg);
+    void SeedDepthProps_(const dai::RawStereoDepthConfig &cfg);
+    void LoadCalibration_(bool from_device);
     void UpdateCalibData_();
+    [[nodiscard]] cv::Size GetPreviewSize_(int index) const;
+    void UpdatePreviewSizes_();
+    void UpdateControlFeedback_(const dai::ImgFrame &frame, nlohmann::json &meta);
+    void PlanBandwidth_();
+    void ApplyFeatureConfig_(dai::FeatureTrackerConfig &cfg) const;
+    void ApplySpatialConfig_(dai::SpatialLocationCalculatorConfig &cfg) const;
+    void LinkFrameSkip_(dai::Node::Output &src, dai::Node::Input &dst, const std::string &cfg_stream);
+    void SendFrameSkip_();
+    nlohmann::json MakeSoakReport_();
+    nlohmann::json UpdateMemory_(const nlohmann::json &meta);
+    bool StepMemoryResolution_(bool apply);
+    void RestoreMemoryLevel_();
+    void UpdateHostExposure_(dai::ImgFrame &frame, nlohmann::json &meta);
+    void CreateGate_(bool gate_color, bool gate_depth);
+    void SendGateConfig_();
+    void UpdateTelemetry_(const dai::SystemInformation &info);
+    void PublishSharedMemory_(const std::shared_ptr<dai::ImgFrame> &color_pkt, const std::shared_ptr<dai::ImgFrame> &depth_pkt);
+    [[nodiscard]] bool IsDepthAlignedToColor_() const;
 
   private:
     std::mutex io_mutex_;
+
+    // Link supervision, the worker only touches the reconnect_ members
+    std::thread reconnect_thread_;
+    std::mutex reconnect_mutex_;
+    std::atomic<bool> reconnect_stop_;
+    std::atomic<bool> reconnect_ready_;
+    std::atomic<int> reconnect_attempts_;
+    std::shared_ptr<dai::Device> reconnect_device_;
+    dai::DeviceInfo reconnect_info_;
+    uint64_t snapshot_version_;
+    bool link_lost_;
+    bool link_changed_;
+    int reconnect_count_;
+    std::string link_error_;
+    std::chrono::steady_clock::time_point last_packet_time_;
+    std::chrono::steady_clock::time_point link_lost_time_;
+    double last_downtime_ms_;
+    double total_downtime_ms_;
     int active_dev_idx_;
     std::shared_ptr<dai::Pipeline> pipeline;
     std::shared_ptr<dai::Device> device;
+    std::shared_ptr<frame_source> frame_source_;
     std::vector<std::string> queueNames;
     std::shared_ptr<dai::node::ColorCamera> camRgb;
     std::shared_ptr<dai::node::XLinkIn> controlIn;
@@ -86,19 +403,137 @@ class oak_camera {
     std::shared_ptr<dai::node::MonoCamera> left;
     std::shared_ptr<dai::node::MonoCamera> right;
     std::shared_ptr<dai::node::StereoDepth> stereo;
+    std::shared_ptr<dai::node::XLinkIn> depthConfigIn;
+    std::shared_ptr<dai::DataInputQueue> depthConfigQueue;
+    dai::RawStereoDepthConfig stereo_base_config_;
+    // Depth properties set by the user, one bit per DepthProp, the others follow the preset
+    uint32_t depth_overrides_;
     std::shared_ptr<dai::node::XLinkOut> rgbOut;
+    std::shared_ptr<dai::node::XLinkOut> previewOut;
     std::shared_ptr<dai::node::XLinkOut> depthOut;
+    std::shared_ptr<dai::node::ImageManip> colorScale;
+    std::shared_ptr<dai::node::VideoEncoder> stillEncoder;
+    std::shared_ptr<dai::node::XLinkOut> stillOut;
+    std::shared_ptr<dai::node::SpatialLocationCalculator> spatialCalc;
+    std::shared_ptr<dai::node::XLinkIn> spatialConfigIn;
+    std::shared_ptr<dai::node::XLinkOut> spatialOut;
+    std::shared_ptr<dai::DataInputQueue> spatialConfigQueue;
+    std::shared_ptr<dai::node::FeatureTracker> featureTracker;
+    std::shared_ptr<dai::node::XLinkIn> featureConfigIn;
+    std::shared_ptr<dai::node::XLinkOut> featureOut;
+    std::shared_ptr<dai::DataInputQueue> featureConfigQueue;
+    std::shared_ptr<dai::DataInputQueue> colorSkipQueue;
+    std::shared_ptr<dai::DataInputQueue> depthSkipQueue;
+    std::shared_ptr<dai::node::Script> gateScript;
+    std::shared_ptr<dai::node::ImageManip> gateScale;
+    std::shared_ptr<dai::DataInputQueue> gateConfigQueue;
+    std::shared_ptr<dai::node::SystemLogger> sysLog;
+    std::shared_ptr<dai::node::XLinkOut> sysLogOut;
+    dai::CalibrationHandler calib_;
     std::vector<std::vector<float>> rgb_intrinsics_;
     std::vector<std::vector<float>> depth_intrinsics_;
+    std::vector<float> rgb_distortion_;
+    std::vector<std::vector<float>> depth_to_rgb_extrinsics_;
+    std::vector<std::vector<float>> right_rectification_;
+    float stereo_baseline_;
     StreamConfig active_color_cfg_;
     StreamConfig active_depth_cfg_;
+    StreamConfig requested_color_cfg_;
+    StreamConfig requested_depth_cfg_;
     cv::Mat color_frame_;
     cv::Mat depth_frame_;
+    cv::Mat preview_frame_;
+    cv::Mat color_undistorted_frame_;
+    cv::Mat depth_registered_frame_;
+    cv::Mat depth_compressed_frame_;
+    cv::Mat depth_codec_scratch_;
+    frame_registration registration_;
+    depth_scan scan_;
+    std::vector<float> scan_ranges_;
+    nlohmann::json scan_data_;
+    bool scan_enabled_;
+    exposure_controller host_ae_;
+    bool host_ae_enabled_;
+    range_mask mask_;
+    bool mask_enabled_;
+    bool mask_color_;
+    cv::Mat mask_frame_;
+    cv::Mat masked_color_frame_;
+    tsdf_volume fusion_;
+    cv::Matx44f fusion_pose_;
+    cv::Mat fusion_points_;
+    std::vector<cv::Point3f> fusion_scratch_;
+    bool fusion_enabled_;
+    bool fusion_incremental_;
+    int fusion_voxel_mm_;
+    int fusion_budget_mb_;
+    size_t fusion_shrunk_bytes_;   // Budget the memory level shrank the volume to, max while not shrunk
+    bool depth_output_enabled_;
+    nlohmann::json spatial_data_;
+    std::vector<cv::Rect2f> spatial_rois_;
+    int spatial_algorithm_;
+    int spatial_lower_;
+    int spatial_upper_;
+    bool spatial_enabled_;
+    bool spatial_config_changed_;
+    bool is_spatial_streaming_;
+    bool gate_enabled_;
+    int gate_threshold_;
+    int gate_keepalive_ms_;
+    bool gate_config_changed_;
+    bool is_gate_streaming_;
+    uint64_t gate_forwarded_;
+    uint64_t gate_keepalives_;
+    std::chrono::steady_clock::time_point gate_last_frame_time_;
+    nlohmann::json feature_data_;
+    int feature_source_;
+    int feature_max_;
+    int feature_corner_;
+    int feature_motion_;
+    bool feature_config_changed_;
+    bool is_feature_streaming_;
+    cv::Size feature_size_;
+    int depth_align_mode_;
+    bool undistort_color_;
+    bool compress_depth_;
+    bool full_res_enabled_;
+    bool preview_enabled_;
+    cv::Size color_size_;
+    cv::Mat still_frame_;
+    bool still_enabled_;
+    bool still_jpeg_;
+    bool still_requested_;
+    bool is_still_streaming_;
+    std::chrono::steady_clock::time_point still_request_time_;
+    int preview_size_idx_;
+    std::vector<std::string> preview_size_names_;
+    shm_frame_publisher shm_publisher_;
+    bool shm_publish_;
+    // Sequence number and timestamp of the last color / depth packet, repeated with the frame until a new one arrives
+    int64_t shm_frame_num_[ShmStream_Meta];
+    int64_t shm_timestamp_[ShmStream_Meta];
     std::string oak_dev_serial_;
     std::string oak_dev_name_;
     std::vector<std::string> camera_name_list_;
     std::vector<dai::DeviceInfo> infos_;
     nlohmann::json meta_data_;
+    nlohmann::json telemetry_;
+    dai::UsbSpeed max_usb_speed_;
+    dai::UsbSpeed device_usb_speed_;
+    dai::UsbSpeed link_speed_;
+    std::vector<std::string> usb_speed_names_;
+    bool auto_fit_bandwidth_;
+    bool bandwidth_changed_;
+    nlohmann::json bandwidth_plan_;
+    fps_governor governor_;
+    bool adaptive_fps_;
+    memory_budget memory_;
+    std::unordered_map<std::string, size_t> queue_frame_bytes_;
+    soak_monitor soak_;
+    bool soak_enabled_;
+    uint32_t soak_reported_;
+    int color_skip_;
+    int depth_skip_;
     int init_idx_;
     bool init_;
     bool has_rgb_;
@@ -110,10 +545,24 @@ class oak_camera {
     bool is_init_;
     bool reconfigure_;
     bool change_props_;
+    bool has_calib_;
+    bool calib_changed_;
+    int calib_id_;
+    bool control_pending_;
+    int control_id_;
+    int64_t control_sent_frame_num_;
+    int64_t control_frame_num_;
+    int control_wait_frames_;
+    int control_exposure_us_;
+    int control_iso_;
+    int control_lens_pos_;
+    int control_color_temp_;
+    std::chrono::steady_clock::time_point control_time_;
+    std::chrono::steady_clock::time_point depth_config_time_;
     std::vector<StreamConfig> color_configs_;
-    std::map<std::string, Property> color_props_;
+    std::vector<Property> color_props_;
     std::vector<StreamConfig> depth_configs_;
-    std::map<std::string, Property> depth_props_;
+    std::vector<Property> depth_props_;
 
 };
 
@@ -11,6 +11,244 @@ using namespace DSPatchables;
 
 int32_t global_inst_counter = 0;
 
+// Idle refresh of the published camera state, telemetry and bandwidth change at most this often anyway
+static constexpr int kSnapshotIntervalMs = 200;
+
+// Config lists follow the modes the connected sensors report, choices are resolved by resolution and fps value
+static const char *kDefaultColorRes = "1280 x 720";
+static const char *kDefaultDepthRes = "640 x 480";
+// Graphs saved before that only carry an index into these fixed lists
+static const char *kLegacyColorRes[] = {"3840 x 2160", "1920 x 1080", "1280 x 720", "960 x 540", "640 x 360"};
+static const char *kLegacyDepthRes[] = {"1280 x 800", "1280 x 720", "640 x 480", "640 x 400"};
+
+template<size_t N>
+static std::string GetSavedResolution(const nlohmann::json &state, const char *res_key, const char *idx_key,
+                                      const char *(&legacy)[N], const char *fallback)
+{
+    if (state.contains(res_key))
+        return state[res_key].get<std::string>();
+    if (state.contains(idx_key)) {
+        int idx = state[idx_key].get<int>();
+        if (idx >= 0 && idx < (int)N)
+            return legacy[idx];
+    }
+
+    return fallback;
+}
+
+static void SelectStreamConfig(const std::vector<StreamConfig> &configs, const std::string &resolution, int fps, int &cfg_idx, int &fps_idx)
+{
+    for (int i = 0; i < configs.size(); i++) {
+        if (configs[i].str_resolution == resolution) {
+            cfg_idx = i;
+            break;
+        }
+    }
+    if (cfg_idx < 0 || cfg_idx >= configs.size())
+        cfg_idx = 0;
+
+    // Highest rate the mode supports that does not exceed the requested one
+    const auto &fps_list = configs[cfg_idx].fps_list;
+    fps_idx = (int)fps_list.size() - 1;
+    for (int i = 0; i < fps_list.size(); i++) {
+        if (fps_list[i] <= fps) {
+            fps_idx = i;
+            break;
+        }
+    }
+}
+
+// ROIs arrive as [{"x", "y", "w", "h"}, ...] or [[x, y, w, h], ...], optionally wrapped in {"rois": ...}, normalized to the depth frame
+static bool ParseSpatialRois(const nlohmann::json &json_in, std::vector<cv::Rect2f> &rois)
+{
+    const nlohmann::json &list = (json_in.is_object() && json_in.contains("rois")) ? json_in["rois"] : json_in;
+    if (!list.is_array())
+        return false;
+
+    rois.clear();
+    for (const auto &item : list) {
+        if (item.is_object() && item.contains("x") && item.contains("y") && item.contains("w") && item.contains("h"))
+            rois.emplace_back(item["x"].get<float>(), item["y"].get<float>(), item["w"].get<float>(), item["h"].get<float>());
+        else if (item.is_array() && item.size() == 4)
+            rois.emplace_back(item[0].get<float>(), item[1].get<float>(), item[2].get<float>(), item[3].get<float>());
+    }
+
+    return !rois.empty();
+}
+
+// Pose is camera to world, row major 4 x 4 as 16 numbers or 4 rows, optionally wrapped in {"pose": ...}, translation in meters
+static bool ParsePose(const nlohmann::json &json_in, cv::Matx44f &pose)
+{
+    const nlohmann::json &mat = (json_in.is_object() && json_in.contains("pose")) ? json_in["pose"] : json_in;
+    if (!mat.is_array())
+        return false;
+
+    std::vector<float> values;
+    for (const auto &item : mat) {
+        if (item.is_array()) {
+            for (const auto &v : item)
+                values.push_back(v.get<float>());
+        }
+        else if (item.is_number()) {
+            values.push_back(item.get<float>());
+        }
+    }
+    if (values.size() != 16)
+        return false;
+
+    for (int i = 0; i < 16; i++)
+        pose(i / 4, i % 4) = values[i];
+
+    return true;
+}
+
+// Coalescing key of a camera property edit
+static std::string PropertyKey(dai::CameraBoardSocket stream_type, int prop_idx)
+{
+    return "SetPropertyValue " + std::to_string((int)stream_type) + " " + std::to_string(prop_idx);
+}
+
+// Applies a saved state to the camera, runs on the processing thread
+void OakCamera::RestoreState_(const nlohmann::json &state)
+{
+    int cam_idx = state.contains("cam_idx") ? state["cam_idx"].get<int>() : 0;
+    std::string saved_serial;
+    if (state.contains("oak_serial"))
+        saved_serial = state["oak_serial"].get<std::string>();
+    if (cam_idx <= 0 || saved_serial.empty()) {
+        Attach_("");
+        return;
+    }
+
+    // Devices are matched by serial, another node may already hold this one
+    Attach_(saved_serial);
+    std::unique_lock<std::mutex> lk(device_->Mutex());
+    auto &cam = device_->Camera();
+    if (state.contains("usb_max_speed"))
+        cam.SetMaxUsbSpeed(state["usb_max_speed"].get<int>());
+    if (state.contains("auto_fit_bandwidth"))
+        cam.SetAutoFitBandwidth(state["auto_fit_bandwidth"].get<bool>());
+    if (state.contains("adaptive_fps"))
+        cam.SetAdaptiveFps(state["adaptive_fps"].get<bool>());
+    if (state.contains("feature_source"))
+        cam.SetFeatureSource(state["feature_source"].get<int>());
+    if (state.contains("feature_max") && state.contains("feature_corner") && state.contains("feature_motion")) {
+        cam.SetFeatureConfig(state["feature_max"].get<int>(), state["feature_corner"].get<int>(),
+                             state["feature_motion"].get<int>());
+    }
+    if (state.contains("adaptive_fps_min") && state.contains("adaptive_fps_max"))
+        cam.SetAdaptiveFpsBounds(state["adaptive_fps_min"].get<int>(), state["adaptive_fps_max"].get<int>());
+    if (state.contains("soak_rss_growth_mb") && state.contains("soak_latency_p99_ms") && state.contains("soak_reconfigure_ms")) {
+        cam.SetSoakBudget({state["soak_rss_growth_mb"].get<double>(), state["soak_latency_p99_ms"].get<double>(),
+                           state["soak_reconfigure_ms"].get<double>()});
+    }
+    if (state.contains("soak"))
+        cam.SetSoakMonitor(state["soak"].get<bool>());
+    if (state.contains("memory_budget_mb"))
+        cam.SetMemoryBudget(state["memory_budget_mb"].get<int>());
+    if (state.contains("gate_threshold") && state.contains("gate_keepalive_ms"))
+        cam.SetGateConfig(state["gate_threshold"].get<int>(), state["gate_keepalive_ms"].get<int>());
+    if (state.contains("gate"))
+        cam.SetGateEnabled(state["gate"].get<bool>());
+    if (!device_->Open()) {
+        lk.unlock();
+        Attach_("");
+        return;
+    }
+    if (state.contains("shm_publish"))
+        cam.SetSharedMemoryPublish(state["shm_publish"].get<bool>());
+    bool enable_color = state.contains("color_enabled") && state["color_enabled"].get<bool>();
+    if (enable_color && cam.HasColor()) {
+        auto color_cfg_list = cam.GetStreamConfigList(dai::CameraBoardSocket::RGB);
+        auto color_props = cam.GetPropertyList(dai::CameraBoardSocket::RGB);
+        int cfg_idx = -1;
+        int fps_idx = 0;
+        int fps = state.contains("color_fps") ? state["color_fps"].get<int>() : 30;
+        SelectStreamConfig(*color_cfg_list, GetSavedResolution(state, "color_res", "color_res_idx", kLegacyColorRes, kDefaultColorRes),
+                           fps, cfg_idx, fps_idx);
+        color_cfg_list->at(cfg_idx).fps_idx = fps_idx;
+        if (state.contains("color_undistort"))
+            cam.SetUndistortColor(state["color_undistort"].get<bool>());
+        if (state.contains("color_full_res") && state.contains("color_preview"))
+            cam.SetColorOutputs(state["color_full_res"].get<bool>(), state["color_preview"].get<bool>());
+        if (state.contains("color_preview_size"))
+            cam.SetPreviewSize(state["color_preview_size"].get<int>());
+        if (state.contains("color_still") && state.contains("color_still_jpeg"))
+            cam.SetStillCapture(state["color_still"].get<bool>(), state["color_still_jpeg"].get<bool>());
+        device_->SetStreamRequest(client_id_, color_cfg_list->at(cfg_idx));
+        if (state.contains("color_controls")) {
+            for (int i = 0; i < color_props->size(); i++) {
+                const auto &name = color_props->at(i).name;
+                if (state["color_controls"].contains(name))
+                    cam.SetPropertyValue(dai::CameraBoardSocket::RGB, i, state["color_controls"][name].get<int>());
+            }
+        }
+        if (state.contains("color_host_ae_target") && state.contains("color_host_ae_flicker") && state.contains("color_host_ae_region")) {
+            const auto &region = state["color_host_ae_region"];
+            if (region.is_array() && region.size() == 4) {
+                cam.SetHostAutoExposureConfig(state["color_host_ae_target"].get<int>(), state["color_host_ae_flicker"].get<int>(),
+                                              cv::Rect2f(region[0].get<float>(), region[1].get<float>(), region[2].get<float>(), region[3].get<float>()));
+            }
+        }
+        if (state.contains("color_host_ae"))
+            cam.SetHostAutoExposure(state["color_host_ae"].get<bool>());
+    }
+    bool enable_depth = state.contains("depth_enabled") && state["depth_enabled"].get<bool>();
+    if (enable_depth && cam.HasDepth()) {
+        auto depth_cfg_list = cam.GetStreamConfigList(dai::CameraBoardSocket::AUTO);
+        auto depth_props = cam.GetPropertyList(dai::CameraBoardSocket::AUTO);
+        int cfg_idx = -1;
+        int fps_idx = 0;
+        int fps = state.contains("depth_fps") ? state["depth_fps"].get<int>() : 30;
+        SelectStreamConfig(*depth_cfg_list, GetSavedResolution(state, "depth_res", "depth_res_idx", kLegacyDepthRes, kDefaultDepthRes),
+                           fps, cfg_idx, fps_idx);
+        depth_cfg_list->at(cfg_idx).fps_idx = fps_idx;
+        if (state.contains("depth_align"))
+            cam.SetDepthAlignMode(state["depth_align"].get<int>());
+        if (state.contains("depth_output"))
+            cam.SetDepthOutput(state["depth_output"].get<bool>());
+        if (state.contains("depth_spatial"))
+            cam.SetSpatialEnabled(state["depth_spatial"].get<bool>());
+        if (state.contains("depth_spatial_algorithm") && state.contains("depth_spatial_lower") && state.contains("depth_spatial_upper")) {
+            cam.SetSpatialConfig(state["depth_spatial_algorithm"].get<int>(), state["depth_spatial_lower"].get<int>(),
+                                 state["depth_spatial_upper"].get<int>());
+        }
+        if (state.contains("depth_spatial_rois")) {
+            std::vector<cv::Rect2f> rois;
+            if (ParseSpatialRois(state["depth_spatial_rois"], rois))
+                cam.SetSpatialRois(rois);
+        }
+        if (state.contains("depth_compress"))
+            cam.SetCompressDepth(state["depth_compress"].get<bool>());
+        if (state.contains("depth_scan"))
+            cam.SetScanEnabled(state["depth_scan"].get<bool>());
+        if (state.contains("depth_scan_top") && state.contains("depth_scan_bottom"))
+            cam.SetScanBand(state["depth_scan_top"].get<int>(), state["depth_scan_bottom"].get<int>());
+        if (state.contains("depth_mask_near") && state.contains("depth_mask_far"))
+            cam.SetMaskRange(state["depth_mask_near"].get<int>(), state["depth_mask_far"].get<int>());
+        if (state.contains("depth_mask_cleanup"))
+            cam.SetMaskCleanup(state["depth_mask_cleanup"].get<int>());
+        if (state.contains("depth_mask_color"))
+            cam.SetMaskColor(state["depth_mask_color"].get<bool>());
+        if (state.contains("depth_mask"))
+            cam.SetMaskEnabled(state["depth_mask"].get<bool>());
+        if (state.contains("fusion_voxel_mm") && state.contains("fusion_budget_mb") && state.contains("fusion_incremental")) {
+            cam.SetFusionConfig(state["fusion_voxel_mm"].get<int>(), state["fusion_budget_mb"].get<int>(),
+                                state["fusion_incremental"].get<bool>());
+        }
+        if (state.contains("fusion"))
+            cam.SetFusionEnabled(state["fusion"].get<bool>());
+        if (state.contains("depth_controls")) {
+            for (int i = 0; i < depth_props->size(); i++) {
+                const auto &name = depth_props->at(i).name;
+                if (state["depth_controls"].contains(name))
+                    cam.SetPropertyValue(dai::CameraBoardSocket::AUTO, i, state["depth_controls"][name].get<int>());
+            }
+        }
+        device_->SetStreamRequest(client_id_, depth_cfg_list->at(cfg_idx));
+    }
+}
+
 namespace DSPatch::DSPatchables::internal
 {
 class OakCamera
@@ -30,46 +268,213 @@ OakCamera::OakCamera()
     SetInstanceCount(global_inst_counter);
     global_inst_counter++;
 
-    // 0 inputs
-    SetInputCount_( 0 );
+    // 4 inputs
+    SetInputCount_( 4, {"capture", "rois", "pose", "extract"},
+                    {IoType::Io_Type_Bool, IoType::Io_Type_JSON, IoType::Io_Type_JSON, IoType::Io_Type_Bool} );
 
-    // 3 outputs
-    SetOutputCount_( 3, {"rgb", "depth", "metadata"}, {IoType::Io_Type_CvMat, IoType::Io_Type_CvMat, IoType::Io_Type_JSON} );
+    // 14 outputs
+    SetOutputCount_( 14, {"rgb", "depth", "metadata", "rgb_undistorted", "depth_registered", "rgb_preview", "depth_rvl", "scan", "features", "still", "spatial", "points",
+                          "mask", "rgb_masked"},
+                     {IoType::Io_Type_CvMat, IoType::Io_Type_CvMat, IoType::Io_Type_JSON, IoType::Io_Type_CvMat, IoType::Io_Type_CvMat,
+                      IoType::Io_Type_CvMat, IoType::Io_Type_CvMat, IoType::Io_Type_JSON, IoType::Io_Type_JSON, IoType::Io_Type_CvMat,
+                      IoType::Io_Type_JSON, IoType::Io_Type_CvMat, IoType::Io_Type_CvMat, IoType::Io_Type_CvMat} );
 
     // Skip initial instance which is for plugin adding/checking
-    if (global_inst_counter >= 2) {
-        camera_ = std::make_unique<oak_camera>();
+    has_device_ = global_inst_counter >= 2;
+    if (has_device_) {
+        device_ = std::make_shared<shared_device>("");
+        client_id_ = device_registry::Instance().NewClientId();
     }
 
     // Defaults
     selected_camera_idx_ = 0;
-    color_cfg_idx_ = 2;
-    color_fps_idx_ = 1;
-    depth_cfg_idx_ = 2;
-    depth_fps_idx_ = 2;
+    color_cfg_idx_ = -1;
+    color_fps_idx_ = 0;
+    depth_cfg_idx_ = -1;
+    depth_fps_idx_ = 0;
     color_fps_ = 30;
     depth_fps_ = 30;
+    color_res_ = kDefaultColorRes;
+    depth_res_ = kDefaultDepthRes;
     enable_color_ = false;
     enable_depth_ = false;
+    last_capture_in_ = false;
+    last_extract_in_ = false;
+    extract_requested_ = false;
+    posted_seq_ = 0;
+    applied_seq_ = 0;
+    frame_seq_ = 0;
+    has_pending_attach_ = false;
+    has_pending_restore_ = false;
+    gui_ = CameraSnapshot();
+
+    // Nothing processes yet, publish the initial state so the GUI can list devices
+    if (has_device_) {
+        std::lock_guard<std::mutex> lk(device_->Mutex());
+        device_->Camera().AddOpenDevices(device_registry::Instance().GetOpenMxIds());
+        PublishSnapshot_(true);
+    }
 
     // Enable
     SetEnabled(true);
 }
 
+OakCamera::~OakCamera()
+{
+    if (device_ != nullptr) {
+        std::lock_guard<std::mutex> lk(device_->Mutex());
+        device_->RemoveClient(client_id_);
+    }
+}
+
+void OakCamera::Attach_(const std::string &mxid)
+{
+    if (mxid == device_->GetMxId())
+        return;
+
+    // Leave the current device first, the last node to leave closes it
+    {
+        std::lock_guard<std::mutex> lk(device_->Mutex());
+        device_->RemoveClient(client_id_);
+    }
+    if (mxid.empty())
+        device_ = std::make_shared<shared_device>("");
+    else
+        device_ = device_registry::Instance().Acquire(mxid);
+    std::lock_guard<std::mutex> lk(device_->Mutex());
+    device_->AddClient(client_id_);
+    frame_seq_ = 0;
+}
+
+void OakCamera::Post_(CameraCommand &&cmd, const std::string &key)
+{
+    // GUI / SetState thread only, the single producer of the command queue
+    if (!has_device_)
+        return;
+    // A newer value of the same setting replaces one still waiting, moved to the back to keep the order of edits
+    if (!key.empty()) {
+        auto it = std::find_if(backlog_.begin(), backlog_.end(), [&key](const auto &pending) { return pending.first == key; });
+        if (it != backlog_.end())
+            backlog_.erase(it);
+    }
+    backlog_.emplace_back(key, std::move(cmd));
+    FlushCommands_();
+}
+
+void OakCamera::FlushCommands_()
+{
+    // Commands wait on the GUI side while the ring is full, nothing is dropped
+    while (!backlog_.empty() && commands_.Push(std::move(backlog_.front().second))) {
+        backlog_.pop_front();
+        posted_seq_++;
+    }
+}
+
+void OakCamera::PublishSnapshot_(bool force)
+{
+    auto now = std::chrono::steady_clock::now();
+    if (!force && now - snapshot_time_ < std::chrono::milliseconds(kSnapshotIntervalMs))
+        return;
+
+    auto snap = device_->Camera().MakeSnapshot();
+    snap->command_seq = applied_seq_;
+    snap->shared_clients = (int)device_->GetClientCount();
+    snap->color_override = device_->GetOverriddenMode(client_id_, dai::CameraBoardSocket::RGB);
+    snap->depth_override = device_->GetOverriddenMode(client_id_, dai::CameraBoardSocket::AUTO);
+    std::atomic_store(&snapshot_, std::shared_ptr<const CameraSnapshot>(std::move(snap)));
+    snapshot_time_ = now;
+}
+
 void OakCamera::Process_( SignalBus const& inputs, SignalBus& outputs )
 {
-    std::lock_guard<std::mutex> lck(io_mutex_);
-    camera_->ProcessStreams();
-    if (!camera_->IsReconfiguring()) {
-        if (!camera_->GetFrame(dai::CameraBoardSocket::RGB).empty()) {
-            outputs.SetValue(0, camera_->GetFrame(dai::CameraBoardSocket::RGB));
-        }
-        if (!camera_->GetFrame(dai::CameraBoardSocket::AUTO).empty()) {
-            outputs.SetValue(1, camera_->GetFrame(dai::CameraBoardSocket::AUTO));
+    if (device_ == nullptr)
+        return;
+
+    // Work posted by the GUI runs here, the camera is only ever touched from processing threads holding its lock
+    CameraCommand cmd;
+    bool applied = false;
+    {
+        std::lock_guard<std::mutex> lk(device_->Mutex());
+        while (commands_.Pop(cmd)) {
+            cmd(device_->Camera());
+            applied_seq_++;
+            applied = true;
         }
-        if (!camera_->GetMetaData().empty())
-            outputs.SetValue(2, camera_->GetMetaData());
     }
+    // Switching devices takes the registry and two device locks in turn, so it runs outside the drain
+    if (has_pending_attach_) {
+        Attach_(pending_attach_);
+        std::lock_guard<std::mutex> lk(device_->Mutex());
+        device_->Open();
+        has_pending_attach_ = false;
+    }
+    if (has_pending_restore_) {
+        RestoreState_(pending_restore_);
+        has_pending_restore_ = false;
+    }
+
+    std::lock_guard<std::mutex> lk(device_->Mutex());
+    auto &cam = device_->Camera();
+    // Capture on the rising edge so a held trigger takes a single still
+    auto capture_in = inputs.GetValue<bool>(0);
+    bool capture = capture_in != nullptr && *capture_in;
+    if (capture && !last_capture_in_)
+        cam.CaptureStill();
+    last_capture_in_ = capture;
+    auto rois_in = inputs.GetValue<nlohmann::json>(1);
+    if (rois_in != nullptr) {
+        std::vector<cv::Rect2f> rois;
+        if (ParseSpatialRois(*rois_in, rois))
+            cam.SetSpatialRois(rois);
+    }
+    auto pose_in = inputs.GetValue<nlohmann::json>(2);
+    if (pose_in != nullptr) {
+        cv::Matx44f pose;
+        if (ParsePose(*pose_in, pose))
+            cam.SetFusionPose(pose);
+    }
+    auto extract_in = inputs.GetValue<bool>(3);
+    bool extract = extract_in != nullptr && *extract_in;
+    if (extract && !last_extract_in_)
+        extract_requested_ = true;
+    last_extract_in_ = extract;
+    if (extract_requested_) {
+        device_->RequestPoints();
+        extract_requested_ = false;
+    }
+
+    // Only the first node to come back for a new tick processes it, the others get the same buffers
+    const SharedFrames &frames = device_->Pump(frame_seq_);
+    frame_seq_ = frames.seq;
+    if (!frames.rgb.empty())
+        outputs.SetValue(0, frames.rgb);
+    if (!frames.depth.empty())
+        outputs.SetValue(1, frames.depth);
+    if (!frames.metadata.empty())
+        outputs.SetValue(2, frames.metadata);
+    if (!frames.rgb_undistorted.empty())
+        outputs.SetValue(3, frames.rgb_undistorted);
+    if (!frames.depth_registered.empty())
+        outputs.SetValue(4, frames.depth_registered);
+    if (!frames.rgb_preview.empty())
+        outputs.SetValue(5, frames.rgb_preview);
+    if (!frames.depth_rvl.empty())
+        outputs.SetValue(6, frames.depth_rvl);
+    if (!frames.scan.empty())
+        outputs.SetValue(7, frames.scan);
+    if (!frames.features.empty())
+        outputs.SetValue(8, frames.features);
+    if (!frames.still.empty())
+        outputs.SetValue(9, frames.still);
+    if (!frames.spatial.empty())
+        outputs.SetValue(10, frames.spatial);
+    if (!frames.points.empty())
+        outputs.SetValue(11, frames.points);
+    if (!frames.mask.empty())
+        outputs.SetValue(12, frames.mask);
+    if (!frames.rgb_masked.empty())
+        outputs.SetValue(13, frames.rgb_masked);
+    PublishSnapshot_(applied);
 }
 
 bool OakCamera::HasGui(int interface)
@@ -87,12 +492,23 @@ void OakCamera::UpdateGui(void *context, int interface)
     auto *imCurContext = (ImGuiContext *)context;
     ImGui::SetCurrentContext(imCurContext);
 
+    // Adopt the published state once everything posted has been applied, until then keep rendering the local edits
+    FlushCommands_();
+    auto snap = std::atomic_load(&snapshot_);
+    if (snap != nullptr && snap->version != gui_.version && snap->command_seq == posted_seq_ && backlog_.empty()) {
+        gui_ = *snap;
+        selected_camera_idx_ = gui_.device_idx;
+    }
+
     if (interface == (int)FlowCV::GuiInterfaceType_Controls) {
         if (ImGui::Button(CreateControlString("Refresh Oak-D List", GetInstanceName()).c_str())) {
-            camera_->RefreshDeviceList();
+            Post_([](oak_camera &cam) {
+                cam.RefreshDeviceList();
+                cam.AddOpenDevices(device_registry::Instance().GetOpenMxIds());
+            });
         }
         ImGui::Separator();
-        auto cam_list = camera_->GetDeviceList();
+        auto &cam_list = gui_.device_list;
         ImGui::SetNextItemWidth(150);
         if (ImGui::Combo(CreateControlString("Oak Cameras", GetInstanceName()).c_str(), &selected_camera_idx_, [](void* data, int idx, const char** out_text) {
             *out_text = ((const std::vector<std::string>*)data)->at(idx).c_str();
@@ -100,26 +516,207 @@ void OakCamera::UpdateGui(void *context, int interface)
         }, (void*)&cam_list, (int)cam_list.size())) {
             enable_color_ = false;
             enable_depth_ = false;
-            camera_->InitCamera(selected_camera_idx_);
+            color_cfg_idx_ = -1;
+            depth_cfg_idx_ = -1;
+            saved_state_.clear();
+            int cam_idx = selected_camera_idx_;
+            Post_([this, cam_idx](oak_camera &cam) {
+                pending_attach_ = (cam_idx > 0) ? cam.GetDeviceSerial(cam_idx) : "";
+                has_pending_attach_ = true;
+            });
         }
         ImGui::Separator();
-        if (selected_camera_idx_ > 0 && camera_->IsInit()) {
+        if (selected_camera_idx_ > 0 && gui_.is_init) {
             //
             // Common Section
             //
-            ImGui::Text("Camera: %s", camera_->GetDeviceName(selected_camera_idx_).c_str());
+            ImGui::Text("Camera: %s", gui_.device_name.c_str());
+            if (gui_.shared_clients > 1)
+                ImGui::Text("Shared by %d nodes, device settings apply to all of them", gui_.shared_clients);
+            if (gui_.is_reconnecting)
+                ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "Link lost, reconnecting (%d attempts)", gui_.reconnect_attempts);
+            if (ImGui::Button(CreateControlString("Reload Calibration", GetInstanceName()).c_str())) {
+                Post_([](oak_camera &cam) { cam.ReloadCalibration(); });
+            }
+            if (ImGui::Checkbox(CreateControlString("Shared Memory Publish", GetInstanceName()).c_str(), &gui_.shm_publish)) {
+                bool shm_publish = gui_.shm_publish;
+                Post_([shm_publish](oak_camera &cam) { cam.SetSharedMemoryPublish(shm_publish); }, "SetSharedMemoryPublish");
+            }
+            if (gui_.shm_publish)
+                ImGui::Text("Segment: %s", gui_.shm_name.c_str());
+            auto &usb_speed_list = gui_.usb_speed_list;
+            ImGui::SetNextItemWidth(100);
+            if (ImGui::Combo(CreateControlString("Max USB Speed", GetInstanceName()).c_str(), &gui_.max_usb_speed, [](void* data, int idx, const char** out_text) {
+                *out_text = ((const std::vector<std::string>*)data)->at(idx).c_str();
+                return true;
+            }, (void*)&usb_speed_list, (int)usb_speed_list.size())) {
+                int usb_speed = gui_.max_usb_speed;
+                Post_([usb_speed](oak_camera &cam) { cam.SetMaxUsbSpeed(usb_speed); }, "SetMaxUsbSpeed");
+            }
+            if (ImGui::Checkbox(CreateControlString("Auto Fit Bandwidth", GetInstanceName()).c_str(), &gui_.auto_fit_bandwidth)) {
+                bool auto_fit = gui_.auto_fit_bandwidth;
+                Post_([auto_fit](oak_camera &cam) { cam.SetAutoFitBandwidth(auto_fit); }, "SetAutoFitBandwidth");
+            }
+            if (ImGui::Checkbox(CreateControlString("Adaptive Frame Rate", GetInstanceName()).c_str(), &gui_.adaptive_fps)) {
+                bool adaptive_fps = gui_.adaptive_fps;
+                Post_([adaptive_fps](oak_camera &cam) { cam.SetAdaptiveFps(adaptive_fps); }, "SetAdaptiveFps");
+            }
+            if (gui_.adaptive_fps) {
+                int fps_bounds[2] = {gui_.adaptive_fps_min, gui_.adaptive_fps_max};
+                ImGui::SetNextItemWidth(150);
+                if (ImGui::DragInt2(CreateControlString("Min / Max FPS", GetInstanceName()).c_str(), fps_bounds, 1.0f, 1, 240)) {
+                    gui_.adaptive_fps_min = fps_bounds[0];
+                    gui_.adaptive_fps_max = fps_bounds[1];
+                    Post_([fps_bounds](oak_camera &cam) { cam.SetAdaptiveFpsBounds(fps_bounds[0], fps_bounds[1]); }, "SetAdaptiveFpsBounds");
+                }
+            }
+            if (ImGui::Checkbox(CreateControlString("Change Gated Streaming", GetInstanceName()).c_str(), &gui_.gate_enabled)) {
+                bool gate_enabled = gui_.gate_enabled;
+                Post_([gate_enabled](oak_camera &cam) { cam.SetGateEnabled(gate_enabled); }, "SetGateEnabled");
+            }
+            if (gui_.gate_enabled) {
+                bool gate_changed = false;
+                ImGui::SetNextItemWidth(100);
+                gate_changed |= ImGui::DragInt(CreateControlString("Change Threshold", GetInstanceName()).c_str(), &gui_.gate_threshold, 0.5f, 0, 254);
+                ImGui::SetNextItemWidth(100);
+                gate_changed |= ImGui::DragInt(CreateControlString("Keep-Alive ms", GetInstanceName()).c_str(), &gui_.gate_keepalive_ms, 10.0f, 100, 65535);
+                if (gate_changed) {
+                    int threshold = gui_.gate_threshold;
+                    int keepalive_ms = gui_.gate_keepalive_ms;
+                    Post_([threshold, keepalive_ms](oak_camera &cam) { cam.SetGateConfig(threshold, keepalive_ms); }, "SetGateConfig");
+                }
+            }
+            if (ImGui::TreeNode("Feature Tracking")) {
+                const char *sources[] = {"Off", "Color", "Left", "Right"};
+                const char *corners[] = {"Harris", "Shi-Tomasi"};
+                const char *motions[] = {"Off", "Optical Flow", "Hardware"};
+                ImGui::SetNextItemWidth(100);
+                if (ImGui::Combo(CreateControlString("Feature Source", GetInstanceName()).c_str(), &gui_.feature_source, sources, 4)) {
+                    int source = gui_.feature_source;
+                    Post_([source](oak_camera &cam) { cam.SetFeatureSource(source); }, "SetFeatureSource");
+                }
+                bool changed = false;
+                ImGui::SetNextItemWidth(100);
+                changed |= ImGui::DragInt(CreateControlString("Max Features", GetInstanceName()).c_str(), &gui_.feature_max, 4.0f, 8, 320);
+                ImGui::SetNextItemWidth(100);
+                changed |= ImGui::Combo(CreateControlString("Corner Detector", GetInstanceName()).c_str(), &gui_.feature_corner, corners, 2);
+                ImGui::SetNextItemWidth(100);
+                changed |= ImGui::Combo(CreateControlString("Motion Estimator", GetInstanceName()).c_str(), &gui_.feature_motion, motions, 3);
+                if (changed) {
+                    gui_.feature_max = std::clamp(gui_.feature_max, 8, 320);
+                    int max_features = gui_.feature_max;
+                    int corner = gui_.feature_corner;
+                    int motion = gui_.feature_motion;
+                    Post_([max_features, corner, motion](oak_camera &cam) { cam.SetFeatureConfig(max_features, corner, motion); }, "SetFeatureConfig");
+                }
+                ImGui::TreePop();
+            }
+            const auto &bandwidth = gui_.bandwidth_plan;
+            if (!bandwidth.empty()) {
+                ImGui::Text("Bandwidth: %.0f / %.0f MB/s (%s)", bandwidth["planned_mbs"].get<double>(),
+                            bandwidth["capacity_mbs"].get<double>(), bandwidth["usb_speed"].get<std::string>().c_str());
+                if (!bandwidth["fits"].get<bool>()) {
+                    ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.0f, 1.0f), "Streams exceed the USB link, expect dropped frames");
+                }
+                else if (bandwidth["adjusted"].get<bool>()) {
+                    ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.0f, 1.0f), "Stepped down to fit the USB link:");
+                    for (const auto &stream : bandwidth["streams"]) {
+                        ImGui::Text("  %s %d x %d @ %d", stream["name"].get<std::string>().c_str(), stream["width"].get<int>(),
+                                    stream["height"].get<int>(), stream["fps"].get<int>());
+                    }
+                }
+            }
+            const auto &telemetry = gui_.telemetry;
+            if (!telemetry.empty() && ImGui::TreeNode("Device Telemetry")) {
+                auto mem_mb = [](const nlohmann::json &mem, const char *key) {
+                    return (float)mem[key].get<int64_t>() / (1024.0f * 1024.0f);
+                };
+                ImGui::Text("USB Speed: %s", telemetry["usb_speed"].get<std::string>().c_str());
+                ImGui::Text("Temperature: %.1f C (CSS %.1f, MSS %.1f, UPA %.1f, DSS %.1f)",
+                            telemetry["temperature"]["average"].get<float>(), telemetry["temperature"]["css"].get<float>(),
+                            telemetry["temperature"]["mss"].get<float>(), telemetry["temperature"]["upa"].get<float>(),
+                            telemetry["temperature"]["dss"].get<float>());
+                ImGui::Text("CPU: CSS %.1f%%, MSS %.1f%%", telemetry["cpu"]["css"].get<float>(), telemetry["cpu"]["mss"].get<float>());
+                const auto &mem = telemetry["memory"];
+                ImGui::Text("DDR: %.1f / %.1f MiB", mem_mb(mem["ddr"], "used"), mem_mb(mem["ddr"], "total"));
+                ImGui::Text("CMX: %.2f / %.2f MiB", mem_mb(mem["cmx"], "used"), mem_mb(mem["cmx"], "total"));
+                ImGui::Text("CSS Heap: %.1f / %.1f MiB", mem_mb(mem["css_heap"], "used"), mem_mb(mem["css_heap"], "total"));
+                ImGui::Text("MSS Heap: %.1f / %.1f MiB", mem_mb(mem["mss_heap"], "used"), mem_mb(mem["mss_heap"], "total"));
+                ImGui::TreePop();
+            }
+            if (ImGui::TreeNode("Soak Monitor")) {
+                if (ImGui::Checkbox(CreateControlString("Report Soak Stats", GetInstanceName()).c_str(), &gui_.soak_enabled)) {
+                    bool soak_enabled = gui_.soak_enabled;
+                    Post_([soak_enabled](oak_camera &cam) { cam.SetSoakMonitor(soak_enabled); }, "SetSoakMonitor");
+                }
+                float budget[3] = {(float)gui_.soak_budget.rss_growth_mb, (float)gui_.soak_budget.latency_p99_ms,
+                                   (float)gui_.soak_budget.reconfigure_ms};
+                bool budget_changed = false;
+                ImGui::SetNextItemWidth(100);
+                budget_changed |= ImGui::DragFloat(CreateControlString("RSS Growth MB", GetInstanceName()).c_str(), &budget[0], 1.0f, 0.0f, 16384.0f, "%.0f");
+                ImGui::SetNextItemWidth(100);
+                budget_changed |= ImGui::DragFloat(CreateControlString("Latency p99 ms", GetInstanceName()).c_str(), &budget[1], 1.0f, 0.0f, 10000.0f, "%.0f");
+                ImGui::SetNextItemWidth(100);
+                budget_changed |= ImGui::DragFloat(CreateControlString("Reconfigure ms", GetInstanceName()).c_str(), &budget[2], 10.0f, 0.0f, 120000.0f, "%.0f");
+                if (budget_changed) {
+                    gui_.soak_budget = {budget[0], budget[1], budget[2]};
+                    SoakBudget soak_budget = gui_.soak_budget;
+                    Post_([soak_budget](oak_camera &cam) { cam.SetSoakBudget(soak_budget); }, "SetSoakBudget");
+                }
+                if (ImGui::Button(CreateControlString("Reset Soak Stats", GetInstanceName()).c_str()))
+                    Post_([](oak_camera &cam) { cam.ResetSoak(); });
+                const auto &stats = gui_.soak_stats;
+                ImGui::Text("Uptime: %.1f min, status: %s", stats.uptime_min, stats.violations == 0 ? "ok" : "FAIL");
+                for (const auto &name : soak_monitor::GetViolationNames(stats.violations))
+                    ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Budget exceeded: %s", name.c_str());
+                ImGui::Text("RSS: %.1f MB (%+.1f MB since warm up)", stats.rss_mb, stats.rss_growth_mb);
+                ImGui::Text("Latency: p50 %.1f, p95 %.1f, p99 %.1f, max %.1f ms", stats.latency_p50_ms, stats.latency_p95_ms,
+                            stats.latency_p99_ms, stats.latency_max_ms);
+                ImGui::Text("Reconfigures: %llu, last %.0f ms, max %.0f ms", (unsigned long long)stats.reconfigures,
+                            stats.reconfigure_last_ms, stats.reconfigure_max_ms);
+                ImGui::Text("Frames: %llu, property changes %llu", (unsigned long long)stats.frames, (unsigned long long)stats.property_changes);
+                if (!gui_.soak_rss_history.empty()) {
+                    ImGui::PlotLines(CreateControlString("RSS MB / min", GetInstanceName()).c_str(), gui_.soak_rss_history.data(), (int)gui_.soak_rss_history.size(), 0, nullptr,
+                                     FLT_MAX, FLT_MAX, ImVec2(250, 50));
+                    ImGui::PlotLines(CreateControlString("p99 ms / min", GetInstanceName()).c_str(), gui_.soak_latency_history.data(), (int)gui_.soak_latency_history.size(), 0, nullptr,
+                                     FLT_MAX, FLT_MAX, ImVec2(250, 50));
+                }
+                ImGui::TreePop();
+            }
+            if (ImGui::TreeNode("Host Memory")) {
+                ImGui::SetNextItemWidth(100);
+                if (ImGui::DragInt(CreateControlString("Memory Budget MB", GetInstanceName()).c_str(), &gui_.memory_budget_mb, 4.0f, 0, 65536)) {
+                    int memory_budget_mb = gui_.memory_budget_mb;
+                    Post_([memory_budget_mb](oak_camera &cam) { cam.SetMemoryBudget(memory_budget_mb); }, "SetMemoryBudget");
+                }
+                if (gui_.memory_level > MemoryLevel_None && ImGui::Button(CreateControlString("Restore Full Quality", GetInstanceName()).c_str()))
+                    Post_([](oak_camera &cam) { cam.ResetMemoryLevel(); });
+                auto to_mb = [](size_t bytes) {
+                    return (float)bytes / (1024.0f * 1024.0f);
+                };
+                const auto &usage = gui_.memory_usage;
+                ImGui::Text("Total: %.1f MB%s", to_mb(usage.Total()), gui_.memory_budget_mb > 0 ? "" : " (no budget)");
+                ImGui::Text("Frames %.1f, derived %.1f, queues %.1f MB", to_mb(usage.frames), to_mb(usage.derived), to_mb(usage.queues));
+                ImGui::Text("Metadata %.2f, fusion %.1f MB", to_mb(usage.metadata), to_mb(usage.fusion));
+                if (gui_.memory_level > MemoryLevel_None)
+                    ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.3f, 1.0f), "Reduced: %s", memory_budget::GetLevelName(gui_.memory_level));
+                ImGui::TreePop();
+            }
 
             //
             // Color Section
             //
-            if (camera_->HasColor()) {
-                auto color_cfg_list = camera_->GetStreamConfigList(dai::CameraBoardSocket::RGB);
+            if (gui_.has_color && !gui_.color_configs.empty()) {
+                auto *color_cfg_list = &gui_.color_configs;
+                if (color_cfg_idx_ < 0 || color_cfg_idx_ >= color_cfg_list->size() ||
+                    color_fps_idx_ >= color_cfg_list->at(color_cfg_idx_).fps_list.size())
+                    SelectStreamConfig(*color_cfg_list, color_res_, color_fps_, color_cfg_idx_, color_fps_idx_);
                 if (ImGui::Checkbox(CreateControlString("Enable Color Sensor", GetInstanceName()).c_str(), &enable_color_)) {
                     color_cfg_list->at(color_cfg_idx_).fps_idx = color_fps_idx_;
                     if (enable_color_)
-                        camera_->EnableStream(color_cfg_list->at(color_cfg_idx_));
+                        PostEnableStream_(color_cfg_list->at(color_cfg_idx_));
                     else
-                        camera_->DisableStream(dai::CameraBoardSocket::RGB);
+                        Post_([this](oak_camera &) { device_->ClearStreamRequest(client_id_, dai::CameraBoardSocket::RGB); });
                 }
                 ImGui::SetNextItemWidth(100);
                 if (ImGui::Combo(CreateControlString("Color Resolution", GetInstanceName()).c_str(), &color_cfg_idx_, [](void *data, int idx, const char **out_text) {
@@ -133,8 +730,9 @@ void OakCamera::UpdateGui(void *context, int interface)
                         }
                     }
                     color_cfg_list->at(color_cfg_idx_).fps_idx = color_fps_idx_;
+                    color_res_ = color_cfg_list->at(color_cfg_idx_).str_resolution;
                     if (enable_color_) {
-                        camera_->EnableStream(color_cfg_list->at(color_cfg_idx_));
+                        PostEnableStream_(color_cfg_list->at(color_cfg_idx_));
                     }
                 }
                 ImGui::SetNextItemWidth(100);
@@ -153,47 +751,78 @@ void OakCamera::UpdateGui(void *context, int interface)
                     color_cfg_list->at(color_cfg_idx_).fps_idx = color_fps_idx_;
                     color_fps_ = color_cfg_list->at(color_cfg_idx_).fps_list.at(color_fps_idx_);
                     if (enable_color_) {
-                        camera_->EnableStream(color_cfg_list->at(color_cfg_idx_));
+                        PostEnableStream_(color_cfg_list->at(color_cfg_idx_));
+                    }
+                }
+                if (enable_color_ && !gui_.color_override.empty())
+                    ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "Shared device runs %s, frames arrive at that size", gui_.color_override.c_str());
+                bool outputs_changed = ImGui::Checkbox(CreateControlString("Full Resolution Output", GetInstanceName()).c_str(), &gui_.full_res_output);
+                outputs_changed |= ImGui::Checkbox(CreateControlString("Preview Output", GetInstanceName()).c_str(), &gui_.preview_output);
+                if (outputs_changed) {
+                    bool full_res = gui_.full_res_output;
+                    bool preview = gui_.preview_output;
+                    Post_([full_res, preview](oak_camera &cam) { cam.SetColorOutputs(full_res, preview); }, "SetColorOutputs");
+                }
+                bool still_changed = ImGui::Checkbox(CreateControlString("Still Capture", GetInstanceName()).c_str(), &gui_.still_capture);
+                if (gui_.still_capture) {
+                    ImGui::SameLine();
+                    still_changed |= ImGui::Checkbox(CreateControlString("JPEG", GetInstanceName()).c_str(), &gui_.still_jpeg);
+                    ImGui::SameLine();
+                    if (ImGui::Button(CreateControlString("Capture", GetInstanceName()).c_str()))
+                        Post_([](oak_camera &cam) { cam.CaptureStill(); });
+                }
+                if (still_changed) {
+                    bool still = gui_.still_capture;
+                    bool still_jpeg = gui_.still_jpeg;
+                    Post_([still, still_jpeg](oak_camera &cam) { cam.SetStillCapture(still, still_jpeg); }, "SetStillCapture");
+                }
+                if (gui_.preview_output) {
+                    auto &preview_sizes = gui_.preview_size_list;
+                    ImGui::SetNextItemWidth(100);
+                    if (ImGui::Combo(CreateControlString("Preview Size", GetInstanceName()).c_str(), &gui_.preview_size, [](void *data, int idx, const char **out_text) {
+                        *out_text = ((const std::vector<std::string> *) data)->at(idx).c_str();
+                        return true;
+                    }, (void *) &preview_sizes, (int) preview_sizes.size())) {
+                        int preview_size = gui_.preview_size;
+                        Post_([preview_size](oak_camera &cam) { cam.SetPreviewSize(preview_size); }, "SetPreviewSize");
                     }
                 }
                 if (enable_color_) {
+                    if (ImGui::Checkbox(CreateControlString("Undistort Color", GetInstanceName()).c_str(), &gui_.undistort_color)) {
+                        bool undistort = gui_.undistort_color;
+                        Post_([undistort](oak_camera &cam) { cam.SetUndistortColor(undistort); }, "SetUndistortColor");
+                    }
+                    if (ImGui::Checkbox(CreateControlString("Host Auto Exposure", GetInstanceName()).c_str(), &gui_.host_ae_enabled)) {
+                        bool host_ae = gui_.host_ae_enabled;
+                        Post_([host_ae](oak_camera &cam) { cam.SetHostAutoExposure(host_ae); }, "SetHostAutoExposure");
+                    }
+                    if (gui_.host_ae_enabled && ImGui::TreeNode("Host Exposure")) {
+                        const char *flicker_modes[] = {"Off", "50 Hz", "60 Hz"};
+                        float region[4] = {gui_.host_ae_region.x, gui_.host_ae_region.y, gui_.host_ae_region.width, gui_.host_ae_region.height};
+                        bool ae_changed = false;
+                        ImGui::SetNextItemWidth(100);
+                        ae_changed |= ImGui::DragInt(CreateControlString("Target Luma", GetInstanceName()).c_str(), &gui_.host_ae_target, 1.0f, 16, 240);
+                        ImGui::SetNextItemWidth(100);
+                        ae_changed |= ImGui::Combo(CreateControlString("Flicker", GetInstanceName()).c_str(), &gui_.host_ae_flicker, flicker_modes, 3);
+                        ImGui::SetNextItemWidth(200);
+                        ae_changed |= ImGui::DragFloat4(CreateControlString("Metering Region", GetInstanceName()).c_str(), region, 0.005f, 0.0f, 1.0f, "%.2f");
+                        if (ae_changed) {
+                            gui_.host_ae_region = cv::Rect2f(region[0], region[1], region[2], region[3]);
+                            int target = gui_.host_ae_target;
+                            int flicker = gui_.host_ae_flicker;
+                            cv::Rect2f ae_region = gui_.host_ae_region;
+                            Post_([target, flicker, ae_region](oak_camera &cam) { cam.SetHostAutoExposureConfig(target, flicker, ae_region); }, "SetHostAutoExposureConfig");
+                        }
+                        ImGui::TreePop();
+                    }
                     if (ImGui::TreeNode("Color Controls")) {
-                        auto color_props = camera_->GetPropertyList(dai::CameraBoardSocket::RGB);
                         if (ImGui::Button(CreateControlString("Restore Color Defaults", GetInstanceName()).c_str())) {
-                            camera_->ResetProperties(dai::CameraBoardSocket::RGB);
+                            for (auto &prop : gui_.color_props)
+                                prop.value = prop.range.def;
+                            Post_([](oak_camera &cam) { cam.ResetProperties(dai::CameraBoardSocket::RGB); });
                         }
                         ImGui::Separator();
-                        for (auto &prop : *color_props) {
-                            if (prop.second.range.min == 0 && prop.second.range.max == 1) { // Checkbox Control
-                                bool tmpVal = (bool)prop.second.value;
-                                ImGui::SetNextItemWidth(100);
-                                if (ImGui::Checkbox(CreateControlString(prop.first.c_str(), GetInstanceName()).c_str(), &tmpVal)) {
-                                    prop.second.value = (int)tmpVal;
-                                    camera_->SetProperty(dai::CameraBoardSocket::RGB, prop.first);
-                                }
-                            }
-                            else if (prop.second.is_list) { // Combo List
-                                ImGui::SetNextItemWidth(150);
-                                if (ImGui::Combo(CreateControlString(prop.first.c_str(), GetInstanceName()).c_str(),
-                                                 &prop.second.value, [](void* data, int idx, const char** out_text) {
-                                        *out_text = ((const std::vector<std::string>*)data)->at(idx).c_str();
-                                        return true;
-                                    }, (void*)&prop.second.opt_list, (int)prop.second.opt_list.size())) {
-                                    camera_->SetProperty(dai::CameraBoardSocket::RGB, prop.first);
-                                }
-                            }
-                            else { // Int Drag Control
-                                ImGui::SetNextItemWidth(100);
-                                if (ImGui::DragInt(CreateControlString(prop.first.c_str(), GetInstanceName()).c_str(),
-                                                   &prop.second.value, prop.second.range.step, prop.second.range.min, prop.second.range.max)) {
-                                    if (prop.second.value < prop.second.range.min)
-                                        prop.second.value = prop.second.range.min;
-                                    else if (prop.second.value > prop.second.range.max)
-                                        prop.second.value = prop.second.range.max;
-                                    camera_->SetProperty(dai::CameraBoardSocket::RGB, prop.first);
-                                }
-                            }
-                        }
+                        PropertyControls_(gui_.color_props, dai::CameraBoardSocket::RGB);
                         ImGui::TreePop();
                     }
                 }
@@ -202,14 +831,17 @@ void OakCamera::UpdateGui(void *context, int interface)
             //
             // Depth Section
             //
-            if (camera_->HasDepth()) {
-                auto depth_cfg_list = camera_->GetStreamConfigList(dai::CameraBoardSocket::AUTO);
+            if (gui_.has_depth && !gui_.depth_configs.empty()) {
+                auto *depth_cfg_list = &gui_.depth_configs;
+                if (depth_cfg_idx_ < 0 || depth_cfg_idx_ >= depth_cfg_list->size() ||
+                    depth_fps_idx_ >= depth_cfg_list->at(depth_cfg_idx_).fps_list.size())
+                    SelectStreamConfig(*depth_cfg_list, depth_res_, depth_fps_, depth_cfg_idx_, depth_fps_idx_);
                 if (ImGui::Checkbox(CreateControlString("Enable Depth Sensor", GetInstanceName()).c_str(), &enable_depth_)) {
                     depth_cfg_list->at(depth_cfg_idx_).fps_idx = depth_fps_idx_;
                     if (enable_depth_)
-                        camera_->EnableStream(depth_cfg_list->at(depth_cfg_idx_));
+                        PostEnableStream_(depth_cfg_list->at(depth_cfg_idx_));
                     else
-                        camera_->DisableStream(dai::CameraBoardSocket::AUTO);
+                        Post_([this](oak_camera &) { device_->ClearStreamRequest(client_id_, dai::CameraBoardSocket::AUTO); });
                 }
                 ImGui::SetNextItemWidth(100);
                 if (ImGui::Combo(CreateControlString("Depth Resolution", GetInstanceName()).c_str(), &depth_cfg_idx_, [](void* data, int idx, const char** out_text) {
@@ -223,8 +855,9 @@ void OakCamera::UpdateGui(void *context, int interface)
                         }
                     }
                     depth_cfg_list->at(depth_cfg_idx_).fps_idx = depth_fps_idx_;
+                    depth_res_ = depth_cfg_list->at(depth_cfg_idx_).str_resolution;
                     if (enable_depth_) {
-                        camera_->EnableStream(depth_cfg_list->at(depth_cfg_idx_));
+                        PostEnableStream_(depth_cfg_list->at(depth_cfg_idx_));
                     }
                 }
                 ImGui::SetNextItemWidth(100);
@@ -243,48 +876,152 @@ void OakCamera::UpdateGui(void *context, int interface)
                     depth_cfg_list->at(depth_cfg_idx_).fps_idx = depth_fps_idx_;
                     depth_fps_ = depth_cfg_list->at(depth_cfg_idx_).fps_list.at(depth_fps_idx_);
                     if (enable_depth_) {
-                        camera_->EnableStream(depth_cfg_list->at(depth_cfg_idx_));
+                        PostEnableStream_(depth_cfg_list->at(depth_cfg_idx_));
+                    }
+                }
+                if (enable_depth_ && !gui_.depth_override.empty())
+                    ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "Shared device runs %s, frames arrive at that size", gui_.depth_override.c_str());
+                if (enable_depth_ && gui_.has_color) {
+                    const char *align_modes[] = {"Device", "Host"};
+                    ImGui::SetNextItemWidth(100);
+                    if (ImGui::Combo(CreateControlString("Depth Align", GetInstanceName()).c_str(), &gui_.depth_align_mode, align_modes, 2)) {
+                        int align_mode = gui_.depth_align_mode;
+                        Post_([align_mode](oak_camera &cam) { cam.SetDepthAlignMode(align_mode); }, "SetDepthAlignMode");
                     }
                 }
                 if (enable_depth_) {
-                    if (ImGui::TreeNode("Depth Controls")) {
-                        auto depth_props = camera_->GetPropertyList(dai::CameraBoardSocket::AUTO);
-                        for (auto &prop : *depth_props) {
-                            if (prop.second.range.min == 0 && prop.second.range.max == 1) { // Checkbox Control
-                                bool tmpVal = (bool)prop.second.value;
-                                ImGui::SetNextItemWidth(100);
-                                if (ImGui::Checkbox(CreateControlString(prop.first.c_str(), GetInstanceName()).c_str(), &tmpVal)) {
-                                    prop.second.value = (int)tmpVal;
-                                    camera_->SetProperty(dai::CameraBoardSocket::AUTO, prop.first);
-                                }
-                            }
-                            else if (prop.second.is_list) { // Combo List
-                                ImGui::SetNextItemWidth(150);
-                                if (ImGui::Combo(CreateControlString(prop.first.c_str(), GetInstanceName()).c_str(),
-                                                 &prop.second.value, [](void* data, int idx, const char** out_text) {
-                                        *out_text = ((const std::vector<std::string>*)data)->at(idx).c_str();
-                                        return true;
-                                    }, (void*)&prop.second.opt_list, (int)prop.second.opt_list.size())) {
-                                    if (prop.first == "Preset") {
-                                        camera_->EnableStream(depth_cfg_list->at(depth_cfg_idx_));
-                                    }
-                                    else {
-                                        camera_->SetProperty(dai::CameraBoardSocket::AUTO, prop.first);
-                                    }
-                                }
+                    if (ImGui::Checkbox(CreateControlString("Depth Frame Output", GetInstanceName()).c_str(), &gui_.depth_output)) {
+                        bool depth_output = gui_.depth_output;
+                        Post_([depth_output](oak_camera &cam) { cam.SetDepthOutput(depth_output); }, "SetDepthOutput");
+                    }
+                    if (ImGui::Checkbox(CreateControlString("Compressed Depth Output", GetInstanceName()).c_str(), &gui_.compress_depth)) {
+                        bool compress_depth = gui_.compress_depth;
+                        Post_([compress_depth](oak_camera &cam) { cam.SetCompressDepth(compress_depth); }, "SetCompressDepth");
+                    }
+                    if (ImGui::Checkbox(CreateControlString("Laser Scan Output", GetInstanceName()).c_str(), &gui_.scan_enabled)) {
+                        bool scan_enabled = gui_.scan_enabled;
+                        Post_([scan_enabled](oak_camera &cam) { cam.SetScanEnabled(scan_enabled); }, "SetScanEnabled");
+                    }
+                    if (gui_.scan_enabled) {
+                        int band[2] = {gui_.scan_band_top, gui_.scan_band_bottom};
+                        ImGui::SetNextItemWidth(150);
+                        if (ImGui::DragInt2(CreateControlString("Scan Band %", GetInstanceName()).c_str(), band, 1.0f, 0, 100)) {
+                            gui_.scan_band_top = band[0];
+                            gui_.scan_band_bottom = band[1];
+                            Post_([band](oak_camera &cam) { cam.SetScanBand(band[0], band[1]); }, "SetScanBand");
+                        }
+                    }
+                    if (ImGui::Checkbox(CreateControlString("Range Mask Output", GetInstanceName()).c_str(), &gui_.mask_enabled)) {
+                        bool mask_enabled = gui_.mask_enabled;
+                        Post_([mask_enabled](oak_camera &cam) { cam.SetMaskEnabled(mask_enabled); }, "SetMaskEnabled");
+                    }
+                    if (gui_.mask_enabled && ImGui::TreeNode("Range Mask")) {
+                        int range[2] = {gui_.mask_near, gui_.mask_far};
+                        ImGui::SetNextItemWidth(150);
+                        if (ImGui::DragInt2(CreateControlString("Near / Far mm", GetInstanceName()).c_str(), range, 5.0f, 1, 65535)) {
+                            gui_.mask_near = range[0];
+                            gui_.mask_far = range[1];
+                            Post_([range](oak_camera &cam) { cam.SetMaskRange(range[0], range[1]); }, "SetMaskRange");
+                        }
+                        ImGui::SetNextItemWidth(100);
+                        if (ImGui::DragInt(CreateControlString("Cleanup Radius", GetInstanceName()).c_str(), &gui_.mask_cleanup, 0.1f, 0, 15)) {
+                            int cleanup = gui_.mask_cleanup;
+                            Post_([cleanup](oak_camera &cam) { cam.SetMaskCleanup(cleanup); }, "SetMaskCleanup");
+                        }
+                        if (gui_.has_color && ImGui::Checkbox(CreateControlString("Masked Color Output", GetInstanceName()).c_str(), &gui_.mask_color)) {
+                            bool mask_color = gui_.mask_color;
+                            Post_([mask_color](oak_camera &cam) { cam.SetMaskColor(mask_color); }, "SetMaskColor");
+                        }
+                        ImGui::TreePop();
+                    }
+                    if (ImGui::Checkbox(CreateControlString("ROI Depth Output", GetInstanceName()).c_str(), &gui_.spatial_enabled)) {
+                        bool spatial_enabled = gui_.spatial_enabled;
+                        Post_([spatial_enabled](oak_camera &cam) { cam.SetSpatialEnabled(spatial_enabled); }, "SetSpatialEnabled");
+                    }
+                    if (gui_.spatial_enabled && ImGui::TreeNode("Depth ROIs")) {
+                        const char *algorithms[] = {"Average", "Min", "Max", "Mode", "Median"};
+                        int range[2] = {gui_.spatial_lower, gui_.spatial_upper};
+                        bool cfg_changed = false;
+                        ImGui::SetNextItemWidth(100);
+                        cfg_changed |= ImGui::Combo(CreateControlString("ROI Statistic", GetInstanceName()).c_str(), &gui_.spatial_algorithm, algorithms, 5);
+                        ImGui::SetNextItemWidth(150);
+                        cfg_changed |= ImGui::DragInt2(CreateControlString("Depth Range mm", GetInstanceName()).c_str(), range, 10.0f, 0, 65535);
+                        if (cfg_changed) {
+                            gui_.spatial_lower = range[0];
+                            gui_.spatial_upper = range[1];
+                            int algorithm = gui_.spatial_algorithm;
+                            Post_([algorithm, range](oak_camera &cam) { cam.SetSpatialConfig(algorithm, range[0], range[1]); }, "SetSpatialConfig");
+                        }
+                        auto &rois = gui_.spatial_rois;
+                        bool rois_changed = false;
+                        int remove_idx = -1;
+                        for (int i = 0; i < rois.size(); i++) {
+                            float roi[4] = {rois[i].x, rois[i].y, rois[i].width, rois[i].height};
+                            ImGui::PushID(i);
+                            ImGui::SetNextItemWidth(200);
+                            if (ImGui::DragFloat4(CreateControlString("ROI x y w h", GetInstanceName()).c_str(), roi, 0.005f, 0.0f, 1.0f)) {
+                                rois[i] = cv::Rect2f(roi[0], roi[1], roi[2], roi[3]);
+                                rois_changed = true;
                             }
-                            else { // Int Drag Control
-                                ImGui::SetNextItemWidth(100);
-                                if (ImGui::DragInt(CreateControlString(prop.first.c_str(), GetInstanceName()).c_str(),
-                                                   &prop.second.value, prop.second.range.step, prop.second.range.min, prop.second.range.max)) {
-                                    if (prop.second.value < prop.second.range.min)
-                                        prop.second.value = prop.second.range.min;
-                                    else if (prop.second.value > prop.second.range.max)
-                                        prop.second.value = prop.second.range.max;
-                                    camera_->SetProperty(dai::CameraBoardSocket::AUTO, prop.first);
-                                }
+                            if (rois.size() > 1) {
+                                ImGui::SameLine();
+                                if (ImGui::SmallButton("X"))
+                                    remove_idx = i;
                             }
+                            ImGui::PopID();
                         }
+                        if (remove_idx >= 0) {
+                            rois.erase(rois.begin() + remove_idx);
+                            rois_changed = true;
+                        }
+                        if (ImGui::Button(CreateControlString("Add ROI", GetInstanceName()).c_str())) {
+                            rois.emplace_back(0.45f, 0.45f, 0.1f, 0.1f);
+                            rois_changed = true;
+                        }
+                        if (rois_changed) {
+                            Post_([rois](oak_camera &cam) { cam.SetSpatialRois(rois); }, "SetSpatialRois");
+                        }
+                        ImGui::TreePop();
+                    }
+                    if (ImGui::Checkbox(CreateControlString("TSDF Fusion", GetInstanceName()).c_str(), &gui_.fusion_enabled)) {
+                        bool fusion_enabled = gui_.fusion_enabled;
+                        Post_([fusion_enabled](oak_camera &cam) { cam.SetFusionEnabled(fusion_enabled); }, "SetFusionEnabled");
+                    }
+                    if (gui_.fusion_enabled && ImGui::TreeNode("Fusion Volume")) {
+                        bool cfg_changed = false;
+                        ImGui::SetNextItemWidth(100);
+                        cfg_changed |= ImGui::DragInt(CreateControlString("Voxel Size mm", GetInstanceName()).c_str(), &gui_.fusion_voxel_mm, 0.5f, 2, 100);
+                        ImGui::SetNextItemWidth(100);
+                        cfg_changed |= ImGui::DragInt(CreateControlString("Memory Budget MB", GetInstanceName()).c_str(), &gui_.fusion_budget_mb, 8.0f, 16, 8192);
+                        cfg_changed |= ImGui::Checkbox(CreateControlString("Changed Blocks Only", GetInstanceName()).c_str(), &gui_.fusion_incremental);
+                        if (cfg_changed) {
+                            gui_.fusion_voxel_mm = std::clamp(gui_.fusion_voxel_mm, 2, 100);
+                            gui_.fusion_budget_mb = std::clamp(gui_.fusion_budget_mb, 16, 8192);
+                            int voxel_mm = gui_.fusion_voxel_mm;
+                            int budget_mb = gui_.fusion_budget_mb;
+                            bool incremental = gui_.fusion_incremental;
+                            Post_([voxel_mm, budget_mb, incremental](oak_camera &cam) { cam.SetFusionConfig(voxel_mm, budget_mb, incremental); }, "SetFusionConfig");
+                        }
+                        if (ImGui::Button(CreateControlString("Extract Points", GetInstanceName()).c_str()))
+                            Post_([this](oak_camera &) { device_->RequestPoints(); });
+                        ImGui::SameLine();
+                        if (ImGui::Button(CreateControlString("Reset Volume", GetInstanceName()).c_str()))
+                            Post_([](oak_camera &cam) { cam.ResetFusion(); });
+                        const auto &stats = gui_.fusion_stats;
+                        ImGui::Text("Blocks: %zu (%.1f / %d MB)", stats.blocks, (double)stats.memory_bytes / (1024.0 * 1024.0), gui_.fusion_budget_mb);
+                        ImGui::Text("Frames: %llu, dropped %llu, evicted %llu blocks", (unsigned long long)stats.frames,
+                                    (unsigned long long)stats.dropped, (unsigned long long)stats.evicted);
+                        ImGui::Text("Integrate: %.1f ms", stats.integrate_ms);
+                        ImGui::TreePop();
+                    }
+                    if (ImGui::TreeNode("Depth Controls")) {
+                        if (ImGui::Button(CreateControlString("Restore Depth Defaults", GetInstanceName()).c_str())) {
+                            for (auto &prop : gui_.depth_props)
+                                prop.value = prop.range.def;
+                            Post_([](oak_camera &cam) { cam.ResetProperties(dai::CameraBoardSocket::AUTO); });
+                        }
+                        ImGui::Separator();
+                        PropertyControls_(gui_.depth_props, dai::CameraBoardSocket::AUTO);
                         ImGui::TreePop();
                     }
                 }
@@ -293,41 +1030,137 @@ void OakCamera::UpdateGui(void *context, int interface)
     }
 }
 
+void OakCamera::PostEnableStream_(const StreamConfig &config)
+{
+    Post_([this, config](oak_camera &) { device_->SetStreamRequest(client_id_, config); });
+}
+
+void OakCamera::PropertyControls_(std::vector<Property> &props, dai::CameraBoardSocket stream_type)
+{
+    for (int i = 0; i < props.size(); i++) {
+        auto &prop = props.at(i);
+        bool changed = false;
+        if (prop.range.min == 0 && prop.range.max == 1) { // Checkbox Control
+            bool tmpVal = (bool)prop.value;
+            ImGui::SetNextItemWidth(100);
+            if (ImGui::Checkbox(CreateControlString(prop.name.c_str(), GetInstanceName()).c_str(), &tmpVal)) {
+                prop.value = (int)tmpVal;
+                changed = true;
+            }
+        }
+        else if (prop.is_list) { // Combo List
+            ImGui::SetNextItemWidth(150);
+            changed = ImGui::Combo(CreateControlString(prop.name.c_str(), GetInstanceName()).c_str(),
+                                   &prop.value, [](void* data, int idx, const char** out_text) {
+                    *out_text = ((const std::vector<std::string>*)data)->at(idx).c_str();
+                    return true;
+                }, (void*)&prop.opt_list, (int)prop.opt_list.size());
+        }
+        else { // Int Drag Control
+            ImGui::SetNextItemWidth(100);
+            if (ImGui::DragInt(CreateControlString(prop.name.c_str(), GetInstanceName()).c_str(),
+                               &prop.value, prop.range.step, prop.range.min, prop.range.max)) {
+                prop.value = std::clamp(prop.value, prop.range.min, prop.range.max);
+                changed = true;
+            }
+        }
+        if (changed) {
+            int value = prop.value;
+            Post_([stream_type, i, value](oak_camera &cam) { cam.SetPropertyValue(stream_type, i, value); }, PropertyKey(stream_type, i));
+        }
+    }
+}
+
 std::string OakCamera::GetState()
 {
     using namespace nlohmann;
 
     json state;
 
-    if (selected_camera_idx_ > 0 && camera_->IsInit()) {
+    // A restored state is handed back as it came until the camera it selects is up, so saving early loses nothing
+    if (!(selected_camera_idx_ > 0 && gui_.is_init) && !saved_state_.empty())
+        return saved_state_.dump(4);
+
+    // Rendered from the GUI copy, the processing thread owns the camera
+    if (selected_camera_idx_ > 0 && gui_.is_init) {
         state["cam_idx"] = selected_camera_idx_;
-        state["oak_serial"] = camera_->GetDeviceSerial(selected_camera_idx_);
+        if (selected_camera_idx_ <= gui_.device_serials.size())
+            state["oak_serial"] = gui_.device_serials.at(selected_camera_idx_ - 1);
+        state["shm_publish"] = gui_.shm_publish;
+        state["usb_max_speed"] = gui_.max_usb_speed;
+        state["auto_fit_bandwidth"] = gui_.auto_fit_bandwidth;
+        state["adaptive_fps"] = gui_.adaptive_fps;
+        state["feature_source"] = gui_.feature_source;
+        state["feature_max"] = gui_.feature_max;
+        state["feature_corner"] = gui_.feature_corner;
+        state["feature_motion"] = gui_.feature_motion;
+        state["adaptive_fps_min"] = gui_.adaptive_fps_min;
+        state["adaptive_fps_max"] = gui_.adaptive_fps_max;
+        state["gate"] = gui_.gate_enabled;
+        state["soak"] = gui_.soak_enabled;
+        state["soak_rss_growth_mb"] = gui_.soak_budget.rss_growth_mb;
+        state["soak_latency_p99_ms"] = gui_.soak_budget.latency_p99_ms;
+        state["soak_reconfigure_ms"] = gui_.soak_budget.reconfigure_ms;
+        state["memory_budget_mb"] = gui_.memory_budget_mb;
+        state["gate_threshold"] = gui_.gate_threshold;
+        state["gate_keepalive_ms"] = gui_.gate_keepalive_ms;
         state["color_enabled"] = enable_color_;
-        if (enable_color_) {
-            auto color_cfg_list = camera_->GetStreamConfigList(dai::CameraBoardSocket::RGB);
-            auto color_props = camera_->GetPropertyList(dai::CameraBoardSocket::RGB);
-            state["color_fps_idx"] = color_cfg_list->at(color_cfg_idx_).fps_idx;
-            state["color_fps"] = color_cfg_list->at(color_cfg_idx_).fps_list.at(color_cfg_list->at(color_cfg_idx_).fps_idx);
-            state["color_res_idx"] = color_cfg_idx_;
+        if (enable_color_ && color_cfg_idx_ >= 0 && color_cfg_idx_ < gui_.color_configs.size()) {
+            const auto &color_cfg = gui_.color_configs.at(color_cfg_idx_);
+            state["color_fps_idx"] = color_cfg.fps_idx;
+            state["color_fps"] = color_cfg.fps_list.at(color_cfg.fps_idx);
+            state["color_res"] = color_cfg.str_resolution;
+            state["color_undistort"] = gui_.undistort_color;
+            state["color_full_res"] = gui_.full_res_output;
+            state["color_preview"] = gui_.preview_output;
+            state["color_preview_size"] = gui_.preview_size;
+            state["color_still"] = gui_.still_capture;
+            state["color_still_jpeg"] = gui_.still_jpeg;
+            state["color_host_ae"] = gui_.host_ae_enabled;
+            state["color_host_ae_target"] = gui_.host_ae_target;
+            state["color_host_ae_flicker"] = gui_.host_ae_flicker;
+            const auto &region = gui_.host_ae_region;
+            state["color_host_ae_region"] = {region.x, region.y, region.width, region.height};
             nlohmann::json color_controls;
-            for(const auto &prop : *color_props) {
-                color_controls[prop.first] = prop.second.value;
+            for(const auto &prop : gui_.color_props) {
+                color_controls[prop.name] = prop.value;
             }
             state["color_controls"] = color_controls;
         }
         state["depth_enabled"] = enable_depth_;
-        if (enable_depth_) {
-            auto depth_cfg_list = camera_->GetStreamConfigList(dai::CameraBoardSocket::AUTO);
-            auto depth_props = camera_->GetPropertyList(dai::CameraBoardSocket::AUTO);
-            state["depth_fps_idx"] = depth_cfg_list->at(depth_cfg_idx_).fps_idx;
-            state["depth_fps"] = depth_cfg_list->at(depth_cfg_idx_).fps_list.at(depth_cfg_list->at(depth_cfg_idx_).fps_idx);
-            state["depth_res_idx"] = depth_cfg_idx_;
+        if (enable_depth_ && depth_cfg_idx_ >= 0 && depth_cfg_idx_ < gui_.depth_configs.size()) {
+            const auto &depth_cfg = gui_.depth_configs.at(depth_cfg_idx_);
+            state["depth_fps_idx"] = depth_cfg.fps_idx;
+            state["depth_fps"] = depth_cfg.fps_list.at(depth_cfg.fps_idx);
+            state["depth_res"] = depth_cfg.str_resolution;
+            state["depth_align"] = gui_.depth_align_mode;
+            state["depth_output"] = gui_.depth_output;
+            state["depth_compress"] = gui_.compress_depth;
+            state["depth_spatial"] = gui_.spatial_enabled;
+            state["depth_spatial_algorithm"] = gui_.spatial_algorithm;
+            state["depth_spatial_lower"] = gui_.spatial_lower;
+            state["depth_spatial_upper"] = gui_.spatial_upper;
+            nlohmann::json rois = nlohmann::json::array();
+            for (const auto &roi : gui_.spatial_rois)
+                rois.push_back({roi.x, roi.y, roi.width, roi.height});
+            state["depth_spatial_rois"] = rois;
+            state["depth_scan"] = gui_.scan_enabled;
+            state["depth_scan_top"] = gui_.scan_band_top;
+            state["depth_scan_bottom"] = gui_.scan_band_bottom;
+            state["depth_mask"] = gui_.mask_enabled;
+            state["depth_mask_near"] = gui_.mask_near;
+            state["depth_mask_far"] = gui_.mask_far;
+            state["depth_mask_cleanup"] = gui_.mask_cleanup;
+            state["depth_mask_color"] = gui_.mask_color;
+            state["fusion"] = gui_.fusion_enabled;
+            state["fusion_voxel_mm"] = gui_.fusion_voxel_mm;
+            state["fusion_budget_mb"] = gui_.fusion_budget_mb;
+            state["fusion_incremental"] = gui_.fusion_incremental;
             nlohmann::json depth_controls;
-            for(const auto &prop : *depth_props) {
-                depth_controls[prop.first] = prop.second.value;
+            for(const auto &prop : gui_.depth_props) {
+                depth_controls[prop.name] = prop.value;
             }
             state["depth_controls"] = depth_controls;
-            nlohmann::json depth_filtering;
         }
     }
 
@@ -341,97 +1174,26 @@ void OakCamera::SetState(std::string &&json_serialized)
     using namespace nlohmann;
 
     json state = json::parse(json_serialized);
+    saved_state_ = state;
 
-    std::lock_guard<std::mutex> lck(io_mutex_);
-
+    // GUI side selections, the device index is confirmed by the next snapshot once the restore has run
     if (state.contains("cam_idx"))
         selected_camera_idx_ = state["cam_idx"].get<int>();
-    if (selected_camera_idx_ > 0) {
-        camera_->RefreshDeviceList();
-        bool cam_exists = false;
-        std::string saved_serial;
-        if (state.contains("oak_serial"))
-            saved_serial = state["oak_serial"].get<std::string>();
-
-        if (!saved_serial.empty()) {
-            std::string idx_serial = camera_->GetDeviceSerial(selected_camera_idx_);
-            if (idx_serial != saved_serial) {
-                // Attempt to find matching serial device
-                for (int i = 0; i < camera_->GetDeviceCount(); i++) {
-                    std::string check = camera_->GetDeviceSerial(i);
-                    if (check == saved_serial) {
-                        selected_camera_idx_ = i;
-                        cam_exists = true;
-                        break;
-                    }
-                }
-            } else {
-                cam_exists = true;
-            }
-            if (cam_exists) {
-                camera_->InitCamera(selected_camera_idx_, true);
-                if (state.contains("color_enabled"))
-                    enable_color_ = state["color_enabled"].get<bool>();
-                if (enable_color_) {
-                    auto color_cfg_list = camera_->GetStreamConfigList(dai::CameraBoardSocket::RGB);
-                    auto color_props = camera_->GetPropertyList(dai::CameraBoardSocket::RGB);
-                    if (state.contains("color_res_idx"))
-                        color_cfg_idx_ = state["color_res_idx"].get<int>();
-                    if (state.contains("color_fps_idx"))
-                        color_fps_idx_ = state["color_fps_idx"].get<int>();
-                    if (state.contains("color_fps"))
-                        color_fps_ = state["color_fps"].get<int>();
-                    color_cfg_list->at(color_cfg_idx_).fps_idx = color_fps_idx_;
-                    camera_->EnableStream(color_cfg_list->at(color_cfg_idx_));
-                    if (state.contains("color_controls")) {
-                        for (auto &prop : *color_props) {
-                            if (state["color_controls"].contains(prop.first)) {
-                                prop.second.value = state["color_controls"][prop.first].get<int>();
-                                prop.second.has_changed = true;
-                                camera_->SetProperty(dai::CameraBoardSocket::RGB, prop.first);
-                            }
-                        }
-                        // Fix for Auto Enable Options
-                        for (auto &prop : *color_props) {
-                            if (prop.first == "Auto_Exposure") {
-                                if (state["color_controls"].contains(prop.first)) {
-                                    prop.second.value = state["color_controls"][prop.first].get<int>();
-                                    if ((bool)prop.second.value) {
-                                        camera_->SetProperty(dai::CameraBoardSocket::RGB, prop.first);
-                                    }
-                                    else {
-                                        camera_->SetProperty(dai::CameraBoardSocket::RGB, "Exposure");
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-                if (state.contains("depth_enabled"))
-                    enable_depth_ = state["depth_enabled"].get<bool>();
-                if (enable_depth_) {
-                    auto depth_cfg_list = camera_->GetStreamConfigList(dai::CameraBoardSocket::AUTO);
-                    auto depth_props = camera_->GetPropertyList(dai::CameraBoardSocket::AUTO);
-                    if (state.contains("depth_res_idx"))
-                        depth_cfg_idx_ = state["depth_res_idx"].get<int>();
-                    if (state.contains("depth_fps_idx"))
-                        depth_fps_idx_ = state["depth_fps_idx"].get<int>();
-                    if (state.contains("depth_fps"))
-                        depth_fps_ = state["depth_fps"].get<int>();
-                    depth_cfg_list->at(depth_cfg_idx_).fps_idx = depth_fps_idx_;
-                    if (state.contains("depth_controls")) {
-                        for (auto &prop : *depth_props) {
-                            if (state["depth_controls"].contains(prop.first)) {
-                                prop.second.value = state["depth_controls"][prop.first].get<int>();
-                                camera_->SetProperty(dai::CameraBoardSocket::AUTO, prop.first);
-                            }
-                        }
-                    }
-                    camera_->EnableStream(depth_cfg_list->at(depth_cfg_idx_));
-                }
-            }
-        }
-        if (!cam_exists)
-            selected_camera_idx_ = 0;
-    }
+    if (state.contains("color_enabled"))
+        enable_color_ = state["color_enabled"].get<bool>();
+    if (state.contains("depth_enabled"))
+        enable_depth_ = state["depth_enabled"].get<bool>();
+    if (state.contains("color_fps"))
+        color_fps_ = state["color_fps"].get<int>();
+    if (state.contains("depth_fps"))
+        depth_fps_ = state["depth_fps"].get<int>();
+    color_res_ = GetSavedResolution(state, "color_res", "color_res_idx", kLegacyColorRes, kDefaultColorRes);
+    depth_res_ = GetSavedResolution(state, "depth_res", "depth_res_idx", kLegacyDepthRes, kDefaultDepthRes);
+    color_cfg_idx_ = -1;
+    depth_cfg_idx_ = -1;
+
+    Post_([this, state](oak_camera &) {
+        pending_restore_ = state;
+        has_pending_restore_ = true;
+    });
 }
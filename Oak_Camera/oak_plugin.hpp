@@ -6,7 +6,11 @@
 #define FLOWCV_PLUGIN_OAK_PLUGIN_HPP_
 #include <DSPatch.h>
 #include "FlowCV_Types.hpp"
+#include <deque>
+#include <functional>
 #include "oak_camera.hpp"
+#include "command_queue.hpp"
+#include "device_registry.hpp"
 
 namespace DSPatch::DSPatchables
 {
@@ -19,6 +23,7 @@ class DLLEXPORT OakCamera final : public Component
 {
   public:
     OakCamera();
+    ~OakCamera() override;
     void UpdateGui(void *context, int interface) override;
     bool HasGui(int interface) override;
     std::string GetState() override;
@@ -28,9 +33,35 @@ class DLLEXPORT OakCamera final : public Component
     void Process_( SignalBus const& inputs, SignalBus& outputs ) override;
 
   private:
+    using CameraCommand = std::function<void(oak_camera &)>;
+    void Post_(CameraCommand &&cmd, const std::string &key = {});
+    void FlushCommands_();
+    void Attach_(const std::string &mxid);
+    void RestoreState_(const nlohmann::json &state);
+    void PostEnableStream_(const StreamConfig &config);
+    void PublishSnapshot_(bool force);
+    void PropertyControls_(std::vector<Property> &props, dai::CameraBoardSocket stream_type);
+
     std::unique_ptr<internal::OakCamera> p;
-    std::mutex io_mutex_;
-    std::unique_ptr<oak_camera> camera_;
+
+    // Device shared through the registry, or a private unopened one used to list devices
+    std::shared_ptr<shared_device> device_;
+    bool has_device_; // set once in the constructor, device_ itself is reassigned by Process_
+    int client_id_;
+    uint64_t frame_seq_;
+    std::string pending_attach_;
+    bool has_pending_attach_;
+    nlohmann::json pending_restore_;
+    bool has_pending_restore_;
+
+    // GUI / SetState post, Process_ applies, the camera itself is only touched from Process_
+    command_queue<CameraCommand, 256> commands_;
+    std::deque<std::pair<std::string, CameraCommand>> backlog_;
+    uint64_t posted_seq_;
+    uint64_t applied_seq_;
+    std::shared_ptr<const CameraSnapshot> snapshot_; // std::atomic_load / std::atomic_store only
+    std::chrono::steady_clock::time_point snapshot_time_;
+    CameraSnapshot gui_;
     int selected_camera_idx_;
     int color_cfg_idx_;
     int color_fps_idx_;
@@ -40,6 +71,12 @@ class DLLEXPORT OakCamera final : public Component
     int depth_fps_;
     bool enable_color_;
     bool enable_depth_;
+    std::string color_res_;
+    std::string depth_res_;
+    nlohmann::json saved_state_;
+    bool last_capture_in_;
+    bool last_extract_in_;
+    bool extract_requested_;
 
 };
 
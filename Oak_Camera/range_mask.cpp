@@ -0,0 +1,135 @@
+//
+// Oak Depth Range Mask
+//
+
+#include "range_mask.hpp"
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RANGE_MASK_SSE2
+#include <emmintrin.h>
+#endif
+
+range_mask::range_mask()
+{
+    near_mm_ = 300;
+    far_mm_ = 1500;
+    cleanup_ = 0;
+}
+
+void range_mask::SetRange(int near_mm, int far_mm)
+{
+    // Zero depth is invalid and must never fall inside the range
+    near_mm_ = std::clamp(near_mm, 1, 65534);
+    far_mm_ = std::clamp(far_mm, near_mm_, 65535);
+}
+
+int range_mask::GetNear() const
+{
+    return near_mm_;
+}
+
+int range_mask::GetFar() const
+{
+    return far_mm_;
+}
+
+void range_mask::SetCleanup(int radius)
+{
+    radius = std::clamp(radius, 0, 15);
+    if (radius == cleanup_)
+        return;
+
+    cleanup_ = radius;
+    kernel_.release();
+    if (cleanup_ > 0)
+        kernel_ = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(2 * cleanup_ + 1, 2 * cleanup_ + 1));
+}
+
+int range_mask::GetCleanup() const
+{
+    return cleanup_;
+}
+
+void range_mask::MaskRow_(const uint16_t *depth, uint8_t *mask, int width, uint16_t near_mm, uint16_t span)
+{
+    // Inside when depth - near <= far - near as unsigned, so values below near wrap around and fall out
+    int x = 0;
+#ifdef RANGE_MASK_SSE2
+    // SSE2 only compares signed 16 bit, flipping the sign bit orders unsigned values correctly
+    const __m128i flip = _mm_set1_epi16((short)0x8000);
+    const __m128i lo = _mm_set1_epi16((short)near_mm);
+    const __m128i hi = _mm_xor_si128(_mm_set1_epi16((short)span), flip);
+    for (; x + 16 <= width; x += 16) {
+        __m128i a = _mm_xor_si128(_mm_sub_epi16(_mm_loadu_si128((const __m128i *)(depth + x)), lo), flip);
+        __m128i b = _mm_xor_si128(_mm_sub_epi16(_mm_loadu_si128((const __m128i *)(depth + x + 8)), lo), flip);
+        // Outside lanes compare greater, inverting gives 0xFFFF inside which packs to 0xFF
+        __m128i out = _mm_packs_epi16(_mm_cmpgt_epi16(a, hi), _mm_cmpgt_epi16(b, hi));
+        _mm_storeu_si128((__m128i *)(mask + x), _mm_xor_si128(out, _mm_set1_epi8((char)0xFF)));
+    }
+#endif
+    for (; x < width; x++)
+        mask[x] = (uint16_t)(depth[x] - near_mm) <= span ? 255 : 0;
+}
+
+void range_mask::ApplyRow_(const uint8_t *color, const uint8_t *mask, uint8_t *masked, int width)
+{
+    // Three channel interleave has no cheap SSE2 shuffle, the byte loop is already memory bound
+    for (int x = 0; x < width; x++) {
+        uint8_t m = mask[x];
+        masked[3 * x] = color[3 * x] & m;
+        masked[3 * x + 1] = color[3 * x + 1] & m;
+        masked[3 * x + 2] = color[3 * x + 2] & m;
+    }
+}
+
+void range_mask::Cleanup_(cv::Mat &mask)
+{
+    // Open drops speckle outside the range, close fills pinholes in the foreground
+    cv::morphologyEx(mask, mask, cv::MORPH_OPEN, kernel_);
+    cv::morphologyEx(mask, mask, cv::MORPH_CLOSE, kernel_);
+}
+
+bool range_mask::Compute(const cv::Mat &depth, cv::Mat &mask)
+{
+    cv::Mat masked;
+    return Compute(depth, cv::Mat(), mask, masked);
+}
+
+bool range_mask::Compute(const cv::Mat &depth, const cv::Mat &color, cv::Mat &mask, cv::Mat &masked)
+{
+    if (depth.empty() || depth.type() != CV_16UC1)
+        return false;
+
+    // Fresh buffers every frame, downstream nodes may still hold the previous ones
+    const auto near_mm = (uint16_t)near_mm_;
+    const auto span = (uint16_t)(far_mm_ - near_mm_);
+    bool with_color = !color.empty() && color.type() == CV_8UC3 && color.size() == depth.size();
+    mask = cv::Mat(depth.size(), CV_8UC1);
+    if (with_color)
+        masked = cv::Mat(color.size(), CV_8UC3);
+    else
+        masked.release();
+
+    // Without cleanup the color is masked while the mask row is still in cache, otherwise after the morphology
+    bool fused = with_color && cleanup_ == 0;
+    cv::parallel_for_(cv::Range(0, depth.rows), [&](const cv::Range &range) {
+        for (int y = range.start; y < range.end; y++) {
+            MaskRow_(depth.ptr<uint16_t>(y), mask.ptr<uint8_t>(y), depth.cols, near_mm, span);
+            if (fused)
+                ApplyRow_(color.ptr<uint8_t>(y), mask.ptr<uint8_t>(y), masked.ptr<uint8_t>(y), depth.cols);
+        }
+    });
+
+    if (cleanup_ > 0) {
+        Cleanup_(mask);
+        if (with_color) {
+            cv::parallel_for_(cv::Range(0, depth.rows), [&](const cv::Range &range) {
+                for (int y = range.start; y < range.end; y++)
+                    ApplyRow_(color.ptr<uint8_t>(y), mask.ptr<uint8_t>(y), masked.ptr<uint8_t>(y), depth.cols);
+            });
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,39 @@
+//
+// Oak Depth Range Mask
+//
+// Turns a depth frame into a binary foreground mask for a near / far range
+// in a single pass, optionally cleaned up with a morphological open and
+// close. When the depth is aligned to the color frame the same pass also
+// writes the color frame with everything outside the range blacked out.
+//
+
+#ifndef FLOWCV_PLUGIN_RANGE_MASK_HPP_
+#define FLOWCV_PLUGIN_RANGE_MASK_HPP_
+#include "opencv2/opencv.hpp"
+
+class range_mask {
+  public:
+    range_mask();
+    void SetRange(int near_mm, int far_mm);
+    [[nodiscard]] int GetNear() const;
+    [[nodiscard]] int GetFar() const;
+    void SetCleanup(int radius);
+    [[nodiscard]] int GetCleanup() const;
+
+    // Depth is CV_16UC1 in mm, the mask CV_8UC1 with 255 inside the range. Outputs are always freshly
+    // allocated, color must be CV_8UC3 of the depth size to produce the masked frame
+    bool Compute(const cv::Mat &depth, cv::Mat &mask);
+    bool Compute(const cv::Mat &depth, const cv::Mat &color, cv::Mat &mask, cv::Mat &masked);
+
+  private:
+    static void MaskRow_(const uint16_t *depth, uint8_t *mask, int width, uint16_t near_mm, uint16_t span);
+    static void ApplyRow_(const uint8_t *color, const uint8_t *mask, uint8_t *masked, int width);
+    void Cleanup_(cv::Mat &mask);
+
+    int near_mm_;
+    int far_mm_;
+    int cleanup_;
+    cv::Mat kernel_;
+};
+
+#endif //FLOWCV_PLUGIN_RANGE_MASK_HPP_
@@ -0,0 +1,89 @@
+//
+// Oak Shared Memory Frame Ring Layout
+//
+// Shared by the publisher inside the plugin and the standalone reader library,
+// must stay free of OpenCV and DepthAI types so other processes can include it.
+//
+
+#ifndef FLOWCV_PLUGIN_SHM_FRAME_LAYOUT_HPP_
+#define FLOWCV_PLUGIN_SHM_FRAME_LAYOUT_HPP_
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#define OAK_SHM_MAGIC 0x314B414FU // "OAK1"
+#define OAK_SHM_VERSION 1
+#define OAK_SHM_SLOT_COUNT 3
+#define OAK_SHM_ALIGN 64
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared memory ring requires lock free 64 bit atomics");
+
+enum ShmStream
+{
+    ShmStream_Color = 0,
+    ShmStream_Depth,
+    ShmStream_Meta,
+    ShmStream_Count
+};
+
+// Description of one stream payload inside a slot, type uses OpenCV type codes and meta is UTF-8 JSON
+struct ShmFrameInfo
+{
+    uint64_t offset;
+    uint64_t size;
+    int32_t width;
+    int32_t height;
+    int32_t type;
+    int32_t step;
+    int64_t frame_num;
+    int64_t timestamp;
+};
+
+// Slot sequence works as a seqlock: odd while the writer fills the slot, 2 * publish count once complete
+struct ShmSlotHeader
+{
+    std::atomic<uint64_t> seq;
+    ShmFrameInfo frames[ShmStream_Count];
+};
+
+struct ShmRingHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t reserved;
+    uint64_t slot_size;
+    uint64_t capacity[ShmStream_Count];
+    std::atomic<uint64_t> latest;
+    std::atomic<uint32_t> closed;
+};
+
+// Raw payload handed to the publisher
+struct ShmFrameData
+{
+    const void *data;
+    size_t size;
+    int32_t width;
+    int32_t height;
+    int32_t type;
+    int32_t step;
+    int64_t frame_num;
+    int64_t timestamp;
+};
+
+inline uint64_t ShmAlign(uint64_t size)
+{
+    return (size + OAK_SHM_ALIGN - 1) & ~(uint64_t)(OAK_SHM_ALIGN - 1);
+}
+
+inline uint64_t ShmRingHeaderSize()
+{
+    return ShmAlign(sizeof(ShmRingHeader));
+}
+
+inline uint64_t ShmSlotHeaderSize()
+{
+    return ShmAlign(sizeof(ShmSlotHeader));
+}
+
+#endif //FLOWCV_PLUGIN_SHM_FRAME_LAYOUT_HPP_
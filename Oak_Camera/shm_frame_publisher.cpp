@@ -0,0 +1,187 @@
+//
+// Oak Shared Memory Frame Publisher
+//
+
+#include "shm_frame_publisher.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <new>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Metadata is small but variable, leave room so it rarely forces a new segment
+static constexpr uint64_t kMinMetaCapacity = 64 * 1024;
+
+shm_frame_publisher::shm_frame_publisher()
+{
+    base_ = nullptr;
+    map_size_ = 0;
+    count_ = 0;
+}
+
+shm_frame_publisher::~shm_frame_publisher()
+{
+    Close();
+}
+
+void shm_frame_publisher::SetName(const std::string &name)
+{
+    std::string shm_name = name;
+    if (!shm_name.empty() && shm_name[0] != '/')
+        shm_name.insert(shm_name.begin(), '/');
+
+    if (shm_name != name_) {
+        Close();
+        name_ = shm_name;
+    }
+}
+
+const std::string &shm_frame_publisher::GetName() const
+{
+    return name_;
+}
+
+bool shm_frame_publisher::IsOpen() const
+{
+    return base_ != nullptr;
+}
+
+uint64_t shm_frame_publisher::GetPublishCount() const
+{
+    return count_;
+}
+
+void shm_frame_publisher::Close()
+{
+#ifndef _WIN32
+    if (base_ != nullptr) {
+        // Tell mapped readers to let go, the name is removed so the memory is freed once they unmap
+        auto *hdr = (ShmRingHeader *)base_;
+        hdr->closed.store(1, std::memory_order_release);
+        munmap(base_, map_size_);
+        shm_unlink(name_.c_str());
+    }
+#endif
+    base_ = nullptr;
+    map_size_ = 0;
+}
+
+bool shm_frame_publisher::Create_(const uint64_t capacity[ShmStream_Count])
+{
+    Close();
+#ifdef _WIN32
+    std::cerr << "Oak shared memory publishing is not supported on this platform" << std::endl;
+    return false;
+#else
+    if (name_.empty())
+        return false;
+
+    uint64_t slot_size = ShmSlotHeaderSize();
+    for (int i = 0; i < ShmStream_Count; i++)
+        slot_size += ShmAlign(capacity[i]);
+    size_t total = ShmRingHeaderSize() + OAK_SHM_SLOT_COUNT * slot_size;
+
+    shm_unlink(name_.c_str());
+    int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+    if (fd < 0) {
+        std::cerr << "Unable to create Oak shared memory " << name_ << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    if (ftruncate(fd, (off_t)total) != 0) {
+        std::cerr << "Unable to size Oak shared memory " << name_ << ": " << strerror(errno) << std::endl;
+        close(fd);
+        shm_unlink(name_.c_str());
+        return false;
+    }
+    void *addr = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        std::cerr << "Unable to map Oak shared memory " << name_ << ": " << strerror(errno) << std::endl;
+        shm_unlink(name_.c_str());
+        return false;
+    }
+    base_ = (uint8_t *)addr;
+    map_size_ = total;
+
+    auto *hdr = new (base_) ShmRingHeader;
+    hdr->version = OAK_SHM_VERSION;
+    hdr->slot_count = OAK_SHM_SLOT_COUNT;
+    hdr->reserved = 0;
+    hdr->slot_size = slot_size;
+    for (int i = 0; i < ShmStream_Count; i++)
+        hdr->capacity[i] = capacity[i];
+    hdr->latest.store(0, std::memory_order_relaxed);
+    hdr->closed.store(0, std::memory_order_relaxed);
+
+    // Stream offsets never change for the lifetime of a segment
+    for (int s = 0; s < OAK_SHM_SLOT_COUNT; s++) {
+        auto *slot = new (base_ + ShmRingHeaderSize() + s * slot_size) ShmSlotHeader;
+        slot->seq.store(0, std::memory_order_relaxed);
+        uint64_t offset = ShmSlotHeaderSize();
+        for (int i = 0; i < ShmStream_Count; i++) {
+            std::memset(&slot->frames[i], 0, sizeof(ShmFrameInfo));
+            slot->frames[i].offset = offset;
+            offset += ShmAlign(capacity[i]);
+        }
+    }
+
+    // Readers only accept the segment once the magic is visible
+    std::atomic_thread_fence(std::memory_order_release);
+    hdr->magic = OAK_SHM_MAGIC;
+
+    return true;
+#endif
+}
+
+bool shm_frame_publisher::Publish(const ShmFrameData frames[ShmStream_Count])
+{
+    if (name_.empty())
+        return false;
+
+    // Grow the segment when a stream no longer fits, readers follow through the closed flag
+    bool fits = base_ != nullptr;
+    uint64_t capacity[ShmStream_Count];
+    for (int i = 0; i < ShmStream_Count; i++) {
+        capacity[i] = base_ != nullptr ? ((ShmRingHeader *)base_)->capacity[i] : 0;
+        if (frames[i].size > capacity[i]) {
+            fits = false;
+            // Only metadata that outgrew its room gets headroom, a segment grown for a frame keeps the meta capacity
+            capacity[i] = (i == ShmStream_Meta) ? frames[i].size * 2 : frames[i].size;
+        }
+    }
+    if (!fits) {
+        capacity[ShmStream_Meta] = std::max(capacity[ShmStream_Meta], kMinMetaCapacity);
+        if (!Create_(capacity))
+            return false;
+    }
+
+    auto *hdr = (ShmRingHeader *)base_;
+    uint64_t count = count_ + 1;
+    auto *slot = (ShmSlotHeader *)(base_ + ShmRingHeaderSize() + (count % hdr->slot_count) * hdr->slot_size);
+
+    slot->seq.store(count * 2 - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (int i = 0; i < ShmStream_Count; i++) {
+        ShmFrameInfo &info = slot->frames[i];
+        info.size = frames[i].size;
+        info.width = frames[i].width;
+        info.height = frames[i].height;
+        info.type = frames[i].type;
+        info.step = frames[i].step;
+        info.frame_num = frames[i].frame_num;
+        info.timestamp = frames[i].timestamp;
+        if (frames[i].size > 0)
+            std::memcpy((uint8_t *)slot + info.offset, frames[i].data, frames[i].size);
+    }
+    slot->seq.store(count * 2, std::memory_order_release);
+    hdr->latest.store(count, std::memory_order_release);
+    count_ = count;
+
+    return true;
+}
@@ -0,0 +1,32 @@
+//
+// Oak Shared Memory Frame Publisher
+//
+
+#ifndef FLOWCV_PLUGIN_SHM_FRAME_PUBLISHER_HPP_
+#define FLOWCV_PLUGIN_SHM_FRAME_PUBLISHER_HPP_
+#include <string>
+#include "shm_frame_layout.hpp"
+
+class shm_frame_publisher {
+  public:
+    shm_frame_publisher();
+    ~shm_frame_publisher();
+    shm_frame_publisher(const shm_frame_publisher &) = delete;
+    shm_frame_publisher &operator=(const shm_frame_publisher &) = delete;
+    void SetName(const std::string &name);
+    [[nodiscard]] const std::string &GetName() const;
+    void Close();
+    [[nodiscard]] bool IsOpen() const;
+    bool Publish(const ShmFrameData frames[ShmStream_Count]);
+    [[nodiscard]] uint64_t GetPublishCount() const;
+
+  private:
+    bool Create_(const uint64_t capacity[ShmStream_Count]);
+
+    std::string name_;
+    uint8_t *base_;
+    size_t map_size_;
+    uint64_t count_;
+};
+
+#endif //FLOWCV_PLUGIN_SHM_FRAME_PUBLISHER_HPP_
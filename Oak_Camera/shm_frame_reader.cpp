@@ -0,0 +1,140 @@
+//
+// Oak Shared Memory Frame Reader
+//
+
+#include "shm_frame_reader.hpp"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+shm_frame_reader::shm_frame_reader()
+{
+    base_ = nullptr;
+    map_size_ = 0;
+}
+
+shm_frame_reader::~shm_frame_reader()
+{
+    Close();
+}
+
+bool shm_frame_reader::Open(const std::string &name)
+{
+    Close();
+    name_ = name;
+    if (!name_.empty() && name_[0] != '/')
+        name_.insert(name_.begin(), '/');
+
+#ifdef _WIN32
+    return false;
+#else
+    int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < ShmRingHeaderSize()) {
+        close(fd);
+        return false;
+    }
+
+    void *addr = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+        return false;
+
+    base_ = (uint8_t *)addr;
+    map_size_ = (size_t)st.st_size;
+
+    // Reject segments that are still being created or belong to another layout version
+    auto *hdr = (const ShmRingHeader *)base_;
+    uint32_t magic = hdr->magic;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (magic != OAK_SHM_MAGIC || hdr->version != OAK_SHM_VERSION || hdr->slot_count == 0 ||
+        ShmRingHeaderSize() + hdr->slot_count * hdr->slot_size > map_size_) {
+        Close();
+        return false;
+    }
+
+    return true;
+#endif
+}
+
+void shm_frame_reader::Close()
+{
+#ifndef _WIN32
+    if (base_ != nullptr)
+        munmap(base_, map_size_);
+#endif
+    base_ = nullptr;
+    map_size_ = 0;
+}
+
+bool shm_frame_reader::IsOpen() const
+{
+    return base_ != nullptr;
+}
+
+uint64_t shm_frame_reader::GetLatestCount() const
+{
+    if (base_ == nullptr)
+        return 0;
+
+    return ((const ShmRingHeader *)base_)->latest.load(std::memory_order_acquire);
+}
+
+bool shm_frame_reader::AcquireLatest(ShmFrameView &view)
+{
+    if (base_ == nullptr && (name_.empty() || !Open(name_)))
+        return false;
+
+    // Writer replaced the segment (stream layout changed or plugin closed), follow it
+    auto *hdr = (const ShmRingHeader *)base_;
+    if (hdr->closed.load(std::memory_order_acquire) != 0) {
+        std::string name = name_;
+        if (!Open(name))
+            return false;
+        hdr = (const ShmRingHeader *)base_;
+    }
+
+    for (int attempt = 0; attempt < 4; attempt++) {
+        uint64_t count = hdr->latest.load(std::memory_order_acquire);
+        if (count == 0)
+            return false;
+
+        auto *slot = (const ShmSlotHeader *)(base_ + ShmRingHeaderSize() + (count % hdr->slot_count) * hdr->slot_size);
+        uint64_t seq = slot->seq.load(std::memory_order_acquire);
+        if (seq != count * 2)
+            continue;
+
+        view.count = count;
+        view.seq = seq;
+        view.slot = slot;
+        bool valid = true;
+        for (int i = 0; i < ShmStream_Count; i++) {
+            const ShmFrameInfo &info = slot->frames[i];
+            if (info.offset + info.size > hdr->slot_size) {
+                valid = false;
+                break;
+            }
+            view.info[i] = &info;
+            view.data[i] = info.size > 0 ? (const uint8_t *)slot + info.offset : nullptr;
+        }
+        if (valid && IsValid(view))
+            return true;
+    }
+
+    return false;
+}
+
+bool shm_frame_reader::IsValid(const ShmFrameView &view) const
+{
+    if (base_ == nullptr || view.slot == nullptr)
+        return false;
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return view.slot->seq.load(std::memory_order_relaxed) == view.seq;
+}
@@ -0,0 +1,42 @@
+//
+// Oak Shared Memory Frame Reader
+//
+// Maps the ring written by the Oak Camera plugin and exposes the newest frames in place.
+// A view stays usable until the writer wraps around to its slot, check IsValid() after
+// consuming the data and discard the result if it returns false.
+//
+
+#ifndef FLOWCV_PLUGIN_SHM_FRAME_READER_HPP_
+#define FLOWCV_PLUGIN_SHM_FRAME_READER_HPP_
+#include <string>
+#include "shm_frame_layout.hpp"
+
+struct ShmFrameView
+{
+    uint64_t count;
+    uint64_t seq;
+    const ShmSlotHeader *slot;
+    const ShmFrameInfo *info[ShmStream_Count];
+    const uint8_t *data[ShmStream_Count];
+};
+
+class shm_frame_reader {
+  public:
+    shm_frame_reader();
+    ~shm_frame_reader();
+    shm_frame_reader(const shm_frame_reader &) = delete;
+    shm_frame_reader &operator=(const shm_frame_reader &) = delete;
+    bool Open(const std::string &name);
+    void Close();
+    [[nodiscard]] bool IsOpen() const;
+    [[nodiscard]] uint64_t GetLatestCount() const;
+    bool AcquireLatest(ShmFrameView &view);
+    bool IsValid(const ShmFrameView &view) const;
+
+  private:
+    std::string name_;
+    uint8_t *base_;
+    size_t map_size_;
+};
+
+#endif //FLOWCV_PLUGIN_SHM_FRAME_READER_HPP_
@@ -0,0 +1,182 @@
+//
+// Oak Soak Monitor
+//
+
+#include "soak_monitor.hpp"
+#include <algorithm>
+#include <fstream>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#else
+#include <unistd.h>
+#endif
+
+static constexpr int kWindowMs = 10000;
+// Allocations settle during the first pipeline builds, growth is measured from the end of the warm up
+static constexpr int kWarmupMs = 60000;
+// One history sample a minute, four hours kept
+static constexpr int kHistoryMs = 60000;
+static constexpr size_t kHistorySize = 240;
+
+soak_monitor::soak_monitor()
+{
+    budget_.rss_growth_mb = 256.0;
+    budget_.latency_p99_ms = 250.0;
+    budget_.reconfigure_ms = 10000.0;
+    Reset();
+}
+
+void soak_monitor::Reset()
+{
+    stats_ = SoakStats();
+    start_ = std::chrono::steady_clock::now();
+    window_start_ = start_;
+    history_start_ = start_;
+    rss_baseline_mb_ = 0.0;
+    has_baseline_ = false;
+    latencies_.clear();
+    history_p99_ms_ = 0.0;
+    rss_history_.clear();
+    latency_history_.clear();
+}
+
+void soak_monitor::SetBudget(const SoakBudget &budget)
+{
+    budget_.rss_growth_mb = std::max(0.0, budget.rss_growth_mb);
+    budget_.latency_p99_ms = std::max(0.0, budget.latency_p99_ms);
+    budget_.reconfigure_ms = std::max(0.0, budget.reconfigure_ms);
+}
+
+const SoakBudget &soak_monitor::GetBudget() const
+{
+    return budget_;
+}
+
+void soak_monitor::AddFrameLatency(double latency_ms)
+{
+    latencies_.push_back(latency_ms);
+    stats_.frames++;
+    stats_.latency_max_ms = std::max(stats_.latency_max_ms, latency_ms);
+}
+
+void soak_monitor::AddReconfigure(double duration_ms)
+{
+    stats_.reconfigures++;
+    stats_.reconfigure_last_ms = duration_ms;
+    stats_.reconfigure_max_ms = std::max(stats_.reconfigure_max_ms, duration_ms);
+}
+
+void soak_monitor::AddPropertyChange()
+{
+    stats_.property_changes++;
+}
+
+double soak_monitor::Percentile_(double fraction)
+{
+    auto nth = latencies_.begin() + (ptrdiff_t)(fraction * (double)(latencies_.size() - 1));
+    std::nth_element(latencies_.begin(), nth, latencies_.end());
+    return *nth;
+}
+
+bool soak_monitor::Update()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (std::chrono::duration<double, std::milli>(now - window_start_).count() < kWindowMs)
+        return false;
+
+    double uptime_ms = std::chrono::duration<double, std::milli>(now - start_).count();
+    stats_.uptime_min = uptime_ms / 60000.0;
+    stats_.rss_mb = (double)GetResidentBytes() / (1024.0 * 1024.0);
+    if (!has_baseline_ && uptime_ms >= kWarmupMs) {
+        rss_baseline_mb_ = stats_.rss_mb;
+        has_baseline_ = true;
+    }
+    stats_.rss_growth_mb = has_baseline_ ? stats_.rss_mb - rss_baseline_mb_ : 0.0;
+
+    // Windows without frames keep the last percentiles, an idle stream is not a latency spike
+    if (!latencies_.empty()) {
+        stats_.latency_p50_ms = Percentile_(0.5);
+        stats_.latency_p95_ms = Percentile_(0.95);
+        stats_.latency_p99_ms = Percentile_(0.99);
+        history_p99_ms_ = std::max(history_p99_ms_, stats_.latency_p99_ms);
+    }
+
+    // Violations latch until Reset() so a single exceeded window is not lost over a long run
+    if (budget_.rss_growth_mb > 0.0 && stats_.rss_growth_mb > budget_.rss_growth_mb)
+        stats_.violations |= Violation_RssGrowth;
+    if (budget_.latency_p99_ms > 0.0 && !latencies_.empty() && stats_.latency_p99_ms > budget_.latency_p99_ms)
+        stats_.violations |= Violation_Latency;
+    if (budget_.reconfigure_ms > 0.0 && stats_.reconfigure_max_ms > budget_.reconfigure_ms)
+        stats_.violations |= Violation_Reconfigure;
+
+    if (std::chrono::duration<double, std::milli>(now - history_start_).count() >= kHistoryMs) {
+        if (rss_history_.size() >= kHistorySize) {
+            rss_history_.erase(rss_history_.begin());
+            latency_history_.erase(latency_history_.begin());
+        }
+        rss_history_.push_back((float)stats_.rss_mb);
+        latency_history_.push_back((float)history_p99_ms_);
+        history_p99_ms_ = 0.0;
+        history_start_ = now;
+    }
+
+    latencies_.clear();
+    window_start_ = now;
+
+    return true;
+}
+
+const SoakStats &soak_monitor::GetStats() const
+{
+    return stats_;
+}
+
+const std::vector<float> &soak_monitor::GetRssHistory() const
+{
+    return rss_history_;
+}
+
+const std::vector<float> &soak_monitor::GetLatencyHistory() const
+{
+    return latency_history_;
+}
+
+std::vector<std::string> soak_monitor::GetViolationNames(uint32_t violations)
+{
+    std::vector<std::string> names;
+    if (violations & Violation_RssGrowth)
+        names.emplace_back("rss_growth");
+    if (violations & Violation_Latency)
+        names.emplace_back("latency_p99");
+    if (violations & Violation_Reconfigure)
+        names.emplace_back("reconfigure");
+
+    return names;
+}
+
+size_t soak_monitor::GetResidentBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.WorkingSetSize;
+    return 0;
+#elif defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) == KERN_SUCCESS)
+        return info.resident_size;
+    return 0;
+#else
+    // Second field of statm is the resident set in pages
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    if (statm >> pages >> resident)
+        return resident * (size_t)sysconf(_SC_PAGESIZE);
+    return 0;
+#endif
+}
@@ -0,0 +1,83 @@
+//
+// Oak Soak Monitor
+//
+// Long running stability statistics: process resident memory, capture to
+// output latency percentiles of the full resolution frames and pipeline
+// rebuild times, summarized over short windows and kept as a coarse history
+// so drift over hours of streaming and reconfiguration becomes visible.
+// Budgets are checked at the end of every window.
+//
+
+#ifndef FLOWCV_PLUGIN_SOAK_MONITOR_HPP_
+#define FLOWCV_PLUGIN_SOAK_MONITOR_HPP_
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Zero disables a budget
+struct SoakBudget {
+    double rss_growth_mb;
+    double latency_p99_ms;
+    double reconfigure_ms;
+};
+
+struct SoakStats {
+    double uptime_min;
+    double rss_mb;
+    double rss_growth_mb;
+    double latency_p50_ms;
+    double latency_p95_ms;
+    double latency_p99_ms;
+    double latency_max_ms;
+    uint64_t frames;
+    uint64_t reconfigures;
+    double reconfigure_last_ms;
+    double reconfigure_max_ms;
+    uint64_t property_changes;
+    uint32_t violations;
+};
+
+class soak_monitor {
+  public:
+    enum Violation {
+        Violation_RssGrowth = 1,
+        Violation_Latency = 2,
+        Violation_Reconfigure = 4
+    };
+
+    soak_monitor();
+    void Reset();
+    void SetBudget(const SoakBudget &budget);
+    [[nodiscard]] const SoakBudget &GetBudget() const;
+    void AddFrameLatency(double latency_ms);
+    void AddReconfigure(double duration_ms);
+    void AddPropertyChange();
+
+    // Closes the window once it has run its length, returns true when it did
+    bool Update();
+    [[nodiscard]] const SoakStats &GetStats() const;
+    [[nodiscard]] const std::vector<float> &GetRssHistory() const;
+    [[nodiscard]] const std::vector<float> &GetLatencyHistory() const;
+    static std::vector<std::string> GetViolationNames(uint32_t violations);
+    static size_t GetResidentBytes();
+
+  private:
+    double Percentile_(double fraction);
+
+    SoakBudget budget_;
+    SoakStats stats_;
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::steady_clock::time_point window_start_;
+    std::chrono::steady_clock::time_point history_start_;
+    double rss_baseline_mb_;
+    bool has_baseline_;
+    std::vector<double> latencies_;
+    double history_p99_ms_;
+
+    // One sample per history interval, oldest first
+    std::vector<float> rss_history_;
+    std::vector<float> latency_history_;
+};
+
+#endif //FLOWCV_PLUGIN_SOAK_MONITOR_HPP_
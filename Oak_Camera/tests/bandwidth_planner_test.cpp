@@ -0,0 +1,124 @@
+//
+// Oak USB Bandwidth Planner Test
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "bandwidth_planner.hpp"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                                       \
+    do {                                                                                  \
+        if (!(cond)) {                                                                    \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                                   \
+        }                                                                                 \
+    } while (0)
+
+// Usable MB/s of a high speed and a super speed link
+static constexpr double kHighSpeed = 35.0;
+static constexpr double kSuperSpeed = 330.0;
+
+static std::vector<BandwidthMode> ColorModes()
+{
+    return {{3840, 2160, {30, 25, 15, 10, 5}}, {1920, 1080, {60, 30, 25, 15, 10, 5}}, {1280, 720, {60, 30, 15, 5}}};
+}
+
+static std::vector<BandwidthMode> DepthModes()
+{
+    return {{1280, 800, {60, 30, 15, 5}}, {640, 400, {120, 60, 30, 15, 5}}};
+}
+
+static void TestFits()
+{
+    // 1080p NV12 at 30 fps is about 89 MB/s
+    std::vector<BandwidthStream> streams = {{"rgb", 1.5f, ColorModes(), 1, 1, -1, -1}};
+    CHECK(bandwidth_planner::GetFps(streams, 0) == 30);
+    CHECK(bandwidth_planner::Fits(streams, kSuperSpeed));
+    CHECK(!bandwidth_planner::Fits(streams, kHighSpeed));
+    CHECK(bandwidth_planner::Fits(streams, 0.0));
+
+    // Configured but not sent streams cost nothing
+    streams[0].bytes_per_pixel = 0.0f;
+    CHECK(bandwidth_planner::GetRequiredRate(streams) == 0.0);
+    CHECK(bandwidth_planner::Fits(streams, kHighSpeed));
+}
+
+static void TestStepDownResolutionFirst()
+{
+    // At 30 fps or less the resolution goes first and the frame rate is kept, 4K NV12 at 30 fps is about 356 MB/s
+    std::vector<BandwidthStream> streams = {{"rgb", 1.5f, ColorModes(), 0, 0, -1, -1}};
+    CHECK(bandwidth_planner::StepDown(streams, kSuperSpeed));
+    CHECK(bandwidth_planner::Fits(streams, kSuperSpeed));
+    CHECK(streams[0].mode_idx == 1);
+    CHECK(bandwidth_planner::GetFps(streams, 0) == 30);
+
+    CHECK(bandwidth_planner::StepDown(streams, kHighSpeed));
+    CHECK(bandwidth_planner::Fits(streams, kHighSpeed));
+    CHECK(bandwidth_planner::GetWidth(streams, 0) == 1280);
+    CHECK(bandwidth_planner::GetFps(streams, 0) == 15);
+}
+
+static void TestStepDownFpsFirst()
+{
+    // Above 30 fps the frame rate goes first
+    std::vector<BandwidthStream> streams = {{"depth", 2.0f, DepthModes(), 0, 0, -1, -1}};
+    double rate = bandwidth_planner::GetRequiredRate(streams);
+    CHECK(bandwidth_planner::StepDown(streams, rate * 0.75));
+    CHECK(streams[0].mode_idx == 0);
+    CHECK(bandwidth_planner::GetFps(streams, 0) == 30);
+}
+
+static void TestSharedSize()
+{
+    // Depth aligned on device comes out at the color size, stepping it has to step the color mode
+    std::vector<BandwidthStream> streams = {{"rgb", 0.0f, ColorModes(), 1, 1, -1, -1},
+                                            {"depth", 2.0f, DepthModes(), 0, 1, 0, -1}};
+    CHECK(bandwidth_planner::GetWidth(streams, 1) == 1920);
+    CHECK(bandwidth_planner::StepDown(streams, kHighSpeed));
+    CHECK(bandwidth_planner::Fits(streams, kHighSpeed));
+    CHECK(streams[0].mode_idx == 2);
+    CHECK(streams[1].mode_idx == 0);
+    CHECK(bandwidth_planner::GetWidth(streams, 1) == 1280);
+}
+
+static void TestSharedFps()
+{
+    // A preview shares the color frame rate, its own size never changes
+    std::vector<BandwidthStream> streams = {{"rgb", 0.0f, ColorModes(), 1, 0, -1, -1},
+                                            {"preview", 3.0f, {{640, 360, {0}}}, 0, 0, -1, 0}};
+    CHECK(bandwidth_planner::GetFps(streams, 1) == 60);
+    double rate = bandwidth_planner::GetRequiredRate(streams);
+    CHECK(bandwidth_planner::StepDown(streams, rate / 3.0));
+    CHECK(bandwidth_planner::GetFps(streams, 1) <= 20);
+    CHECK(streams[1].mode_idx == 0);
+}
+
+static void TestImpossible()
+{
+    std::vector<BandwidthStream> streams = {{"depth", 2.0f, DepthModes(), 0, 0, -1, -1}};
+    CHECK(!bandwidth_planner::StepDown(streams, 0.1));
+    // Everything was tried before giving up
+    CHECK(streams[0].mode_idx == 1);
+    CHECK(bandwidth_planner::GetFps(streams, 0) == 5);
+}
+
+int main()
+{
+    TestFits();
+    TestStepDownResolutionFirst();
+    TestStepDownFpsFirst();
+    TestSharedSize();
+    TestSharedFps();
+    TestImpossible();
+
+    if (failures > 0) {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    std::printf("bandwidth_planner: all checks passed\n");
+
+    return EXIT_SUCCESS;
+}
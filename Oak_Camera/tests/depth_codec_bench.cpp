@@ -0,0 +1,128 @@
+//
+// Oak Depth Codec Benchmark
+//
+// Compares RVL against cv::imencode PNG on synthetic depth and on recorded 16 bit
+// depth images given on the command line. Reports encode and decode MB/s of raw
+// depth and the compression ratio, and fails when a round trip is not lossless.
+//
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+#include "opencv2/opencv.hpp"
+#include "depth_codec.hpp"
+
+static constexpr int kRepeats = 20;
+
+struct Sample {
+    std::string name;
+    cv::Mat depth;
+};
+
+// Tilted floor and a few spheres in mm, with sensor noise, invalid pixels at depth edges and a dropout patch
+static cv::Mat MakeSyntheticDepth(int width, int height, uint32_t seed)
+{
+    cv::RNG rng(seed);
+    cv::Mat depth(height, width, CV_16UC1);
+    const float fx = 0.8f * (float)width;
+    const cv::Point3f spheres[] = {{-300.0f, 0.0f, 1200.0f}, {250.0f, -100.0f, 1800.0f}, {0.0f, 200.0f, 900.0f}};
+    const float radius[] = {250.0f, 400.0f, 150.0f};
+    for (int y = 0; y < height; y++) {
+        auto *row = depth.ptr<uint16_t>(y);
+        for (int x = 0; x < width; x++) {
+            cv::Point3f ray((x - width * 0.5f) / fx, (y - height * 0.5f) / fx, 1.0f);
+            float z = (ray.y > 0.05f) ? 500.0f / ray.y : 6000.0f;
+            bool edge = false;
+            for (int s = 0; s < 3; s++) {
+                // Ray sphere intersection, the first hit in front of the current surface wins
+                float b = ray.dot(spheres[s]) / ray.dot(ray);
+                cv::Point3f closest = ray * b - spheres[s];
+                float d2 = radius[s] * radius[s] - closest.dot(closest);
+                if (d2 >= 0.0f) {
+                    float t = b - std::sqrt(d2 / ray.dot(ray));
+                    if (t < z) {
+                        z = t;
+                        edge = d2 < 0.05f * radius[s] * radius[s];
+                    }
+                }
+            }
+            z += (float)rng.gaussian(z * z * 2e-6);
+            row[x] = (edge || z <= 0.0f || z > 10000.0f) ? 0 : (uint16_t)z;
+        }
+    }
+    depth(cv::Rect(width / 8, height / 2, width / 10, height / 6)).setTo(0);
+
+    return depth;
+}
+
+static double TimeMs(const std::function<void()> &fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kRepeats; i++)
+        fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / kRepeats;
+}
+
+static void Report(const char *codec, const Sample &sample, size_t encoded, double encode_ms, double decode_ms)
+{
+    double raw_mb = (double)(sample.depth.total() * sample.depth.elemSize()) / 1e6;
+    std::printf("%-24s %-6s ratio %5.2f  encode %7.1f MB/s  decode %7.1f MB/s\n", sample.name.c_str(), codec,
+                raw_mb * 1e6 / (double)encoded, raw_mb / (encode_ms / 1000.0), raw_mb / (decode_ms / 1000.0));
+}
+
+static bool Run(const Sample &sample)
+{
+    const cv::Mat &depth = sample.depth;
+    bool ok = true;
+
+    std::vector<uint8_t> rvl;
+    double encode_ms = TimeMs([&] { depth_codec::Encode(depth.ptr<uint16_t>(), depth.cols, depth.rows, depth.step, rvl); });
+    cv::Mat decoded(depth.size(), CV_16UC1);
+    double decode_ms = TimeMs([&] { depth_codec::Decode(rvl.data(), rvl.size(), decoded.ptr<uint16_t>(), decoded.step); });
+    Report("rvl", sample, rvl.size(), encode_ms, decode_ms);
+    if (cv::norm(depth, decoded, cv::NORM_INF) != 0.0) {
+        std::fprintf(stderr, "FAIL: %s rvl round trip is not lossless\n", sample.name.c_str());
+        ok = false;
+    }
+
+    for (int level : {1, 3}) {
+        std::vector<uint8_t> png;
+        std::vector<int> params = {cv::IMWRITE_PNG_COMPRESSION, level};
+        encode_ms = TimeMs([&] { cv::imencode(".png", depth, png, params); });
+        decode_ms = TimeMs([&] { decoded = cv::imdecode(png, cv::IMREAD_ANYDEPTH); });
+        std::string codec = "png-" + std::to_string(level);
+        Report(codec.c_str(), sample, png.size(), encode_ms, decode_ms);
+        if (decoded.type() != CV_16UC1 || cv::norm(depth, decoded, cv::NORM_INF) != 0.0) {
+            std::fprintf(stderr, "FAIL: %s png round trip is not lossless\n", sample.name.c_str());
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<Sample> samples;
+    samples.push_back({"synthetic 1280x720", MakeSyntheticDepth(1280, 720, 1)});
+    samples.push_back({"synthetic 640x400", MakeSyntheticDepth(640, 400, 2)});
+    // Recorded depth, 16 bit single channel images such as PNGs saved from the depth output
+    for (int i = 1; i < argc; i++) {
+        cv::Mat depth = cv::imread(argv[i], cv::IMREAD_ANYDEPTH);
+        if (depth.empty() || depth.type() != CV_16UC1) {
+            std::fprintf(stderr, "Skipping %s, not a 16 bit single channel image\n", argv[i]);
+            continue;
+        }
+        samples.push_back({argv[i], depth});
+    }
+
+    bool ok = true;
+    for (const auto &sample : samples)
+        ok &= Run(sample);
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,462 @@
+//
+// Oak Camera Soak Harness
+//
+// Runs oak_camera against a fake frame source, without a device, through
+// randomized stream and property changes. Records resident memory, heap
+// allocations, frame latency percentiles and pipeline rebuild times, prints
+// them for every 10 s window after the warm up, checks the budgets per window
+// and returns non-zero when a budget was exceeded in any window.
+//
+// oak_soak [seconds] [seed] [rss growth MB] [p99 ms] [reconfigure ms] [live allocation growth]
+//
+// A budget of 0 disables it. Calibration dependent outputs and the on-device
+// features (spatial, features, gate, stills) do not run against the fake source.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <random>
+#include <thread>
+#include <vector>
+#include "oak_camera.hpp"
+
+// Every heap allocation of the process, the libraries included
+static std::atomic<uint64_t> total_allocs{0};
+static std::atomic<int64_t> live_allocs{0};
+
+void *operator new(std::size_t size)
+{
+    void *p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    total_allocs++;
+    live_allocs++;
+
+    return p;
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    if (p == nullptr)
+        return;
+    live_allocs--;
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr double kWarmupSeconds = 5.0;
+static constexpr double kWindowSeconds = 10.0;
+static constexpr int kChangeIntervalMs = 1000;
+static constexpr int kDefaultQueueDepth = 4;
+
+// Produces frames at the stream rates on demand, frames a slow consumer did not take in time
+// are dropped oldest first like on the non-blocking device queues
+class fake_frame_source : public frame_source {
+  public:
+    void Start(const std::vector<FrameStreamInfo> &streams) override
+    {
+        streams_.clear();
+        auto now = Clock::now();
+        for (const auto &info : streams) {
+            Stream &s = streams_[info.name];
+            s.info = info;
+            s.start = now;
+            s.period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / std::max(info.fps, 1)));
+            s.seq = 0;
+            s.depth = kDefaultQueueDepth;
+            s.data = MakeImage_(info);
+        }
+    }
+
+    bool Wait(const std::vector<std::string> &names, std::chrono::milliseconds timeout) override
+    {
+        auto due = Clock::time_point::max();
+        for (const auto &name : names) {
+            auto it = streams_.find(name);
+            if (it != streams_.end())
+                due = std::min(due, NextDue_(it->second));
+        }
+        if (due > Clock::now() + timeout) {
+            std::this_thread::sleep_for(timeout);
+            return false;
+        }
+        std::this_thread::sleep_until(due);
+
+        return true;
+    }
+
+    std::vector<std::shared_ptr<dai::ImgFrame>> TryGetAll(const std::string &name) override
+    {
+        std::vector<std::shared_ptr<dai::ImgFrame>> frames;
+        auto it = streams_.find(name);
+        if (it == streams_.end())
+            return frames;
+
+        Stream &s = it->second;
+        auto now = Clock::now();
+        int64_t due = 0;
+        while (NextDue_(s) <= now) {
+            s.seq++;
+            due++;
+        }
+        int64_t kept = std::min<int64_t>(due, s.depth);
+        dropped_ += due - kept;
+        for (int64_t seq = s.seq - kept + 1; seq <= s.seq; seq++) {
+            auto frame = std::make_shared<dai::ImgFrame>();
+            frame->setData(s.data);
+            frame->setWidth(s.info.width);
+            frame->setHeight(s.info.height);
+            frame->setType(s.info.type);
+            frame->setSequenceNum(seq);
+            frame->setTimestamp(s.start + s.period * seq);
+            frames.emplace_back(std::move(frame));
+        }
+        if (kept > 0)
+            handed_out_.push_back(s.start + s.period * s.seq);
+
+        return frames;
+    }
+
+    void SetQueueDepth(const std::string &name, int depth) override
+    {
+        auto it = streams_.find(name);
+        if (it != streams_.end())
+            it->second.depth = std::max(depth, 1);
+    }
+
+    void SendControl(const dai::CameraControl &) override
+    {
+        controls_++;
+    }
+
+    void SendStereoConfig(const dai::StereoDepthConfig &) override
+    {
+        stereo_configs_++;
+    }
+
+    // Capture times of the newest frame of every batch handed out since the last call
+    void TakeHandedOut(std::vector<Clock::time_point> &out)
+    {
+        out.swap(handed_out_);
+        handed_out_.clear();
+    }
+
+    [[nodiscard]] uint64_t GetControls() const { return controls_; }
+    [[nodiscard]] uint64_t GetStereoConfigs() const { return stereo_configs_; }
+    [[nodiscard]] uint64_t GetDropped() const { return dropped_; }
+
+  private:
+    struct Stream {
+        FrameStreamInfo info;
+        Clock::time_point start;
+        Clock::duration period;
+        int64_t seq;
+        int depth;
+        std::vector<uint8_t> data;
+    };
+
+    static Clock::time_point NextDue_(const Stream &s)
+    {
+        return s.start + s.period * (s.seq + 1);
+    }
+
+    // Gradients, depth as a tilted plane from 0.5 to 4.5 m
+    static std::vector<uint8_t> MakeImage_(const FrameStreamInfo &info)
+    {
+        std::vector<uint8_t> data;
+        size_t pixels = (size_t)info.width * info.height;
+        if (info.type == dai::ImgFrame::Type::NV12) {
+            data.assign(pixels * 3 / 2, 128);
+            for (size_t i = 0; i < pixels; i++)
+                data[i] = (uint8_t)((i % info.width) * 255 / std::max(info.width - 1, 1));
+        }
+        else if (info.type == dai::ImgFrame::Type::RAW16) {
+            data.resize(pixels * 2);
+            for (size_t i = 0; i < pixels; i++) {
+                auto mm = (uint16_t)(500 + (i % info.width) * 4000 / std::max(info.width - 1, 1));
+                data[i * 2] = (uint8_t)(mm & 0xff);
+                data[i * 2 + 1] = (uint8_t)(mm >> 8);
+            }
+        }
+        else {
+            data.resize(pixels * 3);
+            for (size_t i = 0; i < pixels; i++) {
+                data[i * 3] = (uint8_t)(i % info.width);
+                data[i * 3 + 1] = (uint8_t)(i / info.width);
+                data[i * 3 + 2] = 128;
+            }
+        }
+
+        return data;
+    }
+
+    std::map<std::string, Stream> streams_;
+    std::vector<Clock::time_point> handed_out_;
+    uint64_t controls_ = 0;
+    uint64_t stereo_configs_ = 0;
+    uint64_t dropped_ = 0;
+};
+
+static double Percentile(std::vector<double> values, double fraction)
+{
+    if (values.empty())
+        return 0.0;
+    std::sort(values.begin(), values.end());
+
+    return values[std::min(values.size() - 1, (size_t)(fraction * (double)values.size()))];
+}
+
+static double Argument(int argc, char **argv, int index, double def)
+{
+    return (argc > index) ? std::atof(argv[index]) : def;
+}
+
+// Picks a random mode and rate of the stream and enables it
+static void EnableRandom(oak_camera &camera, dai::CameraBoardSocket stream, std::mt19937 &rng)
+{
+    auto configs = *camera.GetStreamConfigList(stream);
+    if (configs.empty())
+        return;
+    StreamConfig cfg = configs[std::uniform_int_distribution<size_t>(0, configs.size() - 1)(rng)];
+    cfg.fps_idx = (int)std::uniform_int_distribution<size_t>(0, cfg.fps_list.size() - 1)(rng);
+    std::printf("  enable %s %s @ %d fps\n", (stream == dai::CameraBoardSocket::RGB) ? "color" : "depth",
+                cfg.str_resolution.c_str(), cfg.fps_list[cfg.fps_idx]);
+    camera.EnableStream(cfg);
+}
+
+static void SetRandomProperty(oak_camera &camera, std::mt19937 &rng)
+{
+    auto stream = (rng() & 1) ? dai::CameraBoardSocket::RGB : dai::CameraBoardSocket::AUTO;
+    auto *props = camera.GetPropertyList(stream);
+    if (props == nullptr || props->empty())
+        return;
+    int idx = (int)std::uniform_int_distribution<size_t>(0, props->size() - 1)(rng);
+    const Property &prop = props->at(idx);
+    int max = prop.is_list ? (int)prop.opt_list.size() - 1 : prop.range.max;
+    int min = prop.is_list ? 0 : prop.range.min;
+    camera.SetPropertyValue(stream, idx, std::uniform_int_distribution<int>(min, std::max(min, max))(rng));
+}
+
+struct Budgets {
+    double rss_growth_mb;
+    double p99_ms;
+    double reconfigure_ms;
+    double live_alloc_growth;
+};
+
+// Measurements of one window, memory growth is counted from the end of the warm up
+struct Window {
+    Clock::time_point start;
+    std::vector<double> latencies;
+    std::vector<double> reconfigures;
+    uint64_t allocs = 0;
+    uint64_t ticks = 0;
+};
+
+// Prints the window row and returns the number of budgets it exceeded
+static int ReportWindow(int index, double elapsed, const Window &window, double rss_growth_mb, int64_t live_growth,
+                        const Budgets &budgets)
+{
+    const double p50 = Percentile(window.latencies, 0.50);
+    const double p95 = Percentile(window.latencies, 0.95);
+    const double p99 = Percentile(window.latencies, 0.99);
+    const double reconfigure_max = window.reconfigures.empty() ? 0.0 : *std::max_element(window.reconfigures.begin(), window.reconfigures.end());
+    const double allocs_per_tick = (double)window.allocs / (double)std::max<uint64_t>(window.ticks, 1);
+    std::printf("%6d %6.0f %8.1f %8.1f %10.1f %8lld %7zu %7.1f %7.1f %7.1f %8zu %8.1f\n", index, elapsed,
+                (double)soak_monitor::GetResidentBytes() / (1024.0 * 1024.0), rss_growth_mb, allocs_per_tick, (long long)live_growth,
+                window.latencies.size(), p50, p95, p99, window.reconfigures.size(), reconfigure_max);
+
+    int failures = 0;
+    if (window.latencies.empty()) {
+        std::fprintf(stderr, "window %d: no frames processed\n", index);
+        failures++;
+    }
+    if (budgets.rss_growth_mb > 0.0 && rss_growth_mb > budgets.rss_growth_mb) {
+        std::fprintf(stderr, "window %d: rss growth %.1f MB over the %.1f MB budget\n", index, rss_growth_mb, budgets.rss_growth_mb);
+        failures++;
+    }
+    if (budgets.p99_ms > 0.0 && p99 > budgets.p99_ms) {
+        std::fprintf(stderr, "window %d: latency p99 %.1f ms over the %.1f ms budget\n", index, p99, budgets.p99_ms);
+        failures++;
+    }
+    if (budgets.reconfigure_ms > 0.0 && reconfigure_max > budgets.reconfigure_ms) {
+        std::fprintf(stderr, "window %d: rebuild %.1f ms over the %.1f ms budget\n", index, reconfigure_max, budgets.reconfigure_ms);
+        failures++;
+    }
+    if (budgets.live_alloc_growth > 0.0 && (double)live_growth > budgets.live_alloc_growth) {
+        std::fprintf(stderr, "window %d: %lld live allocations gained, over the budget of %.0f\n", index, (long long)live_growth,
+                     budgets.live_alloc_growth);
+        failures++;
+    }
+
+    return failures;
+}
+
+int main(int argc, char **argv)
+{
+    const double seconds = Argument(argc, argv, 1, 60.0);
+    const auto seed = (unsigned)Argument(argc, argv, 2, 1.0);
+    Budgets budgets{};
+    budgets.rss_growth_mb = Argument(argc, argv, 3, 64.0);
+    budgets.p99_ms = Argument(argc, argv, 4, 100.0);
+    budgets.reconfigure_ms = Argument(argc, argv, 5, 50.0);
+    budgets.live_alloc_growth = Argument(argc, argv, 6, 20000.0);
+
+    std::mt19937 rng(seed);
+    auto source = std::make_shared<fake_frame_source>();
+    auto camera = std::make_unique<oak_camera>();
+    camera->SetFrameSource(source);
+    EnableRandom(*camera, dai::CameraBoardSocket::RGB, rng);
+    EnableRandom(*camera, dai::CameraBoardSocket::AUTO, rng);
+
+    Window window;
+    std::vector<double> latencies;
+    std::vector<double> reconfigures;
+    std::vector<Clock::time_point> handed_out;
+    window.latencies.reserve(1 << 14);
+    window.reconfigures.reserve(64);
+    latencies.reserve(1 << 16);
+    reconfigures.reserve(1024);
+    handed_out.reserve(64);
+    uint64_t rebuilds = 0;
+    uint64_t ticks = 0;
+    uint64_t changes = 0;
+    size_t rss_baseline = 0;
+    int64_t live_baseline = 0;
+    uint64_t allocs_window = 0;
+    bool warm = false;
+    int windows = 0;
+    int failures = 0;
+
+    const auto start = Clock::now();
+    const auto warmup = std::chrono::duration<double>(std::min(kWarmupSeconds, seconds * 0.25));
+    const auto end_window = [&](Clock::time_point now) {
+        window.allocs = total_allocs - allocs_window;
+        failures += ReportWindow(++windows, std::chrono::duration<double>(now - start).count(), window,
+                                 ((double)soak_monitor::GetResidentBytes() - (double)rss_baseline) / (1024.0 * 1024.0),
+                                 live_allocs - live_baseline, budgets);
+        latencies.insert(latencies.end(), window.latencies.begin(), window.latencies.end());
+        reconfigures.insert(reconfigures.end(), window.reconfigures.begin(), window.reconfigures.end());
+        window.latencies.clear();
+        window.reconfigures.clear();
+        window.ticks = 0;
+        window.start = now;
+        allocs_window = total_allocs;
+    };
+
+    auto next_change = start + std::chrono::milliseconds(kChangeIntervalMs);
+    while (Clock::now() - start < std::chrono::duration<double>(seconds)) {
+        auto now = Clock::now();
+        if (now >= next_change) {
+            next_change = now + std::chrono::milliseconds(kChangeIntervalMs);
+            changes++;
+            switch (std::uniform_int_distribution<int>(0, 5)(rng)) {
+                case 0:
+                    EnableRandom(*camera, dai::CameraBoardSocket::RGB, rng);
+                    break;
+                case 1:
+                    EnableRandom(*camera, dai::CameraBoardSocket::AUTO, rng);
+                    break;
+                case 2:
+                    std::printf("  disable color\n");
+                    camera->DisableStream(dai::CameraBoardSocket::RGB);
+                    break;
+                case 3:
+                    std::printf("  disable depth\n");
+                    camera->DisableStream(dai::CameraBoardSocket::AUTO);
+                    break;
+                default:
+                    for (int i = (int)(rng() % 3); i >= 0; i--)
+                        SetRandomProperty(*camera, rng);
+                    break;
+            }
+        }
+
+        auto tick_start = Clock::now();
+        camera->ProcessStreams();
+        auto tick_end = Clock::now();
+        ticks++;
+        window.ticks++;
+        // Nothing enabled, nothing to wait on
+        if (tick_end - tick_start < std::chrono::milliseconds(1))
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+        source->TakeHandedOut(handed_out);
+        for (const auto &captured : handed_out)
+            window.latencies.push_back(std::chrono::duration<double, std::milli>(tick_end - captured).count());
+
+        auto snap = camera->MakeSnapshot();
+        if (snap->soak_stats.reconfigures != rebuilds) {
+            rebuilds = snap->soak_stats.reconfigures;
+            window.reconfigures.push_back(snap->soak_stats.reconfigure_last_ms);
+        }
+        snap.reset();
+
+        if (!warm && tick_end - start >= warmup) {
+            warm = true;
+            rss_baseline = soak_monitor::GetResidentBytes();
+            live_baseline = live_allocs;
+            window.latencies.clear();
+            window.reconfigures.clear();
+            window.ticks = 0;
+            window.start = tick_end;
+            allocs_window = total_allocs;
+            std::printf("%6s %6s %8s %8s %10s %8s %7s %7s %7s %7s %8s %8s\n", "window", "s", "rss MB", "growth",
+                        "alloc/tick", "live", "frames", "p50 ms", "p95 ms", "p99 ms", "rebuilds", "max ms");
+        }
+        else if (warm && tick_end - window.start >= std::chrono::duration<double>(kWindowSeconds)) {
+            end_window(tick_end);
+        }
+    }
+    // The last partial window
+    if (warm && window.ticks > 0)
+        end_window(Clock::now());
+
+    const double reconfigure_max = reconfigures.empty() ? 0.0 : *std::max_element(reconfigures.begin(), reconfigures.end());
+    std::printf("seed %u, %.0f s, %llu ticks, %llu changes, %llu rebuilds, %d windows\n", seed, seconds, (unsigned long long)ticks,
+                (unsigned long long)changes, (unsigned long long)rebuilds, windows);
+    std::printf("frames    %zu, %llu dropped at the source\n", latencies.size(), (unsigned long long)source->GetDropped());
+    std::printf("latency   p50 %.1f ms, p95 %.1f ms, p99 %.1f ms\n", Percentile(latencies, 0.50), Percentile(latencies, 0.95),
+                Percentile(latencies, 0.99));
+    std::printf("rebuild   p50 %.1f ms, max %.1f ms\n", Percentile(reconfigures, 0.5), reconfigure_max);
+    std::printf("controls  %llu color, %llu stereo\n", (unsigned long long)source->GetControls(),
+                (unsigned long long)source->GetStereoConfigs());
+
+    if (windows == 0) {
+        std::fprintf(stderr, "no window completed\n");
+        failures++;
+    }
+    if (failures > 0) {
+        std::fprintf(stderr, "%d budgets exceeded\n", failures);
+        return EXIT_FAILURE;
+    }
+    std::printf("oak_soak: all budgets met\n");
+
+    return EXIT_SUCCESS;
+}
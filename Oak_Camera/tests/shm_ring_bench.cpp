@@ -0,0 +1,153 @@
+//
+// Oak Shared Memory Ring Benchmark
+//
+// Publishes synthetic color, depth and metadata frames as fast as possible while a
+// reader thread copies out the newest slot, then grows the color frame so the reader
+// has to follow the writer to a new segment. Reports fps and GB/s on both sides and
+// fails when the reader sees a torn frame or never reaches the grown segment.
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "shm_frame_publisher.hpp"
+#include "shm_frame_reader.hpp"
+
+// OpenCV type codes, the ring stores them but this benchmark does not link OpenCV
+static constexpr int32_t kType8UC3 = 16;
+static constexpr int32_t kType16UC1 = 2;
+
+struct Phase {
+    const char *name;
+    int color_width;
+    int color_height;
+};
+
+static const Phase kPhases[] = {{"1080p", 1920, 1080}, {"4k grown", 3840, 2160}};
+
+struct ReaderStats {
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+    uint64_t torn = 0;
+    uint64_t corrupt = 0;
+    int max_width = 0;
+};
+
+static void Stamp(std::vector<uint8_t> &buf, uint64_t frame_num)
+{
+    // Start and end of the payload carry the frame number, a mix of two frames shows up as a mismatch
+    std::memcpy(buf.data(), &frame_num, sizeof(frame_num));
+    std::memcpy(buf.data() + buf.size() - sizeof(frame_num), &frame_num, sizeof(frame_num));
+}
+
+static void ReadLoop(const std::string &name, const std::atomic<bool> &done, ReaderStats &stats)
+{
+    shm_frame_reader reader;
+    while (!reader.Open(name) && !done.load())
+        std::this_thread::yield();
+
+    std::vector<uint8_t> copy[ShmStream_Count];
+    uint64_t last = 0;
+    while (!done.load(std::memory_order_relaxed)) {
+        ShmFrameView view {};
+        if (!reader.AcquireLatest(view) || view.count == last)
+            continue;
+
+        uint64_t bytes = 0;
+        for (int i = 0; i < ShmStream_Count; i++) {
+            copy[i].resize(view.info[i]->size);
+            if (view.info[i]->size > 0)
+                std::memcpy(copy[i].data(), view.data[i], view.info[i]->size);
+            bytes += view.info[i]->size;
+        }
+        if (!reader.IsValid(view)) {
+            stats.torn++;
+            continue;
+        }
+
+        last = view.count;
+        const auto &color = copy[ShmStream_Color];
+        uint64_t head = 0, tail = 0;
+        if (color.size() >= 2 * sizeof(uint64_t)) {
+            std::memcpy(&head, color.data(), sizeof(head));
+            std::memcpy(&tail, color.data() + color.size() - sizeof(tail), sizeof(tail));
+        }
+        if (head != (uint64_t)view.info[ShmStream_Color]->frame_num || tail != head)
+            stats.corrupt++;
+        stats.frames++;
+        stats.bytes += bytes;
+        stats.max_width = std::max(stats.max_width, view.info[ShmStream_Color]->width);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int frames_per_phase = argc > 1 ? std::max(1, std::atoi(argv[1])) : 300;
+    std::string name = "/flowcv_oak_bench_" + std::to_string(getpid());
+
+    shm_frame_publisher publisher;
+    publisher.SetName(name);
+
+    std::atomic<bool> done(false);
+    ReaderStats stats;
+    std::thread reader(ReadLoop, name, std::cref(done), std::ref(stats));
+
+    std::vector<uint8_t> depth(1280 * 720 * 2, 0x55);
+    std::string meta(2048, ' ');
+    uint64_t frame_num = 0;
+    uint64_t written = 0;
+    bool ok = true;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto &phase : kPhases) {
+        std::vector<uint8_t> color((size_t)phase.color_width * phase.color_height * 3, 0xAA);
+        auto phase_start = std::chrono::steady_clock::now();
+        uint64_t phase_bytes = 0;
+        for (int n = 0; n < frames_per_phase; n++) {
+            frame_num++;
+            Stamp(color, frame_num);
+            ShmFrameData data[ShmStream_Count] = {
+                {color.data(), color.size(), phase.color_width, phase.color_height, kType8UC3, phase.color_width * 3, (int64_t)frame_num, 0},
+                {depth.data(), depth.size(), 1280, 720, kType16UC1, 1280 * 2, (int64_t)frame_num, 0},
+                {meta.data(), meta.size(), 0, 0, 0, 0, (int64_t)frame_num, 0}};
+            if (!publisher.Publish(data)) {
+                std::fprintf(stderr, "Publish failed at frame %llu\n", (unsigned long long)frame_num);
+                ok = false;
+                break;
+            }
+            phase_bytes += color.size() + depth.size() + meta.size();
+        }
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - phase_start).count();
+        std::printf("publish %-9s %8.1f fps %6.2f GB/s\n", phase.name, frames_per_phase / secs, phase_bytes / secs / 1e9);
+        written += phase_bytes;
+        if (!ok)
+            break;
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Give the reader a moment to pick up the last slot before stopping it
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    done.store(true);
+    reader.join();
+    publisher.Close();
+
+    std::printf("publish total     %8.1f fps %6.2f GB/s\n", frame_num / secs, written / secs / 1e9);
+    std::printf("read              %8.1f fps %6.2f GB/s (%llu frames, %llu torn and retried)\n", stats.frames / secs,
+                stats.bytes / secs / 1e9, (unsigned long long)stats.frames, (unsigned long long)stats.torn);
+
+    if (stats.corrupt > 0) {
+        std::fprintf(stderr, "FAIL: %llu frames passed IsValid() with mixed contents\n", (unsigned long long)stats.corrupt);
+        ok = false;
+    }
+    if (stats.max_width != kPhases[1].color_width) {
+        std::fprintf(stderr, "FAIL: reader did not follow the grown segment\n");
+        ok = false;
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,194 @@
+//
+// Oak Depth TSDF Fusion Test
+//
+// Integrates depth rendered from a tilted plane and a sphere at known poses and
+// checks that the extracted surface points lie on the true surface, then shrinks
+// the memory budget and checks what eviction leaves behind.
+//
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+#include "opencv2/opencv.hpp"
+#include "tsdf_volume.hpp"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                                       \
+    do {                                                                                  \
+        if (!(cond)) {                                                                    \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                                   \
+        }                                                                                 \
+    } while (0)
+
+static constexpr int kWidth = 320;
+static constexpr int kHeight = 240;
+static constexpr float kFocal = 300.0f;
+static constexpr float kVoxel = 0.01f;
+// Extracted points interpolate between voxel centers, allow one and a half voxels of error
+static constexpr float kTolerance = 1.5f * kVoxel;
+
+struct Pose {
+    float yaw;
+    float x;
+    float y;
+};
+
+static const Pose kPoses[] = {{0.0f, 0.0f, 0.0f}, {0.1f, -0.1f, 0.0f}, {-0.1f, 0.1f, 0.05f}, {0.05f, 0.0f, -0.05f}};
+
+// Ray from the camera center through a pixel, returns the distance along the optical axis or a negative value on a miss
+using Surface = std::function<float(const cv::Vec3f &origin, const cv::Vec3f &dir)>;
+
+// Camera to world, a rotation about the vertical axis and a translation
+static cv::Matx44f MakePose(const Pose &p)
+{
+    cv::Matx44f pose = cv::Matx44f::eye();
+    pose(0, 0) = std::cos(p.yaw);
+    pose(0, 2) = std::sin(p.yaw);
+    pose(2, 0) = -std::sin(p.yaw);
+    pose(2, 2) = std::cos(p.yaw);
+    pose(0, 3) = p.x;
+    pose(1, 3) = p.y;
+
+    return pose;
+}
+
+static cv::Mat Render(const Surface &surface, const cv::Matx44f &pose, int max_col = kWidth)
+{
+    cv::Mat depth(kHeight, kWidth, CV_16UC1, cv::Scalar(0));
+    const cv::Vec3f origin(pose(0, 3), pose(1, 3), pose(2, 3));
+    for (int v = 0; v < kHeight; v++) {
+        auto *row = depth.ptr<uint16_t>(v);
+        for (int u = 0; u < max_col; u++) {
+            // Unit depth ray, so the distance along it is the camera z
+            float rx = ((float)u - kWidth * 0.5f) / kFocal;
+            float ry = ((float)v - kHeight * 0.5f) / kFocal;
+            cv::Vec3f dir(pose(0, 0) * rx + pose(0, 1) * ry + pose(0, 2), pose(1, 0) * rx + pose(1, 1) * ry + pose(1, 2),
+                          pose(2, 0) * rx + pose(2, 1) * ry + pose(2, 2));
+            float z = surface(origin, dir);
+            if (z > 0.0f)
+                row[u] = (uint16_t)std::lround(z * 1000.0f);
+        }
+    }
+
+    return depth;
+}
+
+static float Dot(const cv::Vec3f &a, const cv::Vec3f &b)
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Plane n . p = offset with a unit normal
+static const cv::Vec3f kPlaneNormal(0.3f / std::sqrt(1.1f), 0.1f / std::sqrt(1.1f), 1.0f / std::sqrt(1.1f));
+static constexpr float kPlaneOffset = 1.5f;
+
+static float PlaneHit(const cv::Vec3f &origin, const cv::Vec3f &dir)
+{
+    float denom = Dot(kPlaneNormal, dir);
+    return (std::fabs(denom) < 1e-6f) ? -1.0f : (kPlaneOffset - Dot(kPlaneNormal, origin)) / denom;
+}
+
+static float PlaneDistance(const cv::Point3f &p)
+{
+    return std::fabs(Dot(kPlaneNormal, cv::Vec3f(p.x, p.y, p.z)) - kPlaneOffset);
+}
+
+static const cv::Vec3f kSphereCenter(0.0f, 0.0f, 1.2f);
+static constexpr float kSphereRadius = 0.3f;
+
+static float SphereHit(const cv::Vec3f &origin, const cv::Vec3f &dir)
+{
+    cv::Vec3f oc(origin[0] - kSphereCenter[0], origin[1] - kSphereCenter[1], origin[2] - kSphereCenter[2]);
+    float a = Dot(dir, dir);
+    float b = Dot(oc, dir);
+    float disc = b * b - a * (Dot(oc, oc) - kSphereRadius * kSphereRadius);
+    return (disc < 0.0f) ? -1.0f : (-b - std::sqrt(disc)) / a;
+}
+
+static float SphereDistance(const cv::Point3f &p)
+{
+    cv::Vec3f d(p.x - kSphereCenter[0], p.y - kSphereCenter[1], p.z - kSphereCenter[2]);
+    return std::fabs(std::sqrt(Dot(d, d)) - kSphereRadius);
+}
+
+static void SetUp(tsdf_volume &volume)
+{
+    volume.SetVoxelSize(kVoxel);
+    volume.SetDepthRange(0.2f, 4.0f);
+    volume.SetIntrinsics({{kFocal, 0.0f, kWidth * 0.5f}, {0.0f, kFocal, kHeight * 0.5f}, {0.0f, 0.0f, 1.0f}});
+}
+
+static float MaxDistance(const std::vector<cv::Point3f> &points, float (*distance)(const cv::Point3f &))
+{
+    float worst = 0.0f;
+    for (const auto &p : points)
+        worst = std::max(worst, distance(p));
+
+    return worst;
+}
+
+static void TestSurface(const char *name, const Surface &surface, float (*distance)(const cv::Point3f &))
+{
+    tsdf_volume volume;
+    SetUp(volume);
+    for (const auto &pose : kPoses)
+        CHECK(volume.Integrate(Render(surface, MakePose(pose)), MakePose(pose)));
+
+    std::vector<cv::Point3f> points;
+    CHECK(volume.ExtractPoints(points, false) > 1000);
+    float worst = MaxDistance(points, distance);
+    std::printf("%-6s %zu points, max distance to surface %.1f mm\n", name, points.size(), worst * 1000.0f);
+    CHECK(worst < kTolerance);
+
+    // Nothing was integrated since, so nothing has changed
+    CHECK(volume.ExtractPoints(points, true) == 0);
+}
+
+static void TestEviction()
+{
+    tsdf_volume volume;
+    SetUp(volume);
+    const cv::Matx44f pose = MakePose(kPoses[0]);
+    CHECK(volume.Integrate(Render(PlaneHit, pose), pose));
+    // Later frames only see the left half, the right half becomes the least recently observed
+    for (int i = 0; i < 3; i++)
+        CHECK(volume.Integrate(Render(PlaneHit, pose, kWidth / 2), pose));
+
+    std::vector<cv::Point3f> points;
+    size_t before = volume.ExtractPoints(points, false);
+    TsdfStats full = volume.GetStats();
+    CHECK(full.evicted == 0);
+
+    size_t block_bytes = full.memory_bytes / full.blocks;
+    volume.SetMemoryBudget(block_bytes * full.blocks / 3);
+    TsdfStats evicted = volume.GetStats();
+    std::printf("evict  %zu of %zu blocks kept\n", evicted.blocks, full.blocks);
+    CHECK(evicted.evicted > 0);
+    CHECK(evicted.blocks < full.blocks / 2);
+    CHECK(evicted.blocks + evicted.evicted == full.blocks);
+
+    // Blocks next to the evicted ones lost the voxels their cached crossings were interpolated from
+    CHECK(volume.ExtractPoints(points, true) > 0);
+    size_t after = volume.ExtractPoints(points, false);
+    CHECK(after > 0 && after < before);
+    CHECK(MaxDistance(points, PlaneDistance) < kTolerance);
+}
+
+int main()
+{
+    TestSurface("plane", PlaneHit, PlaneDistance);
+    TestSurface("sphere", SphereHit, SphereDistance);
+    TestEviction();
+
+    if (failures > 0) {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    std::printf("tsdf_volume: all checks passed\n");
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,442 @@
+//
+// Oak Depth TSDF Fusion
+//
+
+#include "tsdf_volume.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// Voxels are averaged over at most this many observations so the surface can still follow slow changes
+static constexpr float kMaxWeight = 64.0f;
+// Truncation band in voxels on either side of the surface
+static constexpr float kTruncationVoxels = 4.0f;
+// Pixel stride used to find the blocks a frame touches, a block spans many pixels at working range
+static constexpr int kAllocStride = 4;
+// Block storage plus hash node overhead, extracted points are counted separately
+static constexpr size_t kBlockOverhead = 64;
+// Block coordinates are packed 21 bits per axis
+static constexpr int kKeyBits = 21;
+static constexpr int kKeyBias = 1 << (kKeyBits - 1);
+static constexpr uint64_t kKeyMask = (1ull << kKeyBits) - 1;
+
+static int FloorDiv(int value, int divisor)
+{
+    return (value >= 0) ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+tsdf_volume::tsdf_volume()
+{
+    voxel_size_ = 0.01f;
+    truncation_ = voxel_size_ * kTruncationVoxels;
+    min_depth_ = 0.2f;
+    max_depth_ = 4.0f;
+    budget_bytes_ = 256ull * 1024 * 1024;
+    fx_ = fy_ = cx_ = cy_ = 0.0f;
+    frame_ = 0;
+    dropped_ = 0;
+    evicted_ = 0;
+    integrate_ms_ = 0.0;
+    stats_ = TsdfStats();
+    has_pending_ = false;
+    stop_ = false;
+}
+
+tsdf_volume::~tsdf_volume()
+{
+    Stop();
+}
+
+void tsdf_volume::Reset()
+{
+    {
+        std::lock_guard<std::mutex> lk(pending_mutex_);
+        has_pending_ = false;
+        dropped_ = 0;
+    }
+    std::lock_guard<std::mutex> lk(volume_mutex_);
+    blocks_.clear();
+    frame_ = 0;
+    evicted_ = 0;
+    integrate_ms_ = 0.0;
+    UpdateStats_();
+}
+
+void tsdf_volume::SetVoxelSize(float voxel_m)
+{
+    voxel_m = std::clamp(voxel_m, 0.001f, 0.5f);
+    std::lock_guard<std::mutex> lk(volume_mutex_);
+    if (voxel_m == voxel_size_)
+        return;
+
+    // Existing blocks are laid out on the old grid
+    voxel_size_ = voxel_m;
+    truncation_ = voxel_size_ * kTruncationVoxels;
+    blocks_.clear();
+    UpdateStats_();
+}
+
+float tsdf_volume::GetVoxelSize() const
+{
+    return voxel_size_;
+}
+
+void tsdf_volume::SetMemoryBudget(size_t bytes)
+{
+    std::lock_guard<std::mutex> lk(volume_mutex_);
+    budget_bytes_ = std::max(bytes, (sizeof(Block) + kBlockOverhead) * 64);
+    Evict_();
+    UpdateStats_();
+}
+
+size_t tsdf_volume::GetMemoryBudget() const
+{
+    return budget_bytes_;
+}
+
+void tsdf_volume::SetDepthRange(float min_m, float max_m)
+{
+    std::lock_guard<std::mutex> lk(volume_mutex_);
+    min_depth_ = std::max(0.0f, min_m);
+    max_depth_ = std::max(min_depth_ + voxel_size_, max_m);
+}
+
+void tsdf_volume::SetIntrinsics(const std::vector<std::vector<float>> &intrinsics)
+{
+    if (intrinsics.size() != 3)
+        return;
+
+    std::lock_guard<std::mutex> lk(pending_mutex_);
+    fx_ = intrinsics[0][0];
+    fy_ = intrinsics[1][1];
+    cx_ = intrinsics[0][2];
+    cy_ = intrinsics[1][2];
+}
+
+uint64_t tsdf_volume::Key_(int x, int y, int z)
+{
+    return ((uint64_t)(x + kKeyBias) & kKeyMask) << (2 * kKeyBits) | ((uint64_t)(y + kKeyBias) & kKeyMask) << kKeyBits |
+           ((uint64_t)(z + kKeyBias) & kKeyMask);
+}
+
+cv::Vec3i tsdf_volume::Coord_(uint64_t key)
+{
+    return {(int)((key >> (2 * kKeyBits)) & kKeyMask) - kKeyBias, (int)((key >> kKeyBits) & kKeyMask) - kKeyBias,
+            (int)(key & kKeyMask) - kKeyBias};
+}
+
+const tsdf_volume::Block *tsdf_volume::Find_(int x, int y, int z) const
+{
+    auto it = blocks_.find(Key_(x, y, z));
+    return (it != blocks_.end()) ? &it->second : nullptr;
+}
+
+bool tsdf_volume::Voxel_(const cv::Vec3i &block, int x, int y, int z, float &sdf) const
+{
+    // Voxel coordinates may step out of the block, look up the neighbour that holds them
+    int gx = block[0] * kBlockSize + x;
+    int gy = block[1] * kBlockSize + y;
+    int gz = block[2] * kBlockSize + z;
+    int bx = FloorDiv(gx, kBlockSize);
+    int by = FloorDiv(gy, kBlockSize);
+    int bz = FloorDiv(gz, kBlockSize);
+    const Block *blk = Find_(bx, by, bz);
+    if (blk == nullptr)
+        return false;
+
+    int idx = ((gz - bz * kBlockSize) * kBlockSize + (gy - by * kBlockSize)) * kBlockSize + (gx - bx * kBlockSize);
+    if (blk->weight[idx] <= 0.0f)
+        return false;
+
+    sdf = blk->sdf[idx];
+
+    return true;
+}
+
+void tsdf_volume::AllocateBlocks_(const cv::Mat &depth, const cv::Matx44f &pose, const cv::Vec4f &k, std::vector<uint64_t> &keys)
+{
+    const cv::Matx33f rot = pose.get_minor<3, 3>(0, 0);
+    const cv::Vec3f trans(pose(0, 3), pose(1, 3), pose(2, 3));
+    const float block_m = voxel_size_ * kBlockSize;
+
+    // Blocks covering the truncation band in front of and behind every sampled return
+    keys.clear();
+    for (int v = 0; v < depth.rows; v += kAllocStride) {
+        const auto *row = depth.ptr<uint16_t>(v);
+        for (int u = 0; u < depth.cols; u += kAllocStride) {
+            float d = (float)row[u] * 0.001f;
+            if (d < min_depth_ || d > max_depth_)
+                continue;
+            float rx = ((float)u - k[2]) / k[0];
+            float ry = ((float)v - k[3]) / k[1];
+            for (float z : {d - truncation_, d, d + truncation_}) {
+                cv::Vec3f pw = rot * cv::Vec3f(rx * z, ry * z, z) + trans;
+                keys.push_back(Key_((int)std::floor(pw[0] / block_m), (int)std::floor(pw[1] / block_m),
+                                    (int)std::floor(pw[2] / block_m)));
+            }
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    for (auto key : keys) {
+        auto result = blocks_.try_emplace(key);
+        if (result.second) {
+            Block &block = result.first->second;
+            block.sdf.fill(1.0f);
+            block.weight.fill(0.0f);
+            block.last_seen = frame_;
+            block.dirty = false;
+        }
+    }
+}
+
+bool tsdf_volume::Integrate(const cv::Mat &depth, const cv::Matx44f &pose)
+{
+    if (depth.empty() || depth.type() != CV_16UC1)
+        return false;
+
+    cv::Vec4f k;
+    {
+        std::lock_guard<std::mutex> lk(pending_mutex_);
+        k = cv::Vec4f(fx_, fy_, cx_, cy_);
+    }
+    if (k[0] <= 0.0f || k[1] <= 0.0f)
+        return false;
+
+    auto start = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lk(volume_mutex_);
+    frame_++;
+    std::vector<uint64_t> keys;
+    AllocateBlocks_(depth, pose, k, keys);
+    std::vector<Block *> touched(keys.size());
+    for (size_t i = 0; i < keys.size(); i++)
+        touched[i] = &blocks_.find(keys[i])->second;
+
+    // World to camera is the inverse of the rigid pose
+    const cv::Matx33f rot_t = pose.get_minor<3, 3>(0, 0).t();
+    const cv::Vec3f trans(pose(0, 3), pose(1, 3), pose(2, 3));
+    const float voxel = voxel_size_;
+    const float trunc = truncation_;
+    const uint64_t frame = frame_;
+
+    // Blocks are independent, each one is updated by a single pool thread
+    cv::parallel_for_(cv::Range(0, (int)keys.size()), [&](const cv::Range &range) {
+        for (int i = range.start; i < range.end; i++) {
+            Block &block = *touched[i];
+            const cv::Vec3i coord = Coord_(keys[i]);
+            bool updated = false;
+            int idx = 0;
+            for (int z = 0; z < kBlockSize; z++) {
+                for (int y = 0; y < kBlockSize; y++) {
+                    for (int x = 0; x < kBlockSize; x++, idx++) {
+                        cv::Vec3f pw(((float)(coord[0] * kBlockSize + x) + 0.5f) * voxel,
+                                     ((float)(coord[1] * kBlockSize + y) + 0.5f) * voxel,
+                                     ((float)(coord[2] * kBlockSize + z) + 0.5f) * voxel);
+                        cv::Vec3f pc = rot_t * (pw - trans);
+                        if (pc[2] < min_depth_)
+                            continue;
+                        int u = cvRound(k[0] * pc[0] / pc[2] + k[2]);
+                        int v = cvRound(k[1] * pc[1] / pc[2] + k[3]);
+                        if (u < 0 || v < 0 || u >= depth.cols || v >= depth.rows)
+                            continue;
+                        float d = (float)depth.at<uint16_t>(v, u) * 0.001f;
+                        if (d < min_depth_ || d > max_depth_)
+                            continue;
+                        // Projective distance, voxels far behind the surface are occluded and left alone
+                        float sdf = d - pc[2];
+                        if (sdf < -trunc)
+                            continue;
+                        float tsdf = std::min(1.0f, sdf / trunc);
+                        float w = block.weight[idx];
+                        block.sdf[idx] = (block.sdf[idx] * w + tsdf) / (w + 1.0f);
+                        block.weight[idx] = std::min(w + 1.0f, kMaxWeight);
+                        updated = true;
+                    }
+                }
+            }
+            if (updated) {
+                block.dirty = true;
+                block.last_seen = frame;
+            }
+        }
+    });
+
+    Evict_();
+    integrate_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    UpdateStats_();
+
+    return true;
+}
+
+void tsdf_volume::Evict_()
+{
+    const size_t block_bytes = sizeof(Block) + kBlockOverhead;
+    if (blocks_.size() * block_bytes <= budget_bytes_)
+        return;
+
+    // Drop the least recently observed blocks down to 90% of the budget so eviction does not run every frame
+    size_t keep = (budget_bytes_ / block_bytes) * 9 / 10;
+    size_t drop = blocks_.size() - keep;
+    std::vector<std::pair<uint64_t, uint64_t>> ages;
+    ages.reserve(blocks_.size());
+    for (const auto &entry : blocks_)
+        ages.emplace_back(entry.second.last_seen, entry.first);
+    std::nth_element(ages.begin(), ages.begin() + (ptrdiff_t)drop, ages.end());
+    for (size_t i = 0; i < drop; i++)
+        blocks_.erase(ages[i].second);
+    evicted_ += drop;
+
+    // Cached crossings of the remaining neighbours may interpolate towards the dropped voxels
+    const int faces[6][3] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+    for (size_t i = 0; i < drop; i++) {
+        const cv::Vec3i coord = Coord_(ages[i].second);
+        for (const auto &face : faces) {
+            auto it = blocks_.find(Key_(coord[0] + face[0], coord[1] + face[1], coord[2] + face[2]));
+            if (it != blocks_.end())
+                it->second.dirty = true;
+        }
+    }
+}
+
+void tsdf_volume::ExtractBlock_(uint64_t key, Block &block) const
+{
+    const cv::Vec3i coord = Coord_(key);
+    block.points.clear();
+    int idx = 0;
+    for (int z = 0; z < kBlockSize; z++) {
+        for (int y = 0; y < kBlockSize; y++) {
+            for (int x = 0; x < kBlockSize; x++, idx++) {
+                if (block.weight[idx] <= 0.0f)
+                    continue;
+                float s0 = block.sdf[idx];
+                cv::Point3f p0(((float)(coord[0] * kBlockSize + x) + 0.5f) * voxel_size_,
+                               ((float)(coord[1] * kBlockSize + y) + 0.5f) * voxel_size_,
+                               ((float)(coord[2] * kBlockSize + z) + 0.5f) * voxel_size_);
+                // Sign changes towards the +x, +y and +z neighbours, each crossing is owned by one voxel
+                const int steps[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+                for (const auto &step : steps) {
+                    float s1;
+                    if (!Voxel_(coord, x + step[0], y + step[1], z + step[2], s1))
+                        continue;
+                    if ((s0 > 0.0f) == (s1 > 0.0f))
+                        continue;
+                    float t = s0 / (s0 - s1) * voxel_size_;
+                    block.points.emplace_back(p0.x + t * (float)step[0], p0.y + t * (float)step[1], p0.z + t * (float)step[2]);
+                }
+            }
+        }
+    }
+    block.dirty = false;
+}
+
+size_t tsdf_volume::ExtractPoints(std::vector<cv::Point3f> &points, bool changed_only)
+{
+    std::lock_guard<std::mutex> lk(volume_mutex_);
+
+    // Only blocks integrated since their last extraction are recomputed, the rest reuse their cached points
+    std::vector<std::pair<uint64_t, Block *>> dirty;
+    for (auto &entry : blocks_) {
+        if (entry.second.dirty)
+            dirty.emplace_back(entry.first, &entry.second);
+    }
+    cv::parallel_for_(cv::Range(0, (int)dirty.size()), [&](const cv::Range &range) {
+        for (int i = range.start; i < range.end; i++)
+            ExtractBlock_(dirty[i].first, *dirty[i].second);
+    });
+
+    points.clear();
+    if (changed_only) {
+        for (const auto &entry : dirty)
+            points.insert(points.end(), entry.second->points.begin(), entry.second->points.end());
+    }
+    else {
+        for (const auto &entry : blocks_)
+            points.insert(points.end(), entry.second.points.begin(), entry.second.points.end());
+    }
+    UpdateStats_();
+
+    return points.size();
+}
+
+void tsdf_volume::UpdateStats_()
+{
+    TsdfStats stats{};
+    stats.blocks = blocks_.size();
+    stats.memory_bytes = blocks_.size() * (sizeof(Block) + kBlockOverhead);
+    for (const auto &entry : blocks_)
+        stats.memory_bytes += entry.second.points.capacity() * sizeof(cv::Point3f);
+    stats.frames = frame_;
+    stats.evicted = evicted_;
+    stats.integrate_ms = integrate_ms_;
+
+    std::lock_guard<std::mutex> lk(stats_mutex_);
+    stats_ = stats;
+}
+
+TsdfStats tsdf_volume::GetStats()
+{
+    TsdfStats stats;
+    {
+        std::lock_guard<std::mutex> lk(stats_mutex_);
+        stats = stats_;
+    }
+    std::lock_guard<std::mutex> lk(pending_mutex_);
+    stats.dropped = dropped_;
+
+    return stats;
+}
+
+void tsdf_volume::Submit(const cv::Mat &depth, const cv::Matx44f &pose)
+{
+    {
+        std::lock_guard<std::mutex> lk(pending_mutex_);
+        if (has_pending_)
+            dropped_++;
+        depth.copyTo(pending_depth_);
+        pending_pose_ = pose;
+        has_pending_ = true;
+    }
+    pending_cv_.notify_one();
+}
+
+void tsdf_volume::Start()
+{
+    if (worker_.joinable())
+        return;
+
+    stop_ = false;
+    worker_ = std::thread(&tsdf_volume::WorkerLoop_, this);
+}
+
+void tsdf_volume::Stop()
+{
+    if (!worker_.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lk(pending_mutex_);
+        stop_ = true;
+        has_pending_ = false;
+    }
+    pending_cv_.notify_one();
+    worker_.join();
+}
+
+void tsdf_volume::WorkerLoop_()
+{
+    cv::Mat depth;
+    cv::Matx44f pose;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lk(pending_mutex_);
+            pending_cv_.wait(lk, [this] { return has_pending_ || stop_; });
+            if (stop_)
+                return;
+            std::swap(depth, pending_depth_);
+            pose = pending_pose_;
+            has_pending_ = false;
+        }
+        Integrate(depth, pose);
+    }
+}
@@ -0,0 +1,102 @@
+//
+// Oak Depth TSDF Fusion
+//
+// Sparse truncated signed distance volume. Space is hashed into 8 x 8 x 8
+// voxel blocks that are only allocated around observed surfaces, frames are
+// integrated on a worker thread and spread over the OpenCV thread pool, and
+// the least recently observed blocks are evicted to stay inside a memory
+// budget. Depth is uint16 mm, poses are camera to world in meters.
+//
+
+#ifndef FLOWCV_PLUGIN_TSDF_VOLUME_HPP_
+#define FLOWCV_PLUGIN_TSDF_VOLUME_HPP_
+#include <array>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "opencv2/opencv.hpp"
+
+struct TsdfStats {
+    size_t blocks;
+    size_t memory_bytes;
+    uint64_t frames;
+    uint64_t dropped;
+    uint64_t evicted;
+    double integrate_ms;
+};
+
+class tsdf_volume {
+  public:
+    static constexpr int kBlockSize = 8;
+    static constexpr int kBlockVoxels = kBlockSize * kBlockSize * kBlockSize;
+
+    tsdf_volume();
+    ~tsdf_volume();
+    void Reset();
+    void SetVoxelSize(float voxel_m);
+    [[nodiscard]] float GetVoxelSize() const;
+    void SetMemoryBudget(size_t bytes);
+    [[nodiscard]] size_t GetMemoryBudget() const;
+    void SetDepthRange(float min_m, float max_m);
+    void SetIntrinsics(const std::vector<std::vector<float>> &intrinsics);
+
+    // Synchronous integration, Submit() hands the frame to the worker and returns
+    bool Integrate(const cv::Mat &depth, const cv::Matx44f &pose);
+    void Submit(const cv::Mat &depth, const cv::Matx44f &pose);
+    void Start();
+    void Stop();
+
+    // Zero crossings of the surface, changed_only limits output to blocks updated since the last call
+    size_t ExtractPoints(std::vector<cv::Point3f> &points, bool changed_only);
+    [[nodiscard]] TsdfStats GetStats();
+
+  private:
+    struct Block {
+        std::array<float, kBlockVoxels> sdf;
+        std::array<float, kBlockVoxels> weight;
+        std::vector<cv::Point3f> points;
+        uint64_t last_seen;
+        bool dirty;
+    };
+
+    static uint64_t Key_(int x, int y, int z);
+    static cv::Vec3i Coord_(uint64_t key);
+    [[nodiscard]] const Block *Find_(int x, int y, int z) const;
+    bool Voxel_(const cv::Vec3i &block, int x, int y, int z, float &sdf) const;
+    void AllocateBlocks_(const cv::Mat &depth, const cv::Matx44f &pose, const cv::Vec4f &k, std::vector<uint64_t> &keys);
+    void ExtractBlock_(uint64_t key, Block &block) const;
+    void Evict_();
+    void UpdateStats_();
+    void WorkerLoop_();
+
+    std::mutex volume_mutex_;
+    std::unordered_map<uint64_t, Block> blocks_;
+    float voxel_size_;
+    float truncation_;
+    float min_depth_;
+    float max_depth_;
+    size_t budget_bytes_;
+    uint64_t frame_;
+    uint64_t evicted_;
+    double integrate_ms_;
+
+    // Published after every update so readers never wait on an integration in progress
+    std::mutex stats_mutex_;
+    TsdfStats stats_;
+
+    // Latest frame slot for the worker, a frame still pending when the next arrives is dropped.
+    // Intrinsics share its lock so the capture thread never waits on an integration
+    std::thread worker_;
+    std::mutex pending_mutex_;
+    float fx_, fy_, cx_, cy_;
+    std::condition_variable pending_cv_;
+    cv::Mat pending_depth_;
+    cv::Matx44f pending_pose_;
+    bool has_pending_;
+    bool stop_;
+    uint64_t dropped_;
+};
+
+#endif //FLOWCV_PLUGIN_TSDF_VOLUME_HPP_